@@ -210,6 +210,7 @@ int b_dot_cmd(int n, char *argv[], Shbltin_t *context) {
     checkpt_t buff;
     Sfio_t *iop = NULL;
     short level;
+    bool cached = false;
     Optdisc_t disc;
 
     memset(&disc, 0, sizeof(disc));
@@ -268,6 +269,7 @@ int b_dot_cmd(int n, char *argv[], Shbltin_t *context) {
                 __builtin_unreachable();
             }
             filename = path_fullname(shp, stkptr(shp->stk, PATH_OFFSET));
+            cached = pcache_open(shp, fd, filename);
         }
     }
     *prevscope = shp->st;
@@ -297,8 +299,9 @@ int b_dot_cmd(int n, char *argv[], Shbltin_t *context) {
         if (np) {
             sh_exec(shp, (Shnode_t *)(nv_funtree(np)), sh_isstate(shp, SH_ERREXIT));
         } else {
-            buffer = malloc(IOBSIZE + 1);
-            iop = sfnew(NULL, buffer, IOBSIZE, fd, SF_READ);
+            // Let sfio map a cached parse tree rather than copy it into a buffer.
+            buffer = cached ? NULL : malloc(IOBSIZE + 1);
+            iop = sfnew(NULL, buffer, cached ? SF_UNBOUND : IOBSIZE, fd, SF_READ);
             sh_offstate(shp, SH_NOFORK);
             sh_eval(shp, iop, sh_isstate(shp, SH_PROFILE) ? SH_FUNEVAL : 0);
         }
@@ -387,8 +390,13 @@ int b_shift(int n, char *argv[], Shbltin_t *context) {
 //
 int b_wait(int n, char *argv[], Shbltin_t *context) {
     Shell_t *shp = context->shp;
+    bool any = false;
     while ((n = optget(argv, sh_optwait))) {
         switch (n) {
+            case 'n': {
+                any = true;
+                break;
+            }
             case ':': {
                 errormsg(SH_DICT, 2, "%s", opt_info.arg);
                 break;
@@ -407,7 +415,11 @@ int b_wait(int n, char *argv[], Shbltin_t *context) {
     }
 
     argv += opt_info.index;
-    job_bwait(argv);
+    if (any) {
+        job_bwaitany(argv);
+    } else {
+        job_bwait(argv);
+    }
     return shp->exitval;
 }
 
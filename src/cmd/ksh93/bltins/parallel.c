@@ -0,0 +1,271 @@
+//
+// `parallel` builtin command
+//
+// parallel [-j jobs] [-n count] command [arg ...]
+//
+// Each line read from standard input is an argument, and each group of <count> of them is appended
+// to <command> and run in a forked child, at most <jobs> of them at a time. The children are posted
+// on the job list like any other process the shell forks and are collected with job_waitany() and
+// job_wait(). A child writes its standard output to a temporary file which is copied to the
+// standard output of `parallel` once the commands for the preceding arguments have been copied,
+// so the output is in the order of the arguments however the commands are scheduled.
+//
+#include "config_ast.h"  // IWYU pragma: keep
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "builtins.h"
+#include "defs.h"
+#include "error.h"
+#include "fault.h"
+#include "io.h"
+#include "jobs.h"
+#include "name.h"
+#include "option.h"
+#include "path.h"
+#include "sfio.h"
+#include "shcmd.h"
+#include "shnodes.h"
+#include "stk.h"
+
+struct pjob {
+    pid_t pid;
+    Sfio_t *out;  // standard output of the command, a temporary file or once done a string
+    int exitval;
+    bool done;
+};
+
+// The temporary files that are not in use. They are truncated and reused rather than created for
+// each command. There are at most <maxjob> + 1 of them.
+struct spare {
+    Sfio_t **files;
+    int nfile;
+};
+
+//
+// Return the next argument read from <iop> in a malloc'd string, or NULL at the end of the input.
+//
+static_fn char *parallel_getarg(Sfio_t *iop) {
+    char *cp = sfgetr(iop, '\n', 1);
+
+    if (cp) return strdup(cp);
+    cp = sfgetr(iop, '\n', -1);
+    return cp ? strndup(cp, sfvalue(iop)) : NULL;
+}
+
+//
+// Run the command <argv> in a child of `parallel` with its standard output on <fd> and exit with
+// its exit status. A function or builtin is run by this process and any other command is exec'd.
+//
+__attribute__((noreturn)) static_fn void parallel_child(Shell_t *shp, int fd, int argc,
+                                                       char *argv[]) {
+    checkpt_t *buffp = stkalloc(shp->stk, sizeof(checkpt_t));
+    Namval_t *np = NULL, *nq;
+    int nullfd;
+
+    // The parent reads standard input, so don't touch its stream; only replace the descriptor.
+    nullfd = open("/dev/null", O_RDONLY);
+    if (nullfd > 0) {
+        dup2(nullfd, 0);
+        close(nullfd);
+    }
+    dup2(fd, 1);
+    sh_pushcontext(shp, buffp, SH_JMPEXIT);
+    if (!sigsetjmp(buffp->buff, 0)) {
+        if (!strchr(argv[0], '/')) np = nv_bfsearch(argv[0], shp->fun_tree, &nq, NULL);
+        if (np && (is_abuiltin(np) || is_afunction(np))) {
+            shp->exitval = sh_run(shp, argc, argv);
+        } else {
+            sh_offoption(shp, SH_ERREXIT);
+            sh_freeup(shp);
+            path_exec(shp, argv[0], argv, NULL);
+        }
+    }
+    sh_popcontext(shp, buffp);
+    sh_done(shp, 0);
+}
+
+//
+// Return a temporary file for the standard output of a command.
+//
+static_fn Sfio_t *parallel_tmpfile(struct spare *sp) {
+    Sfio_t *out;
+
+    if (sp->nfile) return sp->files[--sp->nfile];
+    if (!(out = sftmp(0))) {
+        errormsg(SH_DICT, ERROR_system(1), e_tmpcreate);
+        __builtin_unreachable();
+    }
+    (void)fcntl(sffileno(out), F_SETFD, FD_CLOEXEC);
+    // The child writes through the file descriptor, so don't trust the stream's idea of the offset.
+    sfset(out, SF_SHARE | SF_PUBLIC, 1);
+    return out;
+}
+
+//
+// Copy the output of the job <jp>, which has completed, to <outfile>. A temporary file is emptied
+// and kept in <sp> for the next command.
+//
+static_fn void parallel_flush(struct pjob *jp, Sfio_t *outfile, struct spare *sp) {
+    sfseek(jp->out, (Sfoff_t)0, SEEK_SET);
+    sfmove(jp->out, outfile, SF_UNBOUND, -1);
+    if (sfset(jp->out, 0, 0) & SF_STRING) {
+        sfclose(jp->out);
+    } else {
+        sfseek(jp->out, (Sfoff_t)0, SEEK_SET);
+        if (ftruncate(sffileno(jp->out), 0) < 0) {
+            sfclose(jp->out);
+        } else {
+            sp->files[sp->nfile++] = jp->out;
+        }
+    }
+    jp->out = NULL;
+}
+
+int b_parallel(int argc, char *argv[], Shbltin_t *context) {
+    Shell_t *shp = context->shp;
+    Sfio_t *iop, *out;
+    struct pjob *jobs = NULL, *jp;
+    pid_t *pids = NULL, pid;
+    char **args, *cp = NULL;
+    long maxjob = 0, count = 1;
+    int cmdc, njob = 0, maxpend = 0, nrun, n, i;
+    int exitval = 0;
+    bool eof = false, intr = false;
+    struct spare spare;
+    UNUSED(argc);
+
+    while ((n = optget(argv, sh_optparallel))) {
+        switch (n) {
+            case 'j': {
+                maxjob = opt_info.num;
+                break;
+            }
+            case 'n': {
+                count = opt_info.num;
+                break;
+            }
+            case ':': {
+                errormsg(SH_DICT, 2, "%s", opt_info.arg);
+                break;
+            }
+            case '?': {
+                errormsg(SH_DICT, ERROR_usage(2), "%s", opt_info.arg);
+                __builtin_unreachable();
+            }
+            default: { break; }
+        }
+    }
+    argv += opt_info.index;
+    if (error_info.errors || !*argv || maxjob < 0 || count < 1) {
+        errormsg(SH_DICT, ERROR_usage(2), "%s", optusage(NULL));
+        __builtin_unreachable();
+    }
+    if (maxjob == 0) {
+        maxjob = sysconf(_SC_NPROCESSORS_ONLN);
+        if (maxjob < 1) maxjob = 1;
+    }
+    if (!(iop = shp->sftable[0]) && !(iop = sh_iostream(shp, 0, 0))) return 1;
+    // The children write to file descriptors, so standard output of $(...) must be one too.
+    if (shp->subshell) sh_subtmpfile(shp);
+    // A signal only marks the shell so that job_waitany() returns and the commands can be stopped
+    // or the trap run here, rather than jumping out of the builtin.
+    sh_offstate(shp, SH_STOPOK);
+    for (cmdc = 0; argv[cmdc]; cmdc++) {
+        ;  // empty loop
+    }
+    args = malloc((cmdc + count + 1) * sizeof(char *));
+    memcpy(args, argv, cmdc * sizeof(char *));
+    pids = malloc(maxjob * sizeof(pid_t));
+    // A finished command whose output waits for the commands before it keeps its file while
+    // another command runs, so there can be one more file than <maxjob>.
+    spare.files = malloc((maxjob + 1) * sizeof(Sfio_t *));
+    spare.nfile = 0;
+
+    while (1) {
+        // Start commands until <maxjob> are running or the arguments have all been read.
+        for (nrun = i = 0; i < njob; i++) {
+            if (!jobs[i].done) nrun++;
+        }
+        while (!eof && !intr && nrun < maxjob) {
+            for (n = cmdc; n < cmdc + count && (cp = parallel_getarg(iop));) {
+                if (*cp) {
+                    args[n++] = cp;
+                } else {
+                    free(cp);
+                }
+            }
+            if (!cp) eof = true;
+            if (n == cmdc) break;
+            args[n] = NULL;
+            out = parallel_tmpfile(&spare);
+            pid = sh_fork(shp, FAMP, NULL);
+            if (pid == 0) parallel_child(shp, sffileno(out), n, args);
+            while (n > cmdc) free(args[--n]);
+            if (njob >= maxpend) {
+                maxpend = maxpend ? 2 * maxpend : maxjob;
+                jobs = realloc(jobs, maxpend * sizeof(struct pjob));
+            }
+            jp = &jobs[njob++];
+            jp->pid = pid;
+            jp->out = out;
+            jp->exitval = 0;
+            jp->done = false;
+            nrun++;
+        }
+        // Copy the output of the completed jobs that have no running job before them.
+        for (i = 0; i < njob && jobs[i].done; i++) {
+            parallel_flush(&jobs[i], sfstdout, &spare);
+            if (!exitval) exitval = jobs[i].exitval;
+        }
+        if (i) memmove(jobs, jobs + i, (njob -= i) * sizeof(struct pjob));
+        if (!njob) break;
+        // Wait for the next job to complete.
+        for (nrun = i = 0; i < njob; i++) {
+            if (!jobs[i].done) pids[nrun++] = jobs[i].pid;
+        }
+        n = intr ? 0 : job_waitany(pids, nrun);
+        if (n < 0 && !(shp->trapnote & SH_SIGSET) && !shp->intrap) {
+            // A trapped signal; run the trap and carry on, as `wait` does.
+            sh_chktrap(shp);
+            continue;
+        }
+        if (n < 0) {
+            // Interrupted; stop the running commands and collect them. Under job control each
+            // command is a process group, so its own children are stopped too.
+            intr = true;
+            for (i = 0; i < nrun; i++) {
+                if (!sh_isstate(shp, SH_MONITOR) || killpg(pids[i], SIGTERM) < 0) {
+                    kill(pids[i], SIGTERM);
+                }
+            }
+        }
+        for (i = 0; i < njob; i++) {
+            jp = &jobs[i];
+            if (jp->done || (!intr && jp->pid != pids[n])) continue;
+            job_wait(jp->pid);
+            jp->exitval = shp->exitval;
+            jp->done = true;
+            if (i == 0) continue;
+            // Keep the output in memory so that the number of open files is bounded by <maxjob>.
+            if ((out = sfstropen())) {
+                parallel_flush(jp, out, &spare);
+                jp->out = out;
+            }
+        }
+    }
+    while (spare.nfile) sfclose(spare.files[--spare.nfile]);
+    free(spare.files);
+    free(pids);
+    free(jobs);
+    free(args);
+    if (intr) sh_sigcheck(shp);
+    return exitval;
+}
@@ -18,7 +18,7 @@
  *                                                                      *
  ***********************************************************************/
 //
-// read [-ACprs] [-q format] [-d delim] [-u filenum] [-t timeout] [-n n] [-N n] [name...]
+// read [-AClprs] [-q format] [-d delim] [-u filenum] [-t timeout] [-n n] [-N n] [name...]
 //
 //   David Korn
 //   AT&T Labs
@@ -27,6 +27,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <setjmp.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -60,8 +61,9 @@
 #define NN_FLAG 0x10  // fixed size read exact
 #define V_FLAG 0x20   // use default value
 #define C_FLAG 0x40   // read into compound variable
-#define D_FLAG 8      // must be number of bits for all flags
+#define D_FLAG 9      // must be number of bits for all flags
 #define SS_FLAG 0x80  // read .csv format file
+#define L_FLAG 0x100  // read every record into an array
 
 struct read_save {
     char **argv;
@@ -248,6 +250,10 @@ int b_read(int argc, char *argv[], Shbltin_t *context) {
                 flags |= A_FLAG;
                 break;
             }
+            case 'l': {
+                flags |= L_FLAG;
+                break;
+            }
             case 'C': {
                 flags |= C_FLAG;
                 method = "ksh";
@@ -401,7 +407,7 @@ bypass:
     readfn = (flags & C_FLAG) ? methods[mindex].fun : 0;
     r = sh_readline(shp, argv, readfn, fd, flags, len, timeout);
     shp->nextprompt = save_prompt;
-    if (r == 0) {
+    if (r == 0 && !(flags & L_FLAG)) {
         r = (sfeof(shp->sftable[fd]) || sferror(shp->sftable[fd]));
         if (r && fd == shp->cpipe[0] && errno != EINTR) sh_pclose(shp->cpipe);
     }
@@ -422,6 +428,85 @@ static_fn void timedout(void *handle) {
     sh_exit(tp->shp, 1);
 }
 
+//
+// Read the rest of the input into the indexed array <np>, one record ending in the delimiter per
+// element. The input is copied a buffer at a time into a single block and each delimiter is
+// overwritten with a null byte, so the elements can be left pointing into the block. If the input
+// has not all been read after <timeout> milliseconds the array is left unset and 1 is returned.
+//
+static_fn int read_records(Shell_t *shp, Namval_t *np, Sfio_t *iop, int flags, long timeout) {
+    char delim[MB_LEN_MAX + 1];
+    char *cp, *dp, *end;
+    char *volatile block;
+    char **vals;
+    volatile size_t size = 0, max = 4 * SF_BUFSIZE;
+    int dlen = 1, n = 0, jmpval;
+    bool share;
+    Timer_t *volatile timeslot = NULL;
+    checkpt_t buff;
+
+    delim[0] = '\n';
+    if (flags & (1 << D_FLAG)) {
+        wchar_t c = ((unsigned)flags) >> (D_FLAG + 1);
+        mbstate_t state;
+        memset(&state, 0, sizeof(state));
+        if (c < 0x80 || !mbwide() || (dlen = mbconv(delim, c, &state)) <= 0) {
+            delim[0] = c;
+            dlen = 1;
+        }
+    }
+    // The whole input is consumed, so there is nothing to leave in place for other readers.
+    share = (sfset(iop, SF_SHARE, 0) & SF_SHARE) != 0;
+    block = malloc(sizeof(void *) + max + 1);
+    sh_pushcontext(shp, &buff, 1);
+    jmpval = sigsetjmp(buff.buff, 0);
+    if (!jmpval) {
+        if (timeout) {
+            static struct timeout tmout;  // static for the same reason as in sh_readline()
+            tmout.shp = shp;
+            tmout.iop = iop;
+            timeslot = sh_timeradd(timeout, 0, timedout, &tmout);
+        }
+        while ((cp = sfreserve(iop, SF_UNBOUND, 0))) {
+            ssize_t r = sfvalue(iop);
+            if (size + r > max) {
+                while (size + r > max) max *= 2;
+                block = realloc(block, sizeof(void *) + max + 1);
+            }
+            memcpy(block + sizeof(void *) + size, cp, r);
+            size += r;
+        }
+    }
+    if (timeslot) timerdel(timeslot);
+    sh_popcontext(shp, &buff);
+    if (share) sfset(iop, SF_SHARE, 1);
+    if (jmpval) {
+        free(block);
+        if (jmpval > 1) siglongjmp(shp->jmplist->buff, jmpval);
+        return 1;
+    }
+    cp = block + sizeof(void *);
+    end = cp + size;
+    *end = 0;
+    // Count the records so the array can be sized once.
+    for (dp = cp; dp < end && (dp = memchr(dp, delim[0], end - dp)); dp++) {
+        if (dlen == 1 || (dp + dlen <= end && memcmp(dp, delim, dlen) == 0)) n++;
+    }
+    if (size && (size < (size_t)dlen || memcmp(end - dlen, delim, dlen))) n++;
+    vals = malloc((n + 1) * sizeof(char *));
+    for (n = 0; cp < end; cp = dp + dlen) {
+        for (dp = cp; (dp = memchr(dp, delim[0], end - dp)); dp++) {
+            if (dlen == 1 || (dp + dlen <= end && memcmp(dp, delim, dlen) == 0)) break;
+        }
+        if (!dp) dp = end;
+        *dp = 0;
+        vals[n++] = cp;
+    }
+    nv_loadvec(np, n, vals, block);
+    free(vals);
+    return n == 0;
+}
+
 //
 // This is the code to read a line and to split it into tokens.
 // <names> is an array of variable names.
@@ -445,6 +530,7 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
     char use_stak = 0;
     volatile char was_write = 0;
     volatile char was_share = 1;
+    volatile bool readahead = false;
     volatile int keytrap;
     int rel, wrd;
     long array_index = 0;
@@ -470,7 +556,7 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
         if ((flags & V_FLAG) && shp->gd->ed_context) {
             ((struct edit *)shp->gd->ed_context)->e_default = np;
         }
-        if (flags & A_FLAG) {
+        if (flags & (A_FLAG | L_FLAG)) {
             Namarr_t *ap;
             flags &= ~A_FLAG;
             array_index = 1;
@@ -497,7 +583,9 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
         } else {
             np = REPLYNOD;
         }
+        if (flags & L_FLAG) nv_unset(np);
     }
+    if (flags & L_FLAG) return read_records(shp, np, iop, flags, timeout);
     keytrap = ep ? ep->e_keytrap : 0;
     if (size || (flags >> D_FLAG)) {  // delimiter not new-line or fixed size read
         if ((shp->fdstatus[fd] & IOTTY) && !keytrap) tty_raw(sffileno(iop), 1);
@@ -550,7 +638,11 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
         size = nv_size(np);
     }
     was_write = (sfset(iop, SF_WRITE, 0) & SF_WRITE) != 0;
-    if (sffileno(iop) == 0) was_share = (sfset(iop, SF_SHARE, shp->redir0 != 2) & SF_SHARE) != 0;
+    if (sffileno(iop) == 0) {
+        // Nothing but read consumes the input of the loop so the stream need not be shared.
+        readahead = shp->readahead && shp->readahead == shp->topfd;
+        was_share = (sfset(iop, SF_SHARE, shp->redir0 != 2 && !readahead) & SF_SHARE) != 0;
+    }
     if (timeout || (shp->fdstatus[fd] & (IOTTY | IONOSEEK))) {
         sh_pushcontext(shp, &buff, 1);
         jmpval = sigsetjmp(buff.buff, 0);
@@ -566,7 +658,7 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
         }
     }
     if (flags & (N_FLAG | NN_FLAG)) {
-        char buf[256], *cur, *end, *up, *v;
+        char buf[256], *cur, *end, *up, *v, *nl;
         char *var = buf;
 
         // Reserved buffer.
@@ -607,9 +699,10 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
                         m = (cp = sfreserve(iop, c, SF_LOCKR)) ? sfvalue(iop) : 0;
                     }
                 }
-                if (m > 0 && (flags & N_FLAG) && !binary && (v = memchr(cp, '\n', m))) {
-                    *v++ = 0;
-                    m = v - (char *)cp;
+                // The newline is only replaced in the copy, the rest of the buffer may be unread.
+                nl = NULL;
+                if (m > 0 && (flags & N_FLAG) && !binary && (nl = memchr(cp, '\n', m))) {
+                    m = nl + 1 - (char *)cp;
                 }
                 if ((c = m) > size) c = size;
                 if (c > 0) {
@@ -630,6 +723,7 @@ int sh_readline(Shell_t *shp, char **names, void *readfn, volatile int fd, int f
                     // never happen so assert it can't happen. Coverity CID#340037.
                     assert(cur);
                     if (cur != (char *)cp) memcpy(cur, cp, c);
+                    if (nl && nl < (char *)cp + c) cur[nl - (char *)cp] = 0;
                     if (f) sfread(iop, cp, c);
                     cur += c;
                     if (!binary && mbwide()) {
@@ -935,7 +1029,11 @@ done:
 
     if (timeout || (shp->fdstatus[fd] & (IOTTY | IONOSEEK))) sh_popcontext(shp, &buff);
     if (was_write) sfset(iop, SF_WRITE, 1);
-    if (!was_share) sfset(iop, SF_SHARE, 0);
+    if (!was_share) {
+        sfset(iop, SF_SHARE, 0);
+    } else if (readahead) {
+        sfset(iop, SF_SHARE, 1);
+    }
     nv_close(np);
     if ((shp->fdstatus[fd] & IOTTY) && !keytrap) tty_cooked(sffileno(iop));
     if (flags & S_FLAG) hist_flush(shp->gd->hist_ptr);
@@ -70,6 +70,7 @@ struct tdata {
     char *help;
     char aflag;
     bool pflag;
+    bool oflag;
     int argnum;
     nvflag_t scanmask;
     Dt_t *scanroot;
@@ -256,6 +257,10 @@ int b_typeset(int argc, char *argv[], Shbltin_t *context) {
                 nvflags |= NV_ARRAY;
                 break;
             }
+            case 'O': {
+                tdata.oflag = true;
+                break;
+            }
             case 'C': {
                 nvflags |= NV_COMVAR;
                 break;
@@ -753,7 +758,9 @@ static_fn int setall(char **argv, nvflag_t flag, Dt_t *troot, struct tdata *tp)
                             nv_onattr(np, NV_NOFREE);
                         }
                     }
+                    shp->assoc_order = tp->oflag;
                     nv_setarray(np, nv_associative);
+                    shp->assoc_order = false;
                 } else if (comvar && !nv_isvtree(np) && !nv_rename(np, flag | NV_COMVAR)) {
                     nv_setvtree(np);
                 }
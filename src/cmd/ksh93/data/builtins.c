@@ -127,6 +127,7 @@ const struct shtable3 shtab_builtins[] = {
     {CMDLIST(uname)},
     {CMDLIST(wc)},
     {CMDLIST(sync)},
+    {CMDLIST(parallel)},
     {"", 0, NULL}};
 
 #if SHOPT_COSHELL
@@ -213,6 +214,8 @@ const char sh_set[] =
     "with leading 0.]"
     "[+markdirs?A trailing \b/\b is appended to directories "
     "resulting from pathname expansion.]"
+    "[+memstats?When the shell exits it writes the memory held by "
+    "each of the categories of \b.sh.mem\b to standard error.]"
     "[+monitor?Equivalent to \b-m\b.]"
     "[+multiline?Use multiple lines when editing lines that are "
     "longer than the window width.]"
@@ -995,6 +998,37 @@ const char sh_optlet[] = "[-1c?@(#)$Id: let (AT&T Research) 2000-04-02 $\n]" USA
                          "}"
                          "[+SEE ALSO?\bexpr\b(1), \btest\b(1), \bksh\b(1)]";
 
+const char sh_optparallel[] =
+    "[-1c?\n@(#)$Id: parallel (ksh) 2026-10-17 $\n]" USAGE_LICENSE
+    "[+NAME?parallel - run a command for each line of input, several at a time]"
+    "[+DESCRIPTION?\bparallel\b reads arguments from standard input, one per line, "
+    "and runs \acommand\a with the given \aarg\as followed by \acount\a of the "
+    "arguments read, until all the arguments have been used.  Empty lines are "
+    "ignored.  Up to \ajobs\a of the commands run at the same time, each in a child "
+    "process whose standard input is \b/dev/null\b.  \acommand\a may be a "
+    "function or built-in as well as a program.]"
+    "[+?The standard output of each command is kept in a temporary file and "
+    "written to the standard output of \bparallel\b in the order the arguments were "
+    "read, so the output of the commands is never interleaved.  Standard error is "
+    "not kept.]"
+    "[+?When a signal that has a trap arrives the trap is run and \bparallel\b "
+    "carries on.  If \bparallel\b is interrupted by any other signal it sends "
+    "\bSIGTERM\b to the commands that are running, or to their process groups "
+    "when job control is on, waits for them and does not run the rest.]"
+    "[j]#[jobs?Run at most \ajobs\a commands at a time.  The default is the number "
+    "of processors that are online.]"
+    "[n]#[count:=1?Append \acount\a arguments to each \acommand\a.  The last "
+    "command gets fewer if there are not enough.]"
+    "\n"
+    "\ncommand [arg ...]\n"
+    "\n"
+    "[+EXIT STATUS?]{"
+    "[+0?Every command exited with status 0.]"
+    "[+>0?The exit status of the first command, in the order of the arguments, that "
+    "did not exit with status 0.]"
+    "}"
+    "[+SEE ALSO?\bxargs\b(1), \bwait\b(1)]";
+
 const char sh_optprint[] =
     "[-1c?\n@(#)$Id: print (AT&T Research) 2014-05-25 $\n]" USAGE_LICENSE
     "[+NAME?print - write arguments to standard output]"
@@ -1223,6 +1257,11 @@ const char sh_optread[] =
     "[a?Unset \avar\a and then create an indexed array containing each field in "
     "the line starting at index 0.]"
     "[d]:[delim?Read until delimiter \adelim\a instead of to the end of line.]"
+    "[l?Unset \avar\a and then create an indexed array containing each of the "
+    "remaining lines, or records ending in \adelim\a, starting at index 0.  The "
+    "lines are not split into fields and \b\\\b is not treated specially.  With "
+    "\b-t\b the array is left unset if the input has not ended in time.  The "
+    "exit status is non-zero only if there was nothing to read or it timed out.]"
 #if SUPPORT_JSON
     "[m]:[method?Unset \avar\a and read \avar\a as a compound variable in "
     "the specified \amethod\a. Currently only \bjson\b and \bksh\b methods "
@@ -1613,6 +1652,9 @@ const char sh_opttypeset[] =
     "\bwctrans\b(3) such as \btolower\b or \btoupper\b.  When the option "
     "value \bmapping\b is omitted and there are no operands, all mapped "
     "variables are displayed.]"
+    "[O?Used with \b-A\b.  Each associative array that is created lists "
+    "its subscripts in the order they were first assigned rather than in "
+    "sorted order.]"
     "[R]#?[n?Right justify.  If \an\a is given it represents the field width.  If "
     "the \b-Z\b attribute is also specified, then zeros will "
     "be used as the fill character.  Otherwise, spaces are used.]"
@@ -1756,6 +1798,10 @@ const char sh_optwait[] =
     "[+?If one ore more \ajob\a operands is a process id or process group id "
     "not known by the current shell environment, \bwait\b treats each "
     "of them as if it were a process that exited with status 127.]"
+    "[n?Wait until any one of the \ajob\as, or any job if there are no \ajob\a "
+    "operands, has completed and exit with its exit status.  A job that "
+    "completed before \bwait\b was invoked and has not been waited for is "
+    "reported at once.  The exit status is 127 if there is no such job.]"
     "\n"
     "\n[job ...]\n"
     "\n"
@@ -102,6 +102,7 @@ const Shtable_t shtab_options[] = {{"allexport", SH_ALLEXPORT},
                                    {bashopt("mailwarn", SH_MAILWARN)},
 #endif  // SHOPT_BASH
                                    {"markdirs", SH_MARKDIRS},
+                                   {"memstats", SH_MEMSTATS},
                                    {"monitor", SH_MONITOR},
                                    {"multiline", SH_MULTILINE},
                                    {"notify", SH_NOTIFY},
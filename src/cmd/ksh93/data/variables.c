@@ -100,6 +100,7 @@ const struct shtable2 shtab_variables[] = {
     {".sh.pwdfd", NV_INTEGER, NULL},
     {".sh.sig", 0, NULL},
     {".sh.op_astbin", NV_NOFREE, (char *)e_astbin},
+    {".sh.mem", 0, NULL},
     {"SH_OPTIONS", 0, NULL},
     {"SHLVL", NV_INTEGER | NV_NOFREE | NV_EXPORT, NULL},
     {"COMP_CWORD", NV_INTEGER | NV_SHORT | NV_UNSIGN, NULL},
@@ -136,10 +137,37 @@ const Shtable_t shtab_stats[] = {{"arg_cachehits", NV_RDONLY | NV_MINIMAL | NV_N
                                  {"globs", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"linesread", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"nv_cachehit", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
+                                 {"nv_cachemiss", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"nv_opens", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
+                                 {"parse_cachehit",
+                                  NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
+                                 {"parse_cachemiss",
+                                  NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"pathsearch", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"posixfuncall", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"simplecmds", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"spawns", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"subshell", NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER},
                                  {"", 0}};
+
+// The fields of .sh.mem, three for each MEM_* category in the order of struct Memstat.
+#define MEMFIELD (NV_RDONLY | NV_MINIMAL | NV_NOFREE | NV_INTEGER | NV_LONG)
+const Shtable_t shtab_mem[] = {{"vars_count", MEMFIELD},
+                               {"vars_bytes", MEMFIELD},
+                               {"vars_peak", MEMFIELD},
+                               {"arrays_count", MEMFIELD},
+                               {"arrays_bytes", MEMFIELD},
+                               {"arrays_peak", MEMFIELD},
+                               {"functions_count", MEMFIELD},
+                               {"functions_bytes", MEMFIELD},
+                               {"functions_peak", MEMFIELD},
+                               {"history_count", MEMFIELD},
+                               {"history_bytes", MEMFIELD},
+                               {"history_peak", MEMFIELD},
+                               {"stk_count", MEMFIELD},
+                               {"stk_bytes", MEMFIELD},
+                               {"stk_peak", MEMFIELD},
+                               {"heap_count", MEMFIELD},
+                               {"heap_bytes", MEMFIELD},
+                               {"heap_peak", MEMFIELD},
+                               {"", 0}};
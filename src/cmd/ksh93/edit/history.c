@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -46,6 +47,10 @@
 
 #define hist_ind(hp, c) ((int)((c) & (hp)->histmask))
 
+// Bytes charged to .sh.mem for a history whose offsets are masked by <mask>, counting the buffer
+// of its stream.
+#define hist_memsize(mask) (sizeof(History_t) + (mask) * sizeof(off_t) + HIST_BSIZE)
+
 #include "defs.h"
 #include "history.h"
 #include "io.h"
@@ -62,6 +67,8 @@ static History_t *hist_trim(History_t *, int);
 static int hist_nearend(History_t *, Sfio_t *, off_t);
 static int hist_check(int);
 static int hist_clean(int);
+static void hist_unmap(History_t *);
+static int hist_read(History_t *, off_t, const char *, int *);
 #ifdef SF_BUFCONST
 static ssize_t hist_write(Sfio_t *, const void *, size_t, Sfdisc_t *);
 static int hist_exceptf(Sfio_t *, int, void *, Sfdisc_t *);
@@ -191,6 +198,7 @@ retry:
     }
 
     shgd->hist_ptr = hist_ptr = hp;
+    sh_memalloc(MEM_HISTORY, hist_memsize(histmask));
     hp->histshell = shp;
     hp->histsize = maxlines;
     hp->histmask = histmask;
@@ -270,11 +278,13 @@ retry:
 // Close the history file and free the space.
 //
 void hist_close(History_t *hp) {
+    hist_unmap(hp);
     sfclose(hp->histfp);
     if (hp->auditfp) {
         if (hp->tty) free(hp->tty);
         sfclose(hp->auditfp);
     }
+    sh_memfree(MEM_HISTORY, hist_memsize(hp->histmask));
     free(hp);
     hist_ptr = NULL;
     shgd->hist_ptr = NULL;
@@ -386,11 +396,13 @@ static History_t *hist_trim(History_t *hp, int n) {
         sfwrite(hist_new->histfp, buff, c);
     }
     hist_cancel(hist_new);
+    hist_unmap(hist_old);
     sfclose(hist_old->histfp);
     if (tmpname) {
         unlink(tmpname);
         free(tmpname);
     }
+    sh_memfree(MEM_HISTORY, hist_memsize(hist_old->histmask));
     free(hist_old);
     hist_ptr = hist_new;
     return hist_ptr;
@@ -727,6 +739,90 @@ void hist_list(History_t *hp, Sfio_t *outfile, off_t offset, int last, const cha
     return;
 }
 
+//
+// Map the history file into memory so that commands can be searched for without reading them
+// through the stream, and map it again if its size has changed since. The file is mapped by the
+// first search rather than by sh_histinit() so that starting the shell costs nothing more. Return
+// the mapping or NULL if the file could not be mapped.
+//
+static char *hist_map(History_t *hp) {
+    struct stat statb;
+    void *addr;
+
+    if (fstat(sffileno(hp->histfp), &statb) < 0) statb.st_size = 0;
+    if (hp->histmap && (size_t)statb.st_size == hp->histmapsize) return hp->histmap;
+    // The file has grown, or shrunk if it was rewritten, so map it again.
+    hist_unmap(hp);
+    if (statb.st_size <= 0 || (off_t)(size_t)statb.st_size != statb.st_size) return NULL;
+    addr = mmap(NULL, (size_t)statb.st_size, PROT_READ, MAP_SHARED, sffileno(hp->histfp), 0);
+    if (addr == MAP_FAILED) return NULL;
+    hp->histmap = addr;
+    hp->histmapsize = (size_t)statb.st_size;
+    return hp->histmap;
+}
+
+//
+// Remove the mapping of the history file made by hist_map().
+//
+static void hist_unmap(History_t *hp) {
+    if (!hp->histmap) return;
+    munmap(hp->histmap, hp->histmapsize);
+    hp->histmap = NULL;
+    hp->histmapsize = 0;
+}
+
+//
+// Return the first occurrence of the <n> byte string <string> in the <len> bytes at <cp>.
+//
+static const char *hist_memmem(const char *cp, size_t len, const char *string, size_t n) {
+#if _lib_memmem
+    return memmem(cp, len, string, n);
+#else
+    const char *last = cp + len - n;
+
+    if (len < n) return NULL;
+    while ((cp = memchr(cp, *string, last - cp + 1))) {
+        if (!memcmp(cp, string, n)) return cp;
+        if (cp++ == last) break;
+    }
+    return NULL;
+#endif
+}
+
+//
+// Search the command at <offset> for <string> the way hist_match() does, in the mapping made by
+// hist_map() if the command is in it and otherwise by reading it from the history file.
+//
+static int hist_search(History_t *hp, off_t offset, const char *string, int *coffset) {
+    const char *first, *cp, *end, *mp;
+    size_t n = strlen(string);
+    int c, line = 0;
+
+    // An empty string matches at the terminating null byte, which the loop below leaves to
+    // hist_read().
+    if (!hp->histmap || offset < 0 || (size_t)offset >= hp->histmapsize || !n) {
+        return hist_read(hp, offset, string, coffset);
+    }
+    first = hp->histmap + offset;
+    if (!(end = memchr(first, 0, hp->histmapsize - offset))) {
+        return hist_read(hp, offset, string, coffset);
+    }
+    if (!coffset) return (size_t)(end - first) >= n && memcmp(first, string, n) == 0 ? 0 : -1;
+    for (cp = first; (mp = hist_memmem(cp, end - cp, string, n));) {
+        // Only a match that starts a character counts, and only newline characters are lines.
+        while (cp < mp) {
+            if (*cp == '\n') line++;
+            c = mblen(cp, MB_CUR_MAX);
+            cp += c < 1 ? 1 : c;
+        }
+        if (cp == mp) {
+            *coffset = (int)(mp - first);
+            return line;
+        }
+    }
+    return -1;
+}
+
 //
 // Find index for last line with given string. If flag==0 then line must begin with string. Set
 // direction < 1 for backwards search.
@@ -761,10 +857,12 @@ Histloc_t hist_find(History_t *hp, char *string, int index1, int flag, int direc
     } else if (index1 >= index2) {
         return location;
     }
+    // The commands are found with the offsets kept in histcmds[] and searched in place.
+    hist_map(hp);
     while (index1 != index2) {
         direction > 0 ? ++index1 : --index1;
         offset = hist_tell(hp, index1);
-        if ((location.hist_line = hist_match(hp, offset, string, coffset)) >= 0) {
+        if ((location.hist_line = hist_search(hp, offset, string, coffset)) >= 0) {
             location.hist_command = index1;
             return location;
         }
@@ -781,6 +879,15 @@ Histloc_t hist_find(History_t *hp, char *string, int index1, int flag, int direc
 // Returns the line number of the match if successful, otherwise -1.
 //
 int hist_match(History_t *hp, off_t offset, char *string, int *coffset) {
+    hist_map(hp);
+    return hist_search(hp, offset, string, coffset);
+}
+
+//
+// Search for <string> in the command at <offset> read from the history file, for a command that
+// is not in the mapping made by hist_map().
+//
+static int hist_read(History_t *hp, off_t offset, const char *string, int *coffset) {
     char *first, *cp;
     int m, n, c = 1, line = 0;
 
@@ -924,6 +1031,7 @@ static int hist_exceptf(Sfio_t *fp, int type, Sfdisc_t *handle)
         int newfd = open(hp->histname, O_BINARY | O_APPEND | O_CREAT | O_RDWR | O_CLOEXEC,
                          S_IRUSR | S_IWUSR);
         int oldfd = sffileno(fp);
+        hist_unmap(hp);
         sh_close(oldfd);
         if (newfd == -1) goto fail;
 
@@ -86,6 +86,7 @@ extern int b_read(int, char *[], Shbltin_t *);
 extern int b_ulimit(int, char *[], Shbltin_t *);
 extern int b_umask(int, char *[], Shbltin_t *);
 extern int b_wait(int, char *[], Shbltin_t *);
+extern int b_parallel(int, char *[], Shbltin_t *);
 extern int b_whence(int, char *[], Shbltin_t *);
 
 extern int b_print(int, char *[], Shbltin_t *);
@@ -146,6 +147,7 @@ extern const char sh_optjobs[];
 extern const char sh_optkill[];
 extern const char sh_optksh[];
 extern const char sh_optlet[];
+extern const char sh_optparallel[];
 extern const char sh_optprint[];
 extern const char sh_optprintf[];
 extern const char sh_optpwd[];
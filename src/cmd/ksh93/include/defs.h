@@ -237,6 +237,7 @@ extern char **sh_envgen(Shell_t *);
 extern void sh_envnolocal(Namval_t *, void *);
 extern Sfdouble_t sh_arith(Shell_t *, const char *);
 extern void *sh_arithcomp(Shell_t *, char *);
+extern void sh_arithforget(Namval_t *);
 extern pid_t sh_fork(Shell_t *, int, int *);
 extern pid_t _sh_fork(Shell_t *, pid_t, int, int *);
 extern char *sh_mactrim(Shell_t *, char *, int);
@@ -337,16 +338,46 @@ extern const char e_dict[];
 #define STAT_GLOBS 5
 #define STAT_READS 6
 #define STAT_NVHITS 7
-#define STAT_NVOPEN 8
-#define STAT_PATHS 9
-// #define STAT_SVFUNCT 10
-#define STAT_SCMDS 11
-#define STAT_SPAWN 12
-#define STAT_SUBSHELL 13
+#define STAT_NVMISS 8
+#define STAT_NVOPEN 9
+#define STAT_PCHIT 10
+#define STAT_PCMISS 11
+#define STAT_PATHS 12
+// #define STAT_SVFUNCT 13
+#define STAT_SCMDS 14
+#define STAT_SPAWN 15
+#define STAT_SUBSHELL 16
 extern const Shtable_t shtab_stats[];
 #define sh_stats(x) (shgd->stats[(x)]++)
 extern const Shtable_t shtab_siginfo[];
 
+// Memory accounting, reported by .sh.mem and the memstats option. The order of the categories
+// and of the members of struct Memstat is the order of the fields in shtab_mem.
+#define MEM_VARS 0       // variable, function and builtin nodes
+#define MEM_ARRAYS 1     // array heads and the blocks their elements live in
+#define MEM_FUNCTIONS 2  // function definitions
+#define MEM_HISTORY 3    // history file buffers
+#define MEM_STK 4        // stacks holding parse trees and expansions
+#define MEM_HEAP 5       // everything the C library has handed out
+#define MEM_NCLASS 6
+struct Memstat {
+    int64_t count;  // objects currently allocated
+    int64_t bytes;  // bytes they hold
+    int64_t peak;   // most bytes held at once
+};
+extern struct Memstat sh_mem[MEM_NCLASS];
+extern const Shtable_t shtab_mem[];
+extern void sh_memupdate(void);
+extern void sh_memdump(Sfio_t *);
+
+// Charge <n> more bytes to category <c>.
+static inline void sh_memgrow(int c, ssize_t n) {
+    struct Memstat *mp = &sh_mem[c];
+    if ((mp->bytes += n) > mp->peak) mp->peak = mp->bytes;
+}
+#define sh_memalloc(c, n) (sh_mem[(c)].count++, sh_memgrow((c), (ssize_t)(n)))
+#define sh_memfree(c, n) (sh_mem[(c)].count--, sh_mem[(c)].bytes -= (ssize_t)(n))
+
 #define timeofday(p) gettimeofday(p, NULL)
 
 // sigqueue() may not be available on some platforms (e.g., macOS) or doesn't work on others
@@ -61,7 +61,9 @@ typedef struct {
     Sfio_t *auditfp;
     char *tty;
     int auditmask;
-    off_t histcmds[2];  // offset for recent commands, must be last
+    char *histmap;       // the history file mapped by hist_find() or NULL
+    size_t histmapsize;  // the size of the mapping
+    off_t histcmds[2];   // offset for recent commands, must be last
 } History_t;
 
 typedef struct {
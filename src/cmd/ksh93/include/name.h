@@ -449,10 +449,15 @@ static inline int nv_isattr(const Namval_t *np, const nvflag_t mask) { return np
 
 static inline bool nv_isarray(const Namval_t *np) { return nv_isattr(np, NV_ARRAY) == NV_ARRAY; }
 
+// Incremented whenever an exported variable or the variable scope changes so that sh_envgen()
+// knows when the environment list it cached for the previous command is out of date.
+extern unsigned int sh_envserial;
+
 static inline void nv_onattr(Namval_t *np, nvflag_t nvflag) {
     nv_isvalid(nvflag);
     nv_isvalid(np->nvflag);
     nvflag &= ~(~(nvflag_t)0U << NV_nbits);  // strip bits valid for nv_open() but not nvflag
+    if ((np->nvflag | nvflag) & NV_EXPORT) sh_envserial++;
     np->nvflag |= nvflag;
 }
 
@@ -460,6 +465,7 @@ static inline void nv_offattr(Namval_t *np, nvflag_t nvflag) {
     nv_isvalid(nvflag);
     nv_isvalid(np->nvflag);
     nvflag &= ~(~(nvflag_t)0U << NV_nbits);  // strip bits valid for nv_open() but not nvflag
+    if (np->nvflag & NV_EXPORT) sh_envserial++;
     np->nvflag &= ~nvflag;
 }
 
@@ -467,6 +473,7 @@ static inline void nv_setattr(Namval_t *np, nvflag_t nvflag) {
     nv_isvalid(nvflag);
     nv_isvalid(np->nvflag);
     nvflag &= ~(~(nvflag_t)0U << NV_nbits);  // strip bits valid for nv_open() but not nvflag
+    if ((np->nvflag | nvflag) & NV_EXPORT) sh_envserial++;
     np->nvflag = nvflag;
 }
 
@@ -520,7 +527,9 @@ extern int nv_clone(Namval_t *, Namval_t *, nvflag_t);
 extern void nv_close(Namval_t *);
 extern Namval_t *nv_create(const char *, Dt_t *, nvflag_t, Namfun_t *);
 extern void nv_delete(Namval_t *, Dt_t *, nvflag_t);
+extern void nv_freenode(Namval_t *);
 extern Dt_t *nv_dict(Namval_t *);
+extern void nv_nocache(void);
 extern Sfdouble_t nv_getn(Namval_t *, Namfun_t *);
 extern Sfdouble_t nv_getnum(Namval_t *);
 extern char *nv_getv(Namval_t *, Namfun_t *);
@@ -541,6 +550,7 @@ extern char *nv_setdisc(Namval_t *, const void *, Namval_t *, Namfun_t *);
 extern void nv_setref(Namval_t *, Dt_t *, nvflag_t);
 extern int nv_settype(Namval_t *, Namval_t *, nvflag_t);
 extern void nv_setvec(Namval_t *, int, int, char *[]);
+extern void nv_loadvec(Namval_t *, int, char *[], void *);
 extern void nv_setvtree(Namval_t *);
 extern int nv_setsize(Namval_t *, int);
 extern Namfun_t *nv_disc(Namval_t *, Namfun_t *, Nvdisc_op_t);
@@ -660,6 +670,7 @@ extern bool nv_arrayisset(Namval_t *, Namarr_t *);
 extern bool nv_arraysettype(Namval_t *, Namval_t *, const char *, nvflag_t);
 extern int nv_aimax(Namval_t *);
 extern struct Value *nv_aivec(Namval_t *, unsigned char **);
+extern struct Value *nv_aivalue(Namval_t *, bool);
 extern int nv_aipack(Namarr_t *);
 extern bool nv_atypeindex(Namval_t *, const char *);
 extern bool nv_setnotify(Namval_t *, char **);
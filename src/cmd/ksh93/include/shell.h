@@ -78,6 +78,7 @@ typedef void (*Shinit_f)(Shell_t *, int);
 #define SH_RC 35
 #define SH_SHOWME 36
 #define SH_LETOCTAL 37
+#define SH_MEMSTATS 38
 
 // Error messages.
 extern const char e_defpath[];
@@ -162,6 +163,7 @@ struct Shell_s {
     pid_t *procsub;  // pids for >() argument
     int nprocsub;    // number of pids in procsub
     int topfd;
+    int readahead;  // topfd inside a loop whose standard input only read consumes
     int errorfd;
     int savesig;
     unsigned char *sigflag;  // pointer to signal states
@@ -169,7 +171,7 @@ struct Shell_s {
     char login_sh;
     char lastbase;
     char forked;
-    char binscript;
+    char binscript;  // one more than the format version of the compiled script being read
     char deftype;
     char funload;
     char used_pos;  // used postional parameter
@@ -188,6 +190,7 @@ struct Shell_s {
     char redir0;            // redirect of 0
     char intrace;           // set when trace expands PS4
     char *readscript;       // set before reading a script
+    void *parsecache;       // parse cache entry waiting to be recorded
     int subdup;             // bitmask for dups of 1
     int *inpipe;            // input pipe pointer
     int *outpipe;           // output pipe pointer
@@ -250,6 +253,7 @@ struct Shell_s {
     Shopt_t offoptions;
     Shopt_t glob_options;
     Namval_t *typeinit;
+    bool assoc_order;  // associative arrays created now keep insertion order (typeset -O)
     Namfun_t nvfun;
     char *mathnodes;
     void *coshell;
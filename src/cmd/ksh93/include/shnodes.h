@@ -196,7 +196,15 @@ union Shnode_u {
 extern void sh_freeup(Shell_t *);
 extern void sh_funstaks(struct slnod *, int);
 extern Sfio_t *sh_subshell(Shell_t *, Shnode_t *, volatile int, int);
-extern int sh_tdump(Sfio_t *, const Shnode_t *);
-extern Shnode_t *sh_trestore(Shell_t *, Sfio_t *);
+extern int sh_tdump(Sfio_t *, const Shnode_t *, int);
+extern Shnode_t *sh_trestore(Shell_t *, Sfio_t *, int);
+
+// Format version of the trees in the parse cache; the highest version sh_trestore() can read.
+#define PCACHE_VERSION 4
+
+extern bool pcache_open(Shell_t *, int, const char *);
+extern void *pcache_claim(Shell_t *, Sfio_t *);
+extern void pcache_record(void *, const Shnode_t *);
+extern void pcache_close(void *, bool);
 
 #endif  // _SHNODES_H
@@ -79,6 +79,7 @@ struct lval {
     Sfdouble_t (*fun)(Sfdouble_t, ...);
     const char *expr;
     const void *ptr;
+    Sflong_t ivalue;  // the value as an integer when isint is set
     int nosub;
     short flag;
     short nargs;
@@ -89,6 +90,7 @@ struct lval {
     char eflag;
     char userfn;
     char isfloat;
+    char isint;  // value is exactly ivalue, so it need not be converted from a Sfdouble_t
 };
 
 struct mathtab {
@@ -152,7 +154,7 @@ typedef struct _arith_ {
 #define A_INCR 34
 #define A_DECR 35
 #define A_PUSHV 36
-// #define A_PUSHL 37
+#define A_PUSHI 37
 #define A_PUSHN 38
 #define A_PUSHF 39
 #define A_STORE 40
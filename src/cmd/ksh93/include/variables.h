@@ -91,15 +91,16 @@
 #define SH_PWDFD (shgd->bltin_nodes + 65)
 #define SH_SIG (shgd->bltin_nodes + 66)
 #define SH_ASTBIN (shgd->bltin_nodes + 67)
-#define OPTIONS (shgd->bltin_nodes + 68)
-#define SHLVL (shgd->bltin_nodes + 69)
-#define COMP_CWORD (shgd->bltin_nodes + 70)
-#define COMP_LINE (shgd->bltin_nodes + 71)
-#define COMP_POINT (shgd->bltin_nodes + 72)
-#define COMP_WORDS (shgd->bltin_nodes + 73)
-#define COMP_KEY (shgd->bltin_nodes + 74)
-#define COMPREPLY (shgd->bltin_nodes + 75)
-#define COMP_WORDBREAKS (shgd->bltin_nodes + 76)
-// #define COMP_TYPE (shgd->bltin_nodes + 77)
+#define SH_MEM (shgd->bltin_nodes + 68)
+#define OPTIONS (shgd->bltin_nodes + 69)
+#define SHLVL (shgd->bltin_nodes + 70)
+#define COMP_CWORD (shgd->bltin_nodes + 71)
+#define COMP_LINE (shgd->bltin_nodes + 72)
+#define COMP_POINT (shgd->bltin_nodes + 73)
+#define COMP_WORDS (shgd->bltin_nodes + 74)
+#define COMP_KEY (shgd->bltin_nodes + 75)
+#define COMPREPLY (shgd->bltin_nodes + 76)
+#define COMP_WORDBREAKS (shgd->bltin_nodes + 77)
+// #define COMP_TYPE (shgd->bltin_nodes + 78)
 
 #endif  // _VARIABLES_H
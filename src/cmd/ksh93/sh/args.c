@@ -492,10 +492,10 @@ int sh_argopts(int argc, char *argv[], void *context) {
                     if (*keylist && *keylist != ':') {
                         struct Namval *np = FETCH_VT(args[c], np);
                         ((struct Node *)cp)->index = strtol(np->nvname, NULL, 10);
-                        ((struct Node *)cp)->bits = bits[c];
                     } else {
                         ((struct Node *)cp)->index = c;
                     }
+                    ((struct Node *)cp)->bits = bits[c];
                     ((struct Node *)cp)->vp = args[c];
                     sp->nptrs[c] = (struct Node *)cp;
                     cp += nodesize;
@@ -58,6 +58,51 @@ static Namval_t Infnod = {.nvname = "Inf"};
 static Namval_t NaNnod = {.nvname = "NaN"};
 static Namval_t FunNode = {.nvname = "?"};
 
+//
+// Expressions evaluated from strings, such as the operands of let, array subscripts and values
+// assigned to integer variables, are compiled once and kept in a cache keyed by their text. They
+// are compiled the way ((...)) is, binding names to global nodes that scope() replaces with locals
+// at run time, so the cache is bypassed in any scope where that would find a different node.
+// nv_delete() calls sh_arithforget() to drop the programs bound to a deleted node; a program that
+// is dropped while it runs is freed when it returns.
+//
+#define ARITH_CACHE 256     // maximum number of cached programs and size of the hash table
+#define ARITH_MAXLEN 1024   // longer expressions are not cached
+#define ARITH_MAXNODES 32   // expressions bound to more nodes are not cached
+#define ARITH_FILTER 1024   // bits in the filter of nodes bound by cached programs
+#define ARITH_LETSTRIP 1    // let strips leading zeros from numbers
+#define ARITH_MBWIDE 2      // names are scanned as multibyte characters
+
+struct Arith_cache {
+    struct Arith_cache *next;     // next entry on the same hash chain
+    struct Arith_cache *lrunext;  // next less recently used entry
+    struct Arith_cache *lruprev;  // next more recently used entry
+    Arith_t *ep;
+    Namval_t **nodes;  // nodes bound into the program
+    unsigned int hash;
+    int nnodes;
+    int len;
+    int last;  // offset of the first character that was not converted
+    int busy;  // number of evaluations in progress
+    int flags;
+    bool dead;  // dropped from the cache while busy
+    char expr[1];
+};
+
+static struct {
+    struct Arith_cache *table[ARITH_CACHE];
+    struct Arith_cache lru;  // list head, lru.lrunext is the most recently used entry
+    int count;
+    uint64_t filter[ARITH_FILTER / 64];
+} arithcache = {.lru = {.lrunext = &arithcache.lru, .lruprev = &arithcache.lru}};
+
+// Nodes bound by the expression being compiled for the cache; n is -1 when not compiling one.
+static struct {
+    int n;
+    bool nocache;
+    Namval_t *nodes[ARITH_MAXNODES];
+} Arith_record = {.n = -1};
+
 struct Mathconst {
     char name[9];
     Sfdouble_t value;
@@ -296,6 +341,104 @@ static_fn Sfdouble_t number(const char *s, char **p, int b, struct lval *lvalue)
     return r;
 }
 
+// Record a node bound by the expression being compiled for the cache.
+static_fn void arith_bind(Namval_t *np) {
+    int n;
+    for (n = 0; n < Arith_record.n; n++) {
+        if (Arith_record.nodes[n] == np) return;
+    }
+    if (n < ARITH_MAXNODES) {
+        Arith_record.nodes[Arith_record.n++] = np;
+    } else {
+        Arith_record.nocache = true;
+    }
+}
+
+// Return the value holder of a variable or indexed array element that no discipline has to see.
+static_fn struct Value *arith_value(Shell_t *shp, Namval_t *np) {
+    if (shp->argaddr) return NULL;
+    if (nv_isattr(np, NV_ARRAY)) return nv_aivalue(np, false);
+    return np->nvfun ? NULL : &np->nvalue;
+}
+
+// Read the value of a signed integer variable without a discipline directly into *ip.
+static_fn bool arith_getint(Shell_t *shp, Namval_t *np, Sflong_t *ip) {
+    struct Value *up;
+
+    if (nv_isattr(np, NV_DOUBLE | NV_UNSIGN | NV_BINARY | NV_REF) != NV_INTEGER) return false;
+    if (!(up = arith_value(shp, np))) return false;
+    if (!FETCH_VTP(up, i32p) || FETCH_VTP(up, const_cp) == Empty) {
+        *ip = 0;
+    } else if (nv_isattr(np, NV_LONG)) {
+        *ip = *FETCH_VTP(up, i64p);
+    } else if (nv_isattr(np, NV_SHORT)) {
+        if (nv_isattr(np, NV_INT16P) == NV_INT16P) {
+            *ip = *FETCH_VTP(up, i16p);
+        } else {
+            *ip = FETCH_VTP(up, i16);
+        }
+    } else {
+        *ip = *FETCH_VTP(up, i32p);
+    }
+    return true;
+}
+
+// Read the value of a double precision variable without a discipline directly into *dp.
+static_fn bool arith_getdouble(Shell_t *shp, Namval_t *np, Sfdouble_t *dp) {
+    struct Value *up;
+
+    if (nv_isattr(np, NV_DOUBLE | NV_UNSIGN | NV_BINARY | NV_REF | NV_SHORT | NV_LONG) !=
+        NV_DOUBLE) {
+        return false;
+    }
+    if (!(up = arith_value(shp, np))) return false;
+    if (!FETCH_VTP(up, dp) || FETCH_VTP(up, const_cp) == Empty) {
+        *dp = 0;
+    } else {
+        *dp = *FETCH_VTP(up, dp);
+    }
+    return true;
+}
+
+// Assign *vp to an element of an indexed int, long or double array that already holds a number
+// in place, the way nv_putval() would, and set *vp to the value assigned. Return false if
+// nv_putval() has to assign it.
+static_fn bool arith_putelem(Shell_t *shp, Namval_t *np, struct lval *lvalue, Sfdouble_t *vp) {
+    Sfdouble_t n = *vp;
+    struct Value *up;
+
+    if (!nv_isattr(np, NV_ARRAY) || shp->subshell || !(up = nv_aivalue(np, true)) ||
+        !FETCH_VTP(up, vp) || FETCH_VTP(up, const_cp) == Empty) {
+        return false;
+    }
+    switch (nv_isattr(np, NV_DOUBLE | NV_UNSIGN | NV_BINARY | NV_REF | NV_SHORT | NV_LONG |
+                              NV_RDONLY | NV_EXPORT)) {
+        case NV_INTEGER | NV_LONG: {
+            if (!lvalue->isint) lvalue->ivalue = (Sflong_t)n;
+            *FETCH_VTP(up, i64p) = lvalue->ivalue;
+            lvalue->isint = 1;
+            *vp = lvalue->ivalue;
+            break;
+        }
+        case NV_INTEGER: {
+            *FETCH_VTP(up, i32p) = (int32_t)(Sflong_t)n;
+            lvalue->ivalue = *FETCH_VTP(up, i32p);
+            lvalue->isint = 1;
+            *vp = lvalue->ivalue;
+            break;
+        }
+        case NV_DOUBLE: {
+            *FETCH_VTP(up, dp) = (double)n;
+            lvalue->isint = 0;
+            *vp = *FETCH_VTP(up, dp);
+            break;
+        }
+        default: { return false; }
+    }
+    shp->argaddr = NULL;
+    return true;
+}
+
 static_fn Sfdouble_t arith(const char **ptr, struct lval *lvalue, int type, Sfdouble_t n) {
     Shell_t *shp = lvalue->shp;
     Sfdouble_t r = 0;
@@ -306,10 +449,22 @@ static_fn Sfdouble_t arith(const char **ptr, struct lval *lvalue, int type, Sfdo
         case ASSIGN: {
             Namval_t *np = (Namval_t *)(lvalue->value);
             np = scope(np, lvalue, 1);
-            nv_putval(np, (char *)&n, NV_LDOUBLE);
+            if (!lvalue->eflag && arith_putelem(shp, np, lvalue, &n)) {
+                r = n;
+                lvalue->value = (char *)np;
+                break;
+            }
+            if (lvalue->isint && !np->nvfun &&
+                nv_isattr(np, NV_DOUBLE | NV_UNSIGN | NV_BINARY | NV_REF | NV_SHORT | NV_LONG) ==
+                    (NV_INTEGER | NV_LONG)) {
+                nv_putval(np, (char *)&lvalue->ivalue, NV_INTEGER | NV_LONG);
+            } else {
+                nv_putval(np, (char *)&n, NV_LDOUBLE);
+            }
             if (lvalue->eflag) lvalue->ptr = nv_hasdisc(np, &ENUM_disc);
             lvalue->eflag = 0;
-            r = nv_getnum(np);
+            lvalue->isint = arith_getint(shp, np, &lvalue->ivalue);
+            r = lvalue->isint ? lvalue->ivalue : nv_getnum(np);
             lvalue->value = (char *)np;
             break;
         }
@@ -350,6 +505,7 @@ static_fn Sfdouble_t arith(const char **ptr, struct lval *lvalue, int type, Sfdo
                         struct Ufunction *rp = FETCH_VT(nq->nvalue, rp);
                         lvalue->nargs = -rp->argc;
                         lvalue->fun = (Math_f)nq;
+                        if (Arith_record.n >= 0) Arith_record.nocache = true;
                         break;
                     }
                     if (fsize <= (sizeof(tp->fname) - 2)) {
@@ -448,6 +604,7 @@ static_fn Sfdouble_t arith(const char **ptr, struct lval *lvalue, int type, Sfdo
                 if (lvalue->isfloat == TYPE_LD) break;
                 if (!np) break;  // this used to also test `&& lvalue->value` but that's redundant
                 lvalue->value = (char *)np;
+                if (Arith_record.n >= 0) arith_bind(np);
                 // Bind subscript later.
                 if (nv_isattr(np, NV_DOUBLE) == NV_DOUBLE) lvalue->isfloat = 1;
                 lvalue->flag = 0;
@@ -520,17 +677,24 @@ static_fn Sfdouble_t arith(const char **ptr, struct lval *lvalue, int type, Sfdo
                     return r;
                 }
             }
-            r = nv_getnum(np);
-            if (nv_isattr(np, NV_INTEGER | NV_BINARY) == (NV_INTEGER | NV_BINARY)) {
-                lvalue->isfloat = (r != (Sflong_t)r) ? TYPE_LD : 0;
-            } else if (nv_isattr(np, (NV_DOUBLE | NV_SHORT)) == (NV_DOUBLE | NV_SHORT)) {
-                lvalue->isfloat = TYPE_F;
-                r = (float)r;
-            } else if (nv_isattr(np, (NV_DOUBLE | NV_LONG)) == (NV_DOUBLE | NV_LONG)) {
-                lvalue->isfloat = TYPE_LD;
-            } else if (nv_isattr(np, NV_DOUBLE) == NV_DOUBLE) {
+            if (arith_getint(shp, np, &lvalue->ivalue)) {
+                lvalue->isint = 1;
+                r = lvalue->ivalue;
+            } else if (arith_getdouble(shp, np, &r)) {
                 lvalue->isfloat = TYPE_D;
-                r = (double)r;
+            } else {
+                r = nv_getnum(np);
+                if (nv_isattr(np, NV_INTEGER | NV_BINARY) == (NV_INTEGER | NV_BINARY)) {
+                    lvalue->isfloat = (r != (Sflong_t)r) ? TYPE_LD : 0;
+                } else if (nv_isattr(np, (NV_DOUBLE | NV_SHORT)) == (NV_DOUBLE | NV_SHORT)) {
+                    lvalue->isfloat = TYPE_F;
+                    r = (float)r;
+                } else if (nv_isattr(np, (NV_DOUBLE | NV_LONG)) == (NV_DOUBLE | NV_LONG)) {
+                    lvalue->isfloat = TYPE_LD;
+                } else if (nv_isattr(np, NV_DOUBLE) == NV_DOUBLE) {
+                    lvalue->isfloat = TYPE_D;
+                    r = (double)r;
+                }
             }
             if ((lvalue->emode & ARITH_ASSIGNOP) && nv_isarray(np)) {
                 lvalue->nosub = nv_aindex(np) + 1;
@@ -564,6 +728,190 @@ void *sh_arithcomp(Shell_t *shp, char *str) {
     return ep;
 }
 
+static_fn unsigned int arith_nodebit(Namval_t *np) {
+    return ((uintptr_t)np >> 4) & (ARITH_FILTER - 1);
+}
+
+static_fn void arith_free(struct Arith_cache *cp) {
+    free(cp->ep);
+    free(cp->nodes);
+    free(cp);
+}
+
+// Remove an entry from the cache, freeing it unless it is running.
+static_fn void arith_drop(struct Arith_cache *cp) {
+    struct Arith_cache **pp = &arithcache.table[cp->hash & (ARITH_CACHE - 1)];
+    while (*pp != cp) pp = &(*pp)->next;
+    *pp = cp->next;
+    cp->lruprev->lrunext = cp->lrunext;
+    cp->lrunext->lruprev = cp->lruprev;
+    arithcache.count--;
+    if (cp->busy) {
+        cp->dead = true;
+    } else {
+        arith_free(cp);
+    }
+}
+
+//
+// Drop the cached programs that are bound to node np, which is being deleted.
+//
+void sh_arithforget(Namval_t *np) {
+    struct Arith_cache *cp, *next;
+    unsigned int bit = arith_nodebit(np);
+    int n;
+
+    if (!(arithcache.filter[bit / 64] & ((uint64_t)1 << (bit % 64)))) return;
+    memset(arithcache.filter, 0, sizeof(arithcache.filter));
+    for (cp = arithcache.lru.lrunext; cp != &arithcache.lru; cp = next) {
+        next = cp->lrunext;
+        for (n = 0; n < cp->nnodes; n++) {
+            if (cp->nodes[n] == np) break;
+        }
+        if (n < cp->nnodes) {
+            arith_drop(cp);
+            continue;
+        }
+        for (n = 0; n < cp->nnodes; n++) {
+            bit = arith_nodebit(cp->nodes[n]);
+            arithcache.filter[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+    }
+}
+
+//
+// Compile the expression str of length len and add it to the cache. Returns NULL if the expression
+// cannot be cached, in which case it has not been evaluated.
+//
+static_fn struct Arith_cache *arith_insert(Shell_t *shp, const char *str, int len,
+                                           unsigned int hash, int flags) {
+    struct Arith_cache *cp, **pp;
+    Arith_t *ep;
+    char *last;
+    int n, n0 = Arith_record.n < 0 ? 0 : Arith_record.n;
+    int saven = Arith_record.n;
+    bool savenocache = Arith_record.nocache;
+
+    cp = malloc(sizeof(struct Arith_cache) + len);
+    if (!cp) return NULL;
+    memcpy(cp->expr, str, len + 1);
+    cp->ep = NULL;
+    // Expressions compiled while this one is being compiled record their nodes after its own.
+    Arith_record.n = n0;
+    Arith_record.nocache = false;
+    ep = arith_compile(shp, cp->expr, &last, arith, ARITH_COMP);
+    n = Arith_record.n - n0;
+    if (!ep || Arith_record.nocache || !(cp->ep = malloc(sizeof(Arith_t) + ep->size)) ||
+        !(cp->nodes = malloc((n ? n : 1) * sizeof(Namval_t *)))) {
+        free(cp->ep);
+        free(cp);
+        Arith_record.n = saven;
+        Arith_record.nocache = savenocache;
+        return NULL;
+    }
+    memcpy(cp->nodes, &Arith_record.nodes[n0], n * sizeof(Namval_t *));
+    Arith_record.n = saven;
+    Arith_record.nocache = savenocache;
+    memcpy(cp->ep, ep, sizeof(Arith_t) + ep->size);
+    cp->ep->code = (unsigned char *)(cp->ep + 1);
+    cp->nnodes = n;
+    cp->hash = hash;
+    cp->len = len;
+    cp->last = last - cp->expr;
+    cp->busy = 0;
+    cp->flags = flags;
+    cp->dead = false;
+    while (n-- > 0) {
+        unsigned int bit = arith_nodebit(cp->nodes[n]);
+        arithcache.filter[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+    if (arithcache.count >= ARITH_CACHE) {
+        struct Arith_cache *xp = arithcache.lru.lruprev;
+        while (xp != &arithcache.lru && xp->busy) xp = xp->lruprev;
+        if (xp != &arithcache.lru) arith_drop(xp);
+    }
+    pp = &arithcache.table[hash & (ARITH_CACHE - 1)];
+    cp->next = *pp;
+    *pp = cp;
+    cp->lrunext = arithcache.lru.lrunext;
+    cp->lruprev = &arithcache.lru;
+    cp->lrunext->lruprev = cp;
+    arithcache.lru.lrunext = cp;
+    arithcache.count++;
+    return cp;
+}
+
+//
+// Evaluate the expression str with strval(), reusing the program compiled for the same text when
+// one is cached.
+//
+static_fn Sfdouble_t arith_strval(Shell_t *shp, const char *str, char **last, int mode) {
+    struct Arith_cache *volatile cp;
+    struct Arith_cache *xp;
+    checkpt_t buff;
+    Sfdouble_t d = 0;
+    const unsigned char *s;
+    unsigned int hash;
+    int len, flags, jmpval, offset;
+    int saven = Arith_record.n;
+    bool savenocache = Arith_record.nocache;
+    char *sp;
+
+    if (shp->namref_root || shp->namespace || sh_isoption(shp, SH_NOEXEC) ||
+        (shp->var_tree != shp->var_base && dtvnext(shp->var_tree) != shp->var_base)) {
+        return strval(shp, str, last, arith, mode);
+    }
+    // The program also depends on the locale, which determines the decimal point and how names
+    // are scanned.
+    flags = getdecimal() << 8;
+    if (mbwide()) flags |= ARITH_MBWIDE;
+    if (shp->bltindata.bnode == SYSLET && !sh_isoption(shp, SH_LETOCTAL)) flags |= ARITH_LETSTRIP;
+    hash = flags;
+    for (s = (const unsigned char *)str; *s; s++) hash = hash * 31 + *s;
+    len = s - (const unsigned char *)str;
+    if (len > ARITH_MAXLEN) return strval(shp, str, last, arith, mode);
+    for (xp = arithcache.table[hash & (ARITH_CACHE - 1)]; xp; xp = xp->next) {
+        if (xp->hash == hash && xp->len == len && xp->flags == flags &&
+            memcmp(xp->expr, str, len) == 0) {
+            break;
+        }
+    }
+    if (xp && xp != arithcache.lru.lrunext) {
+        xp->lruprev->lrunext = xp->lrunext;
+        xp->lrunext->lruprev = xp->lruprev;
+        xp->lrunext = arithcache.lru.lrunext;
+        xp->lruprev = &arithcache.lru;
+        xp->lrunext->lruprev = xp;
+        arithcache.lru.lrunext = xp;
+    }
+    cp = xp;
+    offset = stktell(shp->stk);
+    sp = offset ? stkfreeze(shp->stk, 1) : stkptr(shp->stk, 0);
+    sh_pushcontext(shp, &buff, shp->jmplist->mode);
+    jmpval = sigsetjmp(buff.buff, 0);
+    if (!jmpval) {
+        if (!cp) cp = arith_insert(shp, str, len, hash, flags);
+        if (cp) {
+            // A cached program does not look its names up, which is what stops a name with this
+            // expression as a subscript from being cached by nv_open().
+            nv_nocache();
+            cp->busy++;
+            cp->ep->emode = ARITH_COMP | mode;
+            d = arith_exec(cp->ep);
+            *last = (char *)str + cp->last;
+        } else {
+            d = strval(shp, str, last, arith, mode);
+        }
+    }
+    sh_popcontext(shp, &buff);
+    Arith_record.n = saven;
+    Arith_record.nocache = savenocache;
+    if (cp && --cp->busy == 0 && cp->dead) arith_free(cp);
+    stkset(shp->stk, sp, offset);
+    if (jmpval) siglongjmp(shp->jmplist->buff, jmpval);
+    return d;
+}
+
 // Convert number defined by string to a Sfdouble_t.
 // Ptr is set to the last character processed.
 // If mode>0, an error will be fatal with value <mode>.
@@ -579,7 +927,7 @@ Sfdouble_t sh_strnum(Shell_t *shp, const char *str, char **ptr, int mode) {
     d = number(str, &last, shp->inarith ? 0 : 10, NULL);
     if (*last) {
         if (*last != '.' || last[1] != '.') {
-            d = strval(shp, str, &last, arith, mode);
+            d = arith_strval(shp, str, &last, mode);
             Varsubscript = true;
         }
         if (!ptr && *last && mode > 0) errormsg(SH_DICT, ERROR_exit(1), e_lexbadchar, *last, str);
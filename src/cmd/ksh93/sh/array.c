@@ -46,6 +46,12 @@
 #define ARRAY_CHILD 1
 #define ARRAY_NOFREE 2
 #define ARRAY_UNSET 4
+#define ARRAY_CLASS 0xf8  // size class of an element value kept in the array's store
+#define ARRAY_CSHIFT 3
+// Attributes that have to see every value assigned to an element.
+#define ARRAY_TYPED                                                                        \
+    (NV_INTEGER | NV_BINARY | NV_LTOU | NV_UTOL | NV_LJUST | NV_RJUST | NV_ZFILL | NV_RDONLY | \
+     NV_REF | NV_EXPORT)
 
 // Constants for the `nv_associative()` "op" parameter.
 const Nvassoc_op_t ASSOC_OP_INIT = {ASSOC_OP_INIT_val};
@@ -65,6 +71,7 @@ struct index_array {
     int last;             // index of highest assigned element
     int maxi;             // maximum index for array
     unsigned char *bits;  // bit array for child subscripts
+    struct array_store *store;  // storage for the element strings of a large array
     struct Value val[1];  // array of value holders
 };
 
@@ -75,6 +82,8 @@ struct assoc_array {
     Namval_t *cur;
 };
 
+static_fn void store_disown(struct index_array *);
+
 // Clone the index_array pointed to by `aq` and do what? What does the "scope" in the function name
 // imply?
 static_fn struct index_array *array_scope(Namval_t *np, struct index_array *aq, int flags) {
@@ -91,7 +100,7 @@ static_fn struct index_array *array_scope(Namval_t *np, struct index_array *aq,
         ar->namarr.namfun.nofree &= ~1;
     }
     if (is_associative(&ar->namarr)) {
-        ar->namarr.scope = dtopen(&_Nvdisc, Dtoset);
+        ar->namarr.scope = dtopen(&_Nvdisc, ar->namarr.table->meth);
         dtuserdata(ar->namarr.scope, shp, 1);
         dtview(ar->namarr.scope, ar->namarr.table);
         ar->namarr.table = ar->namarr.scope;
@@ -100,6 +109,7 @@ static_fn struct index_array *array_scope(Namval_t *np, struct index_array *aq,
     ar->namarr.scope = (Dt_t *)aq;
     memset(ar->val, 0, ar->maxi * sizeof(char *));
     ar->bits = (unsigned char *)&ar->val[ar->maxi];
+    if (ar->store) store_disown(ar);
     return ar;
 }
 
@@ -155,6 +165,265 @@ static_fn int arsize(struct index_array *ap, int maxi) {
 
 static_fn struct index_array *array_grow(Namval_t *, struct index_array *, int);
 
+//
+// The strings of the elements of a large indexed array are carved out of a few blocks owned by the
+// array rather than each being allocated on its own. A string gets a chunk of one of the sizes in
+// store_size[], and the index of that size is kept in the ARRAY_CLASS bits of the element. When
+// the element is assigned again or unset the chunk goes on a free list for its size. Class 1 is
+// a string whose chunk size is unknown, such as one loaded by nv_loadvec(), and is not reused.
+// The blocks are compacted once a quarter of the space handed out from them is no longer in use.
+// The elements of a large numeric array point to numbers in 8 byte chunks of the store instead,
+// which are assigned in place.
+//
+#define STORE_CLASSES 32
+#define STORE_MAX 2048       // largest chunk, longer strings are allocated on their own
+#define STORE_MIN 256        // arrays with fewer elements than this do not get a store
+#define STORE_BLOCK 8192     // smallest block
+#define STORE_COMPACT 65536  // a store smaller than this is never compacted
+
+struct array_store {
+    void *blocks;                   // chain of blocks, each starts with a pointer to the next
+    char *next;                     // start of the unused part of the last block
+    size_t avail;                   // size of the unused part of the last block
+    size_t size;                    // size of all the blocks
+    size_t free;                    // bytes before the unused part that no element uses
+    char *freelist[STORE_CLASSES];  // chunks no element uses, by size class
+};
+
+static const unsigned short store_size[STORE_CLASSES] = {
+    0,   0,   8,   16,  24,  32,  40,  48,  56,  64,   72,   80,   88,   96,   104,  112,
+    120, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024, 1536, 2048};
+
+//
+// Return a new empty store. Stores and their blocks are charged to the arrays of .sh.mem.
+//
+static_fn struct array_store *store_new(void) {
+    sh_memalloc(MEM_ARRAYS, sizeof(struct array_store));
+    return calloc(1, sizeof(struct array_store));
+}
+
+//
+// Return the smallest size class that holds <n> bytes. <n> must be at most STORE_MAX.
+//
+static_fn int store_class(size_t n) {
+    int c;
+
+    if (n <= 128) return n ? 2 + (n - 1) / 8 : 2;
+    for (c = 18; store_size[c] < n; c++) {
+        ;  // empty loop
+    }
+    return c;
+}
+
+//
+// Return space for a string of <n> bytes from <sp> and set <class> to its size class.
+//
+static_fn char *store_alloc(struct array_store *sp, size_t n, int *class) {
+    char *cp;
+
+    if (n > STORE_MAX) {
+        // Keep the chunks that follow aligned for the numbers of a numeric array.
+        *class = 1;
+        n = roundof(n, sizeof(double));
+    } else {
+        *class = store_class(n);
+        n = store_size[*class];
+        if ((cp = sp->freelist[*class])) {
+            memcpy(&sp->freelist[*class], cp, sizeof(char *));
+            sp->free -= n;
+            return cp;
+        }
+    }
+    if (n > sp->avail) {
+        size_t size = sp->size < STORE_BLOCK ? STORE_BLOCK : sp->size;
+        void *bp;
+        if (size < n) size = n;
+        bp = malloc(sizeof(void *) + size);
+        *(void **)bp = sp->blocks;
+        sp->blocks = bp;
+        sp->free += sp->avail;
+        sp->size += size;
+        sh_memgrow(MEM_ARRAYS, size);
+        sp->next = (char *)bp + sizeof(void *);
+        sp->avail = size;
+    }
+    cp = sp->next;
+    sp->next += n;
+    sp->avail -= n;
+    return cp;
+}
+
+//
+// Let go of the store of <ap> without freeing it, because a copy of <ap> owns it.
+//
+static_fn void store_disown(struct index_array *ap) {
+    int i;
+
+    ap->store = NULL;
+    for (i = 0; i < ap->maxi; i++) ap->bits[i] &= ~ARRAY_CLASS;
+}
+
+//
+// Free the store of <ap> and every block in it.
+//
+static_fn void array_dropstore(struct index_array *ap) {
+    void *bp, *next;
+
+    if (!ap->store) return;
+    for (bp = ap->store->blocks; bp; bp = next) {
+        next = *(void **)bp;
+        free(bp);
+    }
+    sh_memfree(MEM_ARRAYS, sizeof(struct array_store) + ap->store->size);
+    free(ap->store);
+    ap->store = NULL;
+}
+
+//
+// Copy the strings of the elements of <ap> that are in its store into a single new block.
+//
+static_fn void store_compact(struct index_array *ap) {
+    struct array_store *sp = ap->store;
+    void *bp, *next, *blocks = sp->blocks;
+    size_t n = sp->size - sp->avail - sp->free;
+    const char *cp;
+    char *xp;
+    int i, c;
+
+    sh_memgrow(MEM_ARRAYS, (ssize_t)n - (ssize_t)sp->size);
+    memset(sp, 0, sizeof(*sp));
+    bp = malloc(sizeof(void *) + n);
+    *(void **)bp = NULL;
+    sp->blocks = bp;
+    sp->next = (char *)bp + sizeof(void *);
+    sp->size = sp->avail = n;
+    for (i = 0; i < ap->maxi; i++) {
+        if (!(c = ap->bits[i] >> ARRAY_CSHIFT) || array_isbit(ap->bits, i, ARRAY_CHILD)) continue;
+        cp = FETCH_VT(ap->val[i], const_cp);
+        if (c == 1) {
+            // The string is copied whole and gets the size class of its new chunk.
+            n = strlen(cp) + 1;
+            xp = store_alloc(sp, n, &c);
+            memcpy(xp, cp, n);
+            ap->bits[i] = (ap->bits[i] & ~ARRAY_CLASS) | c << ARRAY_CSHIFT;
+        } else {
+            xp = store_alloc(sp, store_size[c], &c);
+            memcpy(xp, cp, store_size[c]);
+        }
+        STORE_VT(ap->val[i], const_cp, xp);
+    }
+    for (bp = blocks; bp; bp = next) {
+        next = *(void **)bp;
+        free(bp);
+    }
+}
+
+//
+// Give the chunk <cp> of size class <class> back to the store of <ap>, and compact the store if
+// too much of it has been given back.
+//
+static_fn void store_release(struct index_array *ap, int class, const char *cp) {
+    struct array_store *sp = ap->store;
+
+    if (class > 1) {
+        memcpy((char *)cp, &sp->freelist[class], sizeof(char *));
+        sp->freelist[class] = (char *)cp;
+        sp->free += store_size[class];
+    } else {
+        sp->free += strlen(cp) + 1;
+    }
+    if (sp->size >= STORE_COMPACT && sp->free > (sp->size - sp->avail) / 4 &&
+        !(ap->namarr.flags & ARRAY_SCAN)) {
+        store_compact(ap);
+    }
+}
+
+//
+// Assign <string> to the current element of <ap> from its store when the array is large enough
+// and nothing about <np> needs to see the value. Return false when nv_putv() must assign it.
+//
+static_fn bool array_store(Namval_t *np, struct index_array *ap, const char *string,
+                           nvflag_t flags) {
+    const char *old = FETCH_VT(ap->val[ap->cur], const_cp);
+    int bits = ap->bits[ap->cur];
+    size_t n, len = 0;
+    char *cp;
+    int c;
+
+    if ((flags & ~(NV_RDONLY | NV_APPEND)) || nv_isattr(np, ARRAY_TYPED) ||
+        np->nvfun != &ap->namarr.namfun || ap->namarr.namfun.next || ap->namarr.namfun.type ||
+        ap->namarr.scope || (bits & ARRAY_CHILD) || (!ap->store && ap->maxi < STORE_MIN)) {
+        return false;
+    }
+    if (old == Empty) old = NULL;
+    if ((flags & NV_APPEND) && old) len = strlen(old);
+    n = strlen(string) + 1;
+    if (len + n > STORE_MAX) return false;
+    if (!ap->store) ap->store = store_new();
+    cp = store_alloc(ap->store, len + n, &c);
+    if (len) memcpy(cp, old, len);
+    memcpy(cp + len, string, n);
+    STORE_VT(ap->val[ap->cur], const_cp, cp);
+    ap->bits[ap->cur] = (bits & ~(ARRAY_CLASS | ARRAY_UNSET)) | ARRAY_NOFREE | c << ARRAY_CSHIFT;
+    if (old && (bits & ARRAY_CLASS)) {
+        store_release(ap, bits >> ARRAY_CSHIFT, old);
+    } else if (old && *old && !(bits & ARRAY_NOFREE)) {
+        free((char *)old);
+    }
+    return true;
+}
+
+//
+// Return the size of the number that an element of the numeric array <np> points to, or 0 when
+// the elements of <np> hold their numbers themselves or are not numbers.
+//
+static_fn size_t array_numsize(Namval_t *np) {
+    if (nv_isattr(np, NV_INTEGER | NV_BINARY | NV_REF) != NV_INTEGER) return 0;
+    if (nv_isattr(np, NV_DOUBLE) == NV_DOUBLE) {
+        if (nv_isattr(np, NV_LONG)) return sizeof(Sfdouble_t);
+        return nv_isattr(np, NV_SHORT) ? sizeof(float) : sizeof(double);
+    }
+    if (nv_isattr(np, NV_SHORT)) return nv_isattr(np, NV_INT16P) == NV_INT16P ? sizeof(int16_t) : 0;
+    return nv_isattr(np, NV_LONG) ? sizeof(Sflong_t) : sizeof(int32_t);
+}
+
+//
+// Return a chunk of the store of <ap> for the number of the current element of the numeric array
+// <np> when the array is large enough and nothing else about <np> needs to see the element, and
+// mark the element as kept in the store. Otherwise return NULL.
+//
+static_fn char *array_numchunk(Namval_t *np, struct index_array *ap) {
+    size_t n;
+    char *cp;
+    int c;
+
+    if ((ap->bits[ap->cur] & (ARRAY_CHILD | ARRAY_NOFREE | ARRAY_CLASS)) ||
+        np->nvfun != &ap->namarr.namfun || ap->namarr.namfun.next || ap->namarr.namfun.type ||
+        ap->namarr.scope || (!ap->store && ap->maxi < STORE_MIN) || !(n = array_numsize(np)) ||
+        n > sizeof(double)) {
+        return NULL;
+    }
+    if (!ap->store) ap->store = store_new();
+    cp = store_alloc(ap->store, n, &c);
+    ap->bits[ap->cur] |= ARRAY_NOFREE | c << ARRAY_CSHIFT;
+    return cp;
+}
+
+//
+// Move the number just assigned to the current element of the numeric array <np> into the store
+// of <ap> if it can be kept there.
+//
+static_fn void array_packnum(Namval_t *np, struct index_array *ap) {
+    void *vp = FETCH_VT(ap->val[ap->cur], vp);
+    char *cp;
+
+    if (vp && vp != Empty && (cp = array_numchunk(np, ap))) {
+        memcpy(cp, vp, array_numsize(np));
+        free(vp);
+        STORE_VT(ap->val[ap->cur], vp, cp);
+    }
+}
+
 // Return next index after the highest element in an array.
 int array_maxindex(Namval_t *np) {
     struct index_array *ap = (struct index_array *)nv_arrayptr(np);
@@ -412,7 +681,7 @@ static_fn Namfun_t *array_clone(Namval_t *np, Namval_t *mp, nvflag_t flags, Namf
         shp->prev_root = shp->last_root;
     }
     if (ap->table) {
-        ap->table = dtopen(&_Nvdisc, Dtoset);
+        ap->table = dtopen(&_Nvdisc, otable->meth);
         dtuserdata(ap->table, shp, 1);
         if (ap->scope && !(flags & NV_COMVAR)) {
             ap->scope = ap->table;
@@ -420,11 +689,16 @@ static_fn Namfun_t *array_clone(Namval_t *np, Namval_t *mp, nvflag_t flags, Namf
         }
     }
     mp->nvfun = &ap->namfun;
+    if (nv_isattr(np, NV_EXPORT) || nv_isattr(mp, NV_EXPORT)) sh_envserial++;
     mp->nvflag &= NV_MINIMAL;
     mp->nvflag |= (np->nvflag & ~(NV_MINIMAL | NV_NOFREE));
     if (!(flg & (ARRAY_SCAN | ARRAY_UNDEF)) && (sub = nv_getsub(np))) sub = strdup(sub);
     ar = (struct index_array *)ap;
-    if (!is_associative(ap)) ar->bits = (unsigned char *)&ar->val[ar->maxi];
+    if (!is_associative(ap)) {
+        ar->bits = (unsigned char *)&ar->val[ar->maxi];
+        // The store goes with the elements that own its strings.
+        if (aq->store) store_disown((flags & NV_ARRAY) ? aq : ar);
+    }
     if (!nv_putsub(np, NULL, 0, ARRAY_SCAN | ((flags & NV_COMVAR) ? 0 : ARRAY_NOSCOPE))) {
         if (ap->fun) (*ap->fun)(np, (char *)np, ASSOC_OP_ADD2);
         skipped = 1;
@@ -511,7 +785,10 @@ static_fn void array_putval(Namval_t *np, const void *string, nvflag_t flags, Na
     struct Value *up;
     Namval_t *mp;
     struct index_array *aq = (struct index_array *)ap;
-    int scan;
+    int scan, class = 0;
+    const char *old = NULL;
+    char *cp;
+    size_t size;
     bool nofree = nv_isattr(np, NV_NOFREE) == NV_NOFREE;
 
     do {
@@ -574,14 +851,47 @@ static_fn void array_putval(Namval_t *np, const void *string, nvflag_t flags, Na
             STORE_VTP(up, const_cp, NULL);
         }
         if (nv_isarray(np)) STORE_VT(np->nvalue, up, up);
+        if (is_associative(ap)) {
+            old = NULL;
+        } else if (string && array_store(np, aq, string, flags)) {
+            continue;
+        } else if ((class = aq->bits[aq->cur] >> ARRAY_CSHIFT)) {
+            if (string && nv_isattr(np, NV_INTEGER)) {
+                // A number in the store is assigned in place.
+                nv_putv(np, string, flags, &ap->namfun);
+                continue;
+            }
+            old = FETCH_VT(aq->val[aq->cur], const_cp);
+        } else if (string && xfree && FETCH_VTP(up, vp) && FETCH_VTP(up, const_cp) != Empty &&
+                   !array_isbit(aq->bits, aq->cur, ARRAY_CHILD) && (size = array_numsize(np))) {
+            // The number belongs to someone else, such as the copy of the array that a subshell
+            // saved, so it must not be assigned in place.
+            cp = malloc(size);
+            memcpy(cp, FETCH_VTP(up, vp), size);
+            STORE_VTP(up, vp, cp);
+        } else if (string && (flags & NV_INTEGER) && nv_isattr(np, NV_INTEGER) &&
+                   !FETCH_VTP(up, vp) && (cp = array_numchunk(np, aq))) {
+            // The number is already known, so it goes straight into the store.
+            memset(cp, 0, sizeof(double));
+            STORE_VTP(up, vp, cp);
+            nv_putv(np, string, flags, &ap->namfun);
+            continue;
+        }
         nv_putv(np, string, flags, &ap->namfun);
         if (nofree && !FETCH_VTP(up, const_cp)) STORE_VTP(up, const_cp, Empty);
         if (!is_associative(ap)) {
             if (string) {
                 array_clrbit(aq->bits, aq->cur, ARRAY_NOFREE);
+                if (!xfree && nv_isattr(np, NV_INTEGER)) array_packnum(np, aq);
             } else if (mp == np) {
                 STORE_VT(aq->val[aq->cur], const_cp, NULL);
             }
+            if (class) {
+                // The chunk is no longer in use now that the element has a new value.
+                array_clrbit(aq->bits, aq->cur, ARRAY_CLASS);
+                if (old && old != Empty) store_release(aq, class, old);
+                class = 0;
+            }
         }
         if (string && ap->namfun.type && nv_isvtree(np)) {
             nv_arraysettype(np, ap->namfun.type, nv_getsub(np), 0);
@@ -599,6 +909,7 @@ static_fn void array_putval(Namval_t *np, const void *string, nvflag_t flags, Na
             _nv_unset(nv_namptr(aq->xp, 0), NV_RDONLY);
             free(aq->xp);
         }
+        if (!is_associative(ap)) array_dropstore(aq);
         nfp = nv_disc(np, &ap->namfun, DISC_OP_POP);
         if (nfp && !(nfp->nofree & 1)) {
             ap = NULL;
@@ -662,6 +973,7 @@ static_fn struct index_array *array_grow(Namval_t *np, struct index_array *arp,
         ap->namarr = arp->namarr;
         ap->namarr.namfun.dsize = sizeof(*ap) + size;
         ap->last = arp->last;
+        ap->store = arp->store;
         for (i = 0; i < arp->maxi; i++) {
             ap->bits[i] = arp->bits[i];
             STORE_VT(ap->val[i], const_cp, FETCH_VT(arp->val[i], const_cp));
@@ -793,11 +1105,24 @@ static_fn Namarr_t *nv_changearray(Namval_t *np,
             }
             nv_putsub(np, string_index, 0, ARRAY_ADD);
             up = (struct Value *)((*ap->fun)(np, NULL, ASSOC_OP_ADD2));
-            STORE_VTP(up, const_cp, FETCH_VT(save_ap->val[dot], const_cp));
+            if ((save_ap->bits[dot] & ARRAY_CLASS) && nv_isattr(np, NV_INTEGER)) {
+                // The number is in the store, which goes away with the indexed array.
+                size_t size = array_numsize(np);
+                void *vp = malloc(size);
+                memcpy(vp, FETCH_VT(save_ap->val[dot], vp), size);
+                STORE_VTP(up, vp, vp);
+            } else if (array_isbit(save_ap->bits, dot, ARRAY_NOFREE) &&
+                !array_isbit(save_ap->bits, dot, ARRAY_CHILD)) {
+                // The string belongs to someone else, so the new element needs its own copy.
+                STORE_VTP(up, const_cp, strdup(FETCH_VT(save_ap->val[dot], const_cp)));
+            } else {
+                STORE_VTP(up, const_cp, FETCH_VT(save_ap->val[dot], const_cp));
+            }
             STORE_VT(save_ap->val[dot], const_cp, NULL);
         }
         string_index = &numbuff[NUMSIZE];
     }
+    array_dropstore(save_ap);
     free(save_ap);
     return ap;
 }
@@ -1175,6 +1500,25 @@ struct Value *nv_aivec(Namval_t *np, unsigned char **bitp) {
     return ap->val;
 }
 
+//
+// Return the value holder of the current element of the indexed array <np> when the element can
+// be read, or assigned in place if <assign> is set, without a discipline or the array's scope
+// seeing it, otherwise NULL.
+//
+struct Value *nv_aivalue(Namval_t *np, bool assign) {
+    struct index_array *ap = (struct index_array *)np->nvfun;
+
+    if (!nv_isattr(np, NV_ARRAY) || !ap || ap->namarr.namfun.disc != &array_disc ||
+        ap->namarr.namfun.next || ap->namarr.namfun.type || ap->namarr.fun || ap->namarr.scope ||
+        (ap->namarr.flags & (ARRAY_SCAN | ARRAY_UNDEF)) || ap->cur >= ap->maxi ||
+        array_isbit(ap->bits, ap->cur, ARRAY_CHILD)) {
+        return NULL;
+    }
+    // An element whose number belongs to someone else cannot be assigned in place.
+    if (assign && (ap->bits[ap->cur] & (ARRAY_NOFREE | ARRAY_CLASS)) == ARRAY_NOFREE) return NULL;
+    return &ap->val[ap->cur];
+}
+
 int nv_aipack(Namarr_t *arp) {
     struct index_array *ap = (struct index_array *)arp;
     int i, j;
@@ -1215,7 +1559,9 @@ static_fn void *nv_assoc_op_init(Namval_t *np, const char *sp) {
     assert(!ap);
     ap = calloc(1, sizeof(struct assoc_array));
     assert(ap);
-    ap->namarr.table = dtopen(&_Nvdisc, Dtoset);
+    // Subscripts are hashed for lookup. Walks list them sorted or, for typeset -O, in the order
+    // they were first assigned.
+    ap->namarr.table = dtopen(&_Nvdisc, shp->assoc_order ? Dtiset : Dtohset);
     dtuserdata(ap->namarr.table, shp, 1);
     ap->cur = NULL;
     ap->pos = NULL;
@@ -1441,3 +1787,42 @@ void nv_setvec(Namval_t *np, int append, int argc, char *argv[]) {
     }
     if (!ap && (ap = (struct index_array *)nv_arrayptr(np))) ap->last = array_maxindex(np);
 }
+
+//
+// Make the unset variable <np> an indexed array of the <argc> strings in <argv>, all of which are
+// stored in the block <arena>. The block must begin with room for a pointer. The elements point
+// into the block rather than holding copies of their own, and the block becomes the start of the
+// array's store. A variable whose attributes or disciplines must see each value is assigned a
+// copy of each string instead and the block is freed here.
+//
+void nv_loadvec(Namval_t *np, int argc, char *argv[], void *arena) {
+    struct index_array *ap;
+    struct array_store *sp;
+    size_t n;
+    int i;
+
+    if (argc > 0 && !np->nvfun && !nv_isattr(np, ARRAY_TYPED)) {
+        nv_putsub(np, NULL, (long)argc - 1, ARRAY_FILL | ARRAY_ADD);
+        ap = (struct index_array *)nv_arrayptr(np);
+        if (ap && !is_associative(&ap->namarr) && !ap->namarr.table &&
+            !(ap->namarr.flags & ARRAY_TREE) && !ap->store) {
+            ap->store = sp = store_new();
+            *(void **)arena = NULL;
+            sp->blocks = arena;
+            for (i = 0; i < argc; i++) {
+                n = strlen(argv[i]) + 1;
+                sp->size += n;
+                STORE_VT(ap->val[i], const_cp, argv[i]);
+                // The chunks of the block have no size class, so the strings are class 1.
+                ap->bits[i] = ARRAY_NOFREE | 1 << ARRAY_CSHIFT;
+            }
+            sh_memgrow(MEM_ARRAYS, sp->size);
+            ap->namarr.nelem = argc;
+            ap->last = argc;
+            ap->cur = 0;
+            return;
+        }
+    }
+    nv_setvec(np, 0, argc, argv);
+    free(arena);
+}
@@ -37,6 +37,7 @@ struct jobs job = {.pwlist = NULL};
 Dtdisc_t _Nvdisc = {.key = offsetof(Namval_t, nvname), .size = -1, .comparf = nv_compare};
 struct shared *shgd = NULL;
 int32_t sh_mailchk = 600;
+struct Memstat sh_mem[MEM_NCLASS];
 
 // These two magic pointers are used to distinguish the purpose of the `extra` parameter of the
 // `sh_addbuiltin()` function. It should be one of these two values, NULL, or a `Namfun_t*`.
@@ -364,6 +364,11 @@ void sh_chktrap(Shell_t *shp) {
     int sig = shp->st.trapmax;
     char *trap;
     int count = 0;
+    // Reap the children whose SIGCHLD was deferred so that the CHLD trap sees them.
+    if (job.waitsafe && job.savesig) {
+        job_lock();
+        job_unlock();
+    }
     if (!(shp->trapnote & ~SH_SIGIGNORE)) sig = 0;
     if (sh.intrap) return;
     shp->trapnote &= ~SH_SIGTRAP;
@@ -508,6 +513,7 @@ void sh_exit(Shell_t *shp, int xno) {
     shp->intrace = 0;
     shp->prefix = NULL;
     shp->mktype = NULL;
+    shp->assoc_order = false;
     if (job.in_critical) job_unlock();
     if (pp->mode == SH_JMPSCRIPT && !pp->prev) sh_done(shp, sig);
     if (pp->mode) siglongjmp(pp->buff, pp->mode);
@@ -555,6 +561,7 @@ __attribute__((noreturn)) void sh_done(void *ptr, int sig) {
     }
 #endif  // JOBS
     job_close(shp);
+    if (sh_isoption(shp, SH_MEMSTATS) && getpid() == shgd->pid) sh_memdump(sfstderr);
     sfsync((Sfio_t *)sfstdin);
     sfsync((Sfio_t *)shp->outpool);
     sfsync((Sfio_t *)sfstdout);
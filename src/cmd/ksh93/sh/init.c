@@ -40,6 +40,10 @@
 #include <wchar.h>
 #include <wctype.h>
 
+#if _lib_mallinfo2
+#include <malloc.h>
+#endif
+
 #include "argnod.h"
 #include "ast.h"
 #include "ast_assert.h"
@@ -1436,6 +1440,7 @@ int sh_reinit(Shell_t *shp, char *argv[]) {
     data.sh = shp;
     nv_scan(shp->var_tree, sh_envnolocal, &data, NV_EXPORT, 0);
     nv_scan(shp->var_tree, sh_envnolocal, &data, NV_ARRAY, NV_ARRAY);
+    sh_envserial++;
     sh_offstate(shp, SH_INIT);
     memset(shp->st.trapcom, 0, (shp->st.trapmax + 1) * sizeof(char *));
     memset(&opt, 0, sizeof(opt));
@@ -1515,6 +1520,7 @@ static_fn Namval_t *next_svar(Namval_t *np, Dt_t *root, Namfun_t *fp) {
     UNUSED(np);
     struct Svars *sp = (struct Svars *)fp;
     if (!root) {
+        if (sp->parent == SH_MEM) sh_memupdate();
         sp->current = 0;
     } else if (++sp->current >= sp->numnodes) {
         return NULL;
@@ -1531,6 +1537,7 @@ static_fn Namval_t *create_svar(Namval_t *np, const void *vp, nvflag_t flag, Nam
     Shell_t *shp = sp->sh;
 
     assert(name);
+    if (sp->parent == SH_MEM) sh_memupdate();
     for (int i = 0; i < sp->numnodes; i++) {
         Namval_t *nq = nv_namptr(sp->nodes, i);
         if (strcmp(name, nq->nvname) == 0) {
@@ -1642,6 +1649,57 @@ static_fn void stat_init(Shell_t *shp) {
     }
 }
 
+static_fn void mem_init(Shell_t *shp) {
+    Namval_t *np;
+    struct Svars *sp;
+    int i, n;
+    n = svar_init(shp, SH_MEM, shtab_mem, 0);
+    sp = (struct Svars *)SH_MEM->nvfun->next;
+    sp->data = sh_mem;
+    sp->dsize = sizeof(sh_mem);
+    for (i = 0; i < n; i++) {
+        np = nv_namptr(sp->nodes, i);
+        STORE_VT(np->nvalue, i64p, &sh_mem[i / 3].count + i % 3);
+    }
+}
+
+//
+// Bring the categories of .sh.mem that are not counted as they change up to date.
+//
+void sh_memupdate(void) {
+    const Stkstat_t *sp = stkstat();
+    struct Memstat *mp = &sh_mem[MEM_STK];
+
+    mp->count = sp->stacks;
+    mp->bytes = sp->bytes;
+    mp->peak = sp->peak;
+#if _lib_mallinfo2
+    struct mallinfo2 mi = mallinfo2();
+    mp = &sh_mem[MEM_HEAP];
+    mp->count = mi.hblks;
+    mp->bytes = mi.uordblks + mi.hblkhd;
+    if (mp->bytes > mp->peak) mp->peak = mp->bytes;
+#endif
+}
+
+//
+// Write the memory accounting of .sh.mem to <out> as a table, one category per line.
+//
+void sh_memdump(Sfio_t *out) {
+    const char *name;
+    struct Memstat *mp;
+    int i;
+
+    sh_memupdate();
+    sfprintf(out, "%-10s %12s %16s %16s\n", "memory", "count", "bytes", "peak");
+    for (i = 0; i < MEM_NCLASS; i++) {
+        name = shtab_mem[3 * i].sh_name;
+        mp = &sh_mem[i];
+        sfprintf(out, "%-10.*s %12lld %16lld %16lld\n", (int)(strchr(name, '_') - name), name,
+                 (Sflong_t)mp->count, (Sflong_t)mp->bytes, (Sflong_t)mp->peak);
+    }
+}
+
 #define SIGNAME_MAX 32
 static_fn void siginfo_init(Shell_t *shp) {
     struct Svars *sp;
@@ -1818,7 +1876,7 @@ static_fn Init_t *nv_init(Shell_t *shp) {
     dtuserdata(shp->track_tree, shp, 1);
     shp->bltin_tree = inittree(shp, (const struct shtable2 *)shtab_builtins);
     dtuserdata(shp->bltin_tree, shp, 1);
-    shp->fun_tree = dtopen(&_Nvdisc, Dtoset);
+    shp->fun_tree = dtopen(&_Nvdisc, Dtohset);
     dtuserdata(shp->fun_tree, shp, 1);
     dtview(shp->fun_tree, shp->bltin_tree);
     nv_mount(DOTSHNOD, "type", shp->typedict = dtopen(&_Nvdisc, Dtoset));
@@ -1834,7 +1892,10 @@ static_fn Init_t *nv_init(Shell_t *shp) {
     nrp->table = DOTSHNOD;
     nv_onattr(VERSIONNOD, NV_REF);
     math_init(shp);
-    if (!shgd->stats) stat_init(shp);
+    if (!shgd->stats) {
+        stat_init(shp);
+        mem_init(shp);
+    }
     siginfo_init(shp);
     return ip;
 }
@@ -1859,7 +1920,7 @@ static_fn Dt_t *inittree(Shell_t *shp, const struct shtable2 *name_vals) {
         shgd->bltin_cmds = np;
         nbltins = n;
     }
-    base_treep = treep = dtopen(&_Nvdisc, Dtoset);
+    base_treep = treep = dtopen(&_Nvdisc, Dtohset);
     dtuserdata(treep, shp, 1);
     for (tp = name_vals; *tp->sh_name; tp++, np++) {
         if ((np->nvname = strrchr(tp->sh_name, '.')) && np->nvname != ((char *)tp->sh_name)) {
@@ -1882,7 +1943,7 @@ static_fn Dt_t *inittree(Shell_t *shp, const struct shtable2 *name_vals) {
         // compound var. At this point the nv_isattr test is true while nv_istable(np) is false.
         // Ffter the nv_mount() the reverse is true.
         if (nv_isattr(np, NV_TABLE)) {
-            dict = dtopen(&_Nvdisc, Dtoset);
+            dict = dtopen(&_Nvdisc, Dtohset);
             nv_mount(np, NULL, dict);
             dtinsert(treep, np);
             treep = dict;
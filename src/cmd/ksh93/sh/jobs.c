@@ -32,11 +32,13 @@
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <poll.h>
 #include <sched.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <termios.h>
 #include <unistd.h>
@@ -63,17 +65,40 @@
 
 //
 // This struct saves a link list of processes that have non-zero exit status,
-// have had $! saved, but haven't been waited for.
+// have had $! saved, but haven't been waited for.  Each subshell level has its
+// own list, newest first, and all of them are also chained by pid in savetab.
 //
 struct jobsave {
-    struct jobsave *next;
+    struct jobsave *next;    // next older entry at this level
+    struct jobsave *prev;    // next newer entry at this level
+    struct jobsave *nxtpid;  // next entry in the same savetab bucket
     pid_t pid;
     unsigned short exitval;
     unsigned short env;
+    int level;   // subshell level, see job_subsave()
+    bool async;  // saved for a job run with & that `wait -n` has not reported
 };
 
 static struct jobsave *job_savelist;
 static int njob_savelist;
+static struct jobsave **savetab;  // saved statuses hashed by pid
+static unsigned int savemask;     // number of buckets in savetab - 1
+static int nsave;                 // number of entries in savetab
+static int savelevel;             // subshell level of bck
+
+//
+// The processes on the job list are hashed by pid in pidtab and the first
+// process of each job is indexed by job number in jidtab so that job_bypid()
+// and job_byjid() don't have to walk the job list.  Both tables only grow,
+// and only in job_post() which holds the job lock.
+//
+static struct process **pidtab;
+static unsigned int pidmask;  // number of buckets in pidtab - 1
+static struct process **jidtab;
+static int njid;  // number of slots in jidtab
+
+#define PIDHASH(pid, mask) ((unsigned int)(pid) & (mask))
+#define NPIDHASH 64
 static struct process *pwfg;
 static int jobfork;
 static siginfo_t Siginfo;
@@ -109,7 +134,8 @@ static_fn void init_savelist(void) {
 
 struct back_save {
     int count;
-    struct jobsave *list;
+    struct jobsave *list;  // newest entry
+    struct jobsave *last;  // oldest entry
     struct back_save *prev;
 };
 
@@ -145,6 +171,7 @@ struct back_save {
 #define P_DISOWN 0200
 #define P_FG 0400
 #define P_BG 01000
+#define P_ASYNC 02000  // started with & or bg
 
 static_fn int job_chksave(pid_t, long);
 static_fn struct process *job_bypid(pid_t);
@@ -154,6 +181,9 @@ static_fn int job_alloc(Shell_t *);
 static_fn void job_free(int);
 static_fn struct process *job_unpost(Shell_t *, struct process *, int);
 static_fn void job_unlink(struct process *);
+static_fn void job_push(struct process *);
+static_fn void job_setjid(int, struct process *);
+static_fn void pidtab_grow(void);
 static_fn void job_prmsg(Shell_t *, struct process *);
 static struct process *freelist;
 static char beenhere;
@@ -241,11 +271,36 @@ void job_chldtrap(Shell_t *shp, const char *trap, int lock) {
     job_unlock();
 }
 
+//
+// Double the number of savetab buckets.  Entries keep their order within a bucket so that the
+// newest status for a pid is still found first.
+//
+static_fn void savetab_grow(void) {
+    unsigned int i, n = savetab ? 2 * (savemask + 1) : NPIDHASH;
+    struct jobsave **tab = calloc(n, sizeof(struct jobsave *));
+    struct jobsave *jp, *jpnext, **jpp;
+
+    for (i = 0; savetab && i <= savemask; i++) {
+        for (jp = savetab[i]; jp; jp = jpnext) {
+            jpnext = jp->nxtpid;
+            for (jpp = &tab[PIDHASH(jp->pid, n - 1)]; *jpp; jpp = &(*jpp)->nxtpid) {
+                ;  // empty loop
+            }
+            jp->nxtpid = NULL;
+            *jpp = jp;
+        }
+    }
+    free(savetab);
+    savetab = tab;
+    savemask = n - 1;
+}
+
 //
 // Return next on link list of jobsave free list.
 //
 static_fn struct jobsave *jobsave_create(pid_t pid) {
     struct jobsave *jp = job_savelist;
+    struct jobsave **bucket;
 
     job_chksave(pid, -1);
     if (++bck.count > shgd->lim.child_max) job_chksave(0, -1);
@@ -256,10 +311,23 @@ static_fn struct jobsave *jobsave_create(pid_t pid) {
         jp = calloc(1, sizeof(struct jobsave));
     }
     if (jp) {
+        if (!savetab || nsave > (int)savemask) savetab_grow();
         jp->pid = pid;
+        jp->level = savelevel;
+        jp->prev = NULL;
         jp->next = bck.list;
+        if (bck.list) {
+            bck.list->prev = jp;
+        } else {
+            bck.last = jp;
+        }
         bck.list = jp;
+        bucket = &savetab[PIDHASH(pid, savemask)];
+        jp->nxtpid = *bucket;
+        *bucket = jp;
+        nsave++;
         jp->exitval = 0;
+        jp->async = false;
     }
     return jp;
 }
@@ -332,19 +400,22 @@ int job_cowalk(int (*fun)(struct process *, int), int arg, char *name) {
 #endif  // SHOPT_COSHELL
 
 //
-// This is the SIGCLD interrupt routine.
-//
-// TODO: Refactor this so that it only records the receipt of the signal and the actual reaping is
-// done from non-interrupt context.  See issue #563.
+// This is the SIGCLD interrupt routine.  It only records the receipt of the signal.  The children
+// are reaped later, at a safe point, by job_unlock(), sh_chktrap(), a wait, or sh_exec() once the
+// current command is done.  The exception is a shell blocked reading a terminal or pipe, which
+// reaps at once so that `set -b` can report the jobs as soon as they complete.  See issue #563.
 //
 static_fn void job_waitsafe(int sig, siginfo_t *info, void *context) {
     UNUSED(info);
     UNUSED(context);
+    Shell_t *shp = sh_getinterp();
     int saved_errno = errno;
 
-    if (job.in_critical || vmbusy()) {
+    if (job.in_critical || vmbusy() || !sh_isstate(shp, SH_TTYWAIT)) {
         job.savesig = sig;
         job.waitsafe++;
+        // Make sure that sh_chktrap() is called to reap the children and run the trap.
+        if (!job.in_critical && shp->st.trapcom[SIGCHLD]) shp->trapnote |= SH_SIGTRAP;
     } else {
         job_reap(sig);
     }
@@ -500,8 +571,7 @@ bool job_reap(int sig) {
             if (px) {
                 // Move to top of job list.
                 job_unlink(px);
-                px->p_nxtjob = job.pwlist;
-                job.pwlist = px;
+                job_push(px);
             }
             continue;
         } else
@@ -800,7 +870,12 @@ void job_bwait(char **jobs) {
     pid_t pid;
 
     if (*jobs == 0) {
+        struct jobsave *jsp;
         job_wait((pid_t)-1);
+        // All the background jobs have now been waited for, so `wait -n` has none to report.
+        job_lock();
+        for (jsp = bck.list; jsp; jsp = jsp->next) jsp->async = false;
+        job_unlock();
     } else {
         while (*jobs) {
             jp = *jobs++;
@@ -830,6 +905,206 @@ void job_bwait(char **jobs) {
     }
 }
 
+//
+// Return true if every process of job <pw> has completed.
+//
+static_fn bool job_isdone(struct process *pw) {
+    for (; pw; pw = pw->p_nxtproc) {
+        if (!(pw->p_flag & P_DONE)) return false;
+    }
+    return true;
+}
+
+//
+// Return true if the job <pw> was run with & or resumed with `bg`.
+//
+static_fn bool job_isasync(struct process *pw) {
+    for (; pw; pw = pw->p_nxtproc) {
+        if (pw->p_flag & P_ASYNC) return true;
+    }
+    return false;
+}
+
+//
+// Mark the process <pid> as run with & so that `wait -n` reports it.
+//
+void job_async(pid_t pid) {
+    struct process *pw;
+
+    job_lock();
+    pw = job_bypid(pid);
+    if (pw) pw->p_flag |= P_ASYNC;
+    job_unlock();
+}
+
+#if _lib_pidfd_open && _lib_ppoll
+//
+// Block until one of the <n> processes in <pids> terminates without being woken up by the
+// SIGCHLD of other children.  Returns 1 when one of them terminated and 0 when a signal
+// interrupted the wait.  Returns -1 when pidfd_open() fails, for example because the kernel
+// doesn't have it, and the caller should block in job_reap() instead.
+//
+static_fn int job_pollwait(const pid_t *pids, int n) {
+    struct pollfd *fds = malloc(n * sizeof(struct pollfd));
+    sigset_t mask;
+    int i, r = -1;
+
+    for (i = 0; i < n; i++) {
+        fds[i].fd = (int)syscall(SYS_pidfd_open, pids[i], 0);
+        if (fds[i].fd < 0) break;
+        fds[i].events = POLLIN;
+    }
+    if (i == n) {
+        // SIGCHLD stays pending until ppoll() returns; other signals still interrupt it.
+        sigprocmask(SIG_BLOCK, NULL, &mask);
+        sigaddset(&mask, SIGCHLD);
+        r = ppoll(fds, n, NULL, &mask) > 0;
+    }
+    while (--i >= 0) close(fds[i].fd);
+    free(fds);
+    return r;
+}
+#else
+#define job_pollwait(pids, n) (-1)
+#endif  // _lib_pidfd_open && _lib_ppoll
+
+//
+// Return true if a signal other than SIGCHLD has arrived that should interrupt `wait`.
+//
+static_fn bool job_interrupted(Shell_t *shp) {
+    int sig;
+    if (shp->trapnote & SH_SIGSET) return true;
+    if (!(shp->trapnote & SH_SIGTRAP)) return false;
+    for (sig = 1; sig < shp->st.trapmax; sig++) {
+        if (sig != SIGCHLD && (shp->sigflag[sig] & SH_SIGTRAP)) return true;
+    }
+    return false;
+}
+
+//
+// Block until one of the <n> processes in <pids> has terminated and return its index, or -1 if a
+// signal interrupted the wait.  A process that is no longer on the job list has terminated and had
+// its exit status saved, and if the shell has no children left the first process is returned.  The
+// caller collects the exit status with job_wait().
+//
+int job_waitany(const pid_t *pids, int n) {
+    Shell_t *shp = sh_getinterp();
+    struct process *pw;
+    int i, nrun;
+    bool nochild = false;
+
+    job_lock();
+    errno = 0;
+    while (1) {
+        for (nrun = i = 0; i < n; i++) {
+            pw = job_bypid(pids[i]);
+            if (!pw || (pw->p_flag & P_DONE)) break;
+            nrun++;
+        }
+        if (i < n || !nrun || nochild) break;
+        if (job_interrupted(shp)) {
+            i = -1;
+            break;
+        }
+        if (job_pollwait(pids, nrun)) nochild = job_reap(0);
+    }
+    job_unlock();
+    return i < n ? i : 0;
+}
+
+//
+// `wait -n` built-in command.  Wait until one of the <jobs>, or any job of the current
+// environment if there are none, has completed and set the exit status to its exit status.
+// Children are only reaped when one has terminated, so a single blocking call waits for each.
+//
+void job_bwaitany(char **jobs) {
+    Shell_t *shp = sh_getinterp();
+    struct process *pw, *px, *done;
+    struct jobsave *jp;
+    pid_t pid, *pids = NULL;
+    int i, njob, npid, maxpid = 0, val;
+    bool intr = false, nochild = false;
+
+    job_lock();
+    errno = 0;
+    while (1) {
+        done = NULL;
+        njob = npid = 0;
+        if (!*jobs) {
+            for (pw = job.pwlist; pw; pw = pw->p_nxtjob) {
+                if (pw->p_env != shp->curenv || !job_isasync(pw)) continue;
+                if (job_isdone(pw)) {
+                    done = pw;
+                    break;
+                }
+                njob++;
+            }
+            // A job that completed and was unposted before it was waited for has its exit
+            // status saved.  Report the oldest of them.
+            for (jp = bck.last; !done && jp; jp = jp->prev) {
+                if (jp->env != shp->curenv || !jp->async) continue;
+                job_unlock();
+                free(pids);
+                shp->exitval = job_chksave(jp->pid, shp->curenv);
+                exitset(shp);
+                return;
+            }
+        }
+        for (i = 0; jobs[i] && !done; i++) {
+#ifdef JOBS
+            if (*jobs[i] == '%') {
+                pw = job_bystring(jobs[i]);
+            } else
+#endif  // JOBS
+            {
+                pid = pid_fromstring(jobs[i]);
+                if ((pw = job_bypid(pid))) {
+                    pw = job_byjid((int)pw->p_job);
+                } else if ((val = job_chksave(pid, shp->curenv)) >= 0) {
+                    // The job has been unposted but its exit status was saved.
+                    job_unlock();
+                    free(pids);
+                    shp->exitval = val;
+                    exitset(shp);
+                    return;
+                }
+            }
+            if (!pw || pw->p_env != shp->curenv) continue;
+            if (job_isdone(pw)) {
+                done = pw;
+                break;
+            }
+            njob++;
+            // Collect the processes of the named jobs so that only they end the wait.
+            for (px = pw; px; px = px->p_nxtproc) {
+                if (px->p_flag & P_DONE) continue;
+                if (npid >= maxpid) {
+                    maxpid = maxpid ? 2 * maxpid : 8;
+                    pids = realloc(pids, maxpid * sizeof(pid_t));
+                }
+                pids[npid++] = px->p_pid;
+            }
+        }
+        if (done || !njob || intr || nochild) break;
+        if (!npid || job_pollwait(pids, npid)) nochild = job_reap(0);
+        intr = job_interrupted(shp);
+    }
+    free(pids);
+    if (done) {
+        shp->exitval = done->p_exit;
+        if (done->p_flag & P_SIGNALLED) {
+            shp->exitval |= SH_EXITSIG;
+            job_prmsg(shp, done);
+        }
+        for (px = done; px; px = px->p_nxtproc) px->p_flag &= ~(P_EXITSAVE | P_NOTIFY);
+        job_unpost(shp, done, 1);
+    } else {
+        shp->exitval = intr ? 1 : ERROR_NOENT;
+    }
+    job_unlock();
+    exitset(shp);
+}
+
 #ifdef JOBS
 //
 // Execute function <fun> for each job.
@@ -844,10 +1119,9 @@ int job_walk(Shell_t *shp, Sfio_t *file, int (*fun)(struct process *, int), int
     outfile = file;
     by_number = 0;
     job_lock();
+    job_reap(SIGCHLD);
     pw = job.pwlist;
 
-    job_waitsafe(SIGCHLD, NULL, NULL);
-
     if (!jobs) {
         // Do all jobs.
         for (; pw; pw = px) {
@@ -1181,23 +1455,38 @@ static_fn struct process *job_byname(char *name) {
 void job_clear(Shell_t *shp) {
     struct process *pw, *px;
     struct process *pwnext;
+    struct back_save *bp;
     int j = BYTE(shp->gd->lim.child_max);
-    struct jobsave *jp, *jpnext;
 
     job_lock();
-    for (pw = job.pwlist; pw; pw = pwnext) {
-        pwnext = pw->p_nxtjob;
-        while (pw) {
-            px = pw;
-            pw = pw->p_nxtproc;
-            free(px);
+    if (sh_isstate(shp, SH_FORKED)) {
+        // The jobs and saved statuses are those of the parent shell.  Freeing each of them would
+        // copy every page that they are on, so a forked child just forgets them.
+        pidtab = NULL;
+        pidmask = 0;
+        jidtab = NULL;
+        njid = 0;
+        savetab = NULL;
+        savemask = 0;
+        nsave = 0;
+        for (bp = &bck; bp; bp = bp->prev) {
+            bp->list = bp->last = NULL;
+            bp->count = 0;
         }
+    } else {
+        for (pw = job.pwlist; pw; pw = pwnext) {
+            pwnext = pw->p_nxtjob;
+            while (pw) {
+                px = pw;
+                pw = pw->p_nxtproc;
+                free(px);
+            }
+        }
+        if (pidtab) memset(pidtab, 0, (pidmask + 1) * sizeof(struct process *));
+        if (jidtab) memset(jidtab, 0, njid * sizeof(struct process *));
+        while (bck.last) job_chksave(0, -1);
+        bck.count = 0;
     }
-    for (jp = bck.list; jp; jp = jpnext) {
-        jpnext = jp->next;
-        free(jp);
-    }
-    bck.list = 0;
     if (njob_savelist < NJOB_SAVELIST) init_savelist();
     job.pwlist = NULL;
     job.numpost = 0;
@@ -1247,8 +1536,7 @@ int job_post(Shell_t *shp, pid_t pid, pid_t join) {
             assert(pw);
             if (pw != job.pwlist) {
                 job_unlink(pw);
-                pw->p_nxtjob = job.pwlist;
-                job.pwlist = pw;
+                job_push(pw);
             }
         }
     }
@@ -1333,6 +1621,12 @@ int job_post(Shell_t *shp, pid_t pid, pid_t join) {
         pw->p_curdir = path_pwd(shp);
         if (pw->p_curdir) pw->p_curdir = strdup(pw->p_curdir);
     }
+    pw->p_prvjob = NULL;
+    if (pw->p_nxtjob) pw->p_nxtjob->p_prvjob = pw;
+    job_setjid(pw->p_job, pw);
+    if (!pidtab || job.numpost > (int)pidmask) pidtab_grow();
+    pw->p_nxtpid = pidtab[PIDHASH(pid, pidmask)];
+    pidtab[PIDHASH(pid, pidmask)] = pw;
     job_unlock();
     return pw->p_job;
 }
@@ -1341,24 +1635,68 @@ int job_post(Shell_t *shp, pid_t pid, pid_t join) {
 // Returns a process structure give a process id.
 //
 static_fn struct process *job_bypid(pid_t pid) {
-    struct process *pw, *px;
-    for (pw = job.pwlist; pw; pw = pw->p_nxtjob) {
-        for (px = pw; px; px = px->p_nxtproc) {
-            if (px->p_pid == pid) return px;
-        }
+    struct process *pw;
+    if (!pidtab) return NULL;
+    for (pw = pidtab[PIDHASH(pid, pidmask)]; pw; pw = pw->p_nxtpid) {
+        if (pw->p_pid == pid) break;
     }
-    return NULL;
+    return pw;
 }
 
 //
 // Return a pointer to a job given the job id.
 //
 static_fn struct process *job_byjid(int jobid) {
-    struct process *pw;
-    for (pw = job.pwlist; pw; pw = pw->p_nxtjob) {
-        if (pw->p_job == jobid) break;
+    if (jobid <= 0 || jobid >= njid) return NULL;
+    return jidtab[jobid];
+}
+
+//
+// Double the number of pidtab buckets.  Processes keep their order within a bucket so that the
+// newest process with a given pid is still found first.
+//
+static_fn void pidtab_grow(void) {
+    unsigned int i, n = pidtab ? 2 * (pidmask + 1) : NPIDHASH;
+    struct process **tab = calloc(n, sizeof(struct process *));
+    struct process *pw, *pwnext, **pwp;
+
+    for (i = 0; pidtab && i <= pidmask; i++) {
+        for (pw = pidtab[i]; pw; pw = pwnext) {
+            pwnext = pw->p_nxtpid;
+            for (pwp = &tab[PIDHASH(pw->p_pid, n - 1)]; *pwp; pwp = &(*pwp)->p_nxtpid) {
+                ;  // empty loop
+            }
+            pw->p_nxtpid = NULL;
+            *pwp = pw;
+        }
     }
-    return pw;
+    free(pidtab);
+    pidtab = tab;
+    pidmask = n - 1;
+}
+
+//
+// Make <pw> the first process of job <jobid> in jidtab.
+//
+static_fn void job_setjid(int jobid, struct process *pw) {
+    if (jobid >= njid) {
+        int n = njid ? njid : NPIDHASH;
+        while (n <= jobid) n *= 2;
+        jidtab = realloc(jidtab, n * sizeof(struct process *));
+        memset(jidtab + njid, 0, (n - njid) * sizeof(struct process *));
+        njid = n;
+    }
+    jidtab[jobid] = pw;
+}
+
+//
+// Put job <pw> at the front of the job list.
+//
+static_fn void job_push(struct process *pw) {
+    pw->p_prvjob = NULL;
+    pw->p_nxtjob = job.pwlist;
+    if (job.pwlist) job.pwlist->p_prvjob = pw;
+    job.pwlist = pw;
 }
 
 //
@@ -1578,12 +1916,11 @@ int job_switch(struct process *pw, int bgflag) {
     if (bgflag == 'b') {
         sfprintf(outfile, "[%d]\t", (int)pw->p_job);
         shp->bckpid = pw->p_pid;
-        pw->p_flag |= P_BG;
+        pw->p_flag |= P_BG | P_ASYNC;
         msg = "&";
     } else {
         job_unlink(pw);
-        pw->p_nxtjob = job.pwlist;
-        job.pwlist = pw;
+        job_push(pw);
         msg = "";
     }
     hist_list(shgd->hist_ptr, outfile, pw->p_name, '&', ";");
@@ -1641,7 +1978,7 @@ static_fn void job_unstop(struct process *px) {
 // non-zero, then jobs with pending notifications are unposted.
 //
 static_fn struct process *job_unpost(Shell_t *shp, struct process *pwtop, int notify) {
-    struct process *pw;
+    struct process *pw, **pwp;
 
     // Make sure all processes are done.
 #ifdef DEBUG
@@ -1659,6 +1996,7 @@ static_fn struct process *job_unpost(Shell_t *shp, struct process *pwtop, int no
     if (!pwtop || pwtop->p_job == job.curjobid) return NULL;
     // All processes complete, unpost job.
     job_unlink(pwtop);
+    jidtab[pwtop->p_job] = NULL;
     for (pw = pwtop; pw; pw = pw->p_nxtproc) {
         if (pw && pw->p_exitval) *pw->p_exitval = pw->p_exit;
         // Save the exit status for background jobs.
@@ -1670,11 +2008,18 @@ static_fn struct process *job_unpost(Shell_t *shp, struct process *pwtop, int no
                 jp->env = pw->p_env;
                 jp->exitval = pw->p_exit;
                 if (pw->p_flag & P_SIGNALLED) jp->exitval |= SH_EXITSIG;
+                jp->async = (pw->p_flag & P_ASYNC) != 0;
             }
             pw->p_flag &= ~P_EXITSAVE;
         }
         pw->p_flag &= ~P_DONE;
         job.numpost--;
+        for (pwp = &pidtab[PIDHASH(pw->p_pid, pidmask)]; *pwp; pwp = &(*pwp)->p_nxtpid) {
+            if (*pwp == pw) {
+                *pwp = pw->p_nxtpid;
+                break;
+            }
+        }
         pw->p_nxtjob = freelist;
         if (pw->p_curdir) free(pw->p_curdir);
         freelist = pw;
@@ -1693,18 +2038,16 @@ static_fn struct process *job_unpost(Shell_t *shp, struct process *pwtop, int no
 // Unlink a job form the job list.
 //
 static_fn void job_unlink(struct process *pw) {
-    struct process *px;
     if (pw == job.pwlist) {
         job.pwlist = pw->p_nxtjob;
         job.curpgid = 0;
+    } else if (pw->p_prvjob) {
+        pw->p_prvjob->p_nxtjob = pw->p_nxtjob;
+    } else {
         return;
     }
-    for (px = job.pwlist; px; px = px->p_nxtjob) {
-        if (px->p_nxtjob == pw) {
-            px->p_nxtjob = pw->p_nxtjob;
-            return;
-        }
-    }
+    if (pw->p_nxtjob) pw->p_nxtjob->p_prvjob = pw->p_prvjob;
+    pw->p_prvjob = NULL;
 }
 
 //
@@ -1777,36 +2120,40 @@ static_fn const char *job_sigmsg(Shell_t *shp, int sig) {
 // If pid is not found a -1 is returned.
 //
 static_fn int job_chksave(pid_t pid, long env) {
-    struct jobsave *jp = bck.list;
-    struct jobsave *jpold = NULL;
-    int r = -1;
-    int count = bck.count;
+    struct jobsave *jp, **jpp;
     struct back_save *bp = &bck;
+    int level, r = -1;
 
-again:
-    while (jp && count-- > 0) {
-        if (jp->pid == pid) break;
-        if (pid == 0 && !jp->next) break;
-        jpold = jp;
-        jp = jp->next;
-    }
-    if (!jp && pid && (bp = bp->prev)) {
-        count = bp->count;
-        jp = bp->list;
-        jpold = NULL;
-        goto again;
+    if (!savetab) return r;
+    if (pid) {
+        for (jpp = &savetab[PIDHASH(pid, savemask)]; (jp = *jpp); jpp = &jp->nxtpid) {
+            if (jp->pid == pid) break;
+        }
+        if (!jp) return r;
+        // Find the subshell level that the entry is on.
+        for (level = savelevel; level > jp->level; level--) bp = bp->prev;
+    } else {
+        if (!(jp = bck.last)) return r;
+        for (jpp = &savetab[PIDHASH(jp->pid, savemask)]; *jpp != jp; jpp = &(*jpp)->nxtpid) {
+            ;  // empty loop
+        }
     }
-
-    if (!jp) return r;
     if (env >= 0 && jp->env != env) return r;
 
     r = 0;
     if (pid) r = jp->exitval;
-    if (jpold) {
-        jpold->next = jp->next;
+    *jpp = jp->nxtpid;
+    nsave--;
+    if (jp->prev) {
+        jp->prev->next = jp->next;
     } else {
         bp->list = jp->next;
     }
+    if (jp->next) {
+        jp->next->prev = jp->prev;
+    } else {
+        bp->last = jp->prev;
+    }
     bp->count--;
     if (njob_savelist < NJOB_SAVELIST) {
         njob_savelist++;
@@ -1825,30 +2172,32 @@ void *job_subsave(void) {
     bp->prev = bck.prev;
     bck.count = 0;
     bck.list = 0;
+    bck.last = 0;
     bck.prev = bp;
+    savelevel++;
     job_unlock();
     return bp;
 }
 
 void job_subrestore(Shell_t *shp, void *ptr) {
-    struct jobsave *jp, *jpnext;
+    struct jobsave *jp;
     struct back_save *bp = (struct back_save *)ptr;
     struct process *pw, *px, *pwnext;
-    struct jobsave *end = NULL;
-    int i = 0;
 
     job_lock();
-    for (jp = bck.list; jp; jp = jpnext, i++) {
-        if (!(jpnext = jp->next) || jp == jpnext) end = jp;
-        if (i >= shgd->lim.child_max) break;
-    }
-    if (end) {
-        end->next = bp->list;
-    } else {
+    // The entries of the subshell move down to the level of bp, in front of its own.
+    for (jp = bck.list; jp; jp = jp->next) jp->level = savelevel - 1;
+    if (!bck.list) {
         bck.list = bp->list;
+        bck.last = bp->last;
+    } else if (bp->list) {
+        bck.last->next = bp->list;
+        bp->list->prev = bck.last;
+        bck.last = bp->last;
     }
     bck.count += bp->count;
     bck.prev = bp->prev;
+    savelevel--;
     while (bck.count > shgd->lim.child_max) job_chksave(0, -1);
     for (pw = job.pwlist; pw; pw = pwnext) {
         pwnext = pw->p_nxtjob;
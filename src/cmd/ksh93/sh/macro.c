@@ -2309,8 +2309,8 @@ static_fn int substring(const char *string, size_t len, const char *pat, int mat
     sp += size;
     while (sp >= string) {
         if (mbwide()) sp = lastchar(string, sp);
-        n = strgrpmatch(sp, pat, (ssize_t *)smatch, elementsof(smatch) / 2,
-                        STR_RIGHT | STR_LEFT | STR_MAXIMAL | STR_INT);
+        n = strngrpmatch(sp, string + len - sp, pat, (ssize_t *)smatch, elementsof(smatch) / 2,
+                         STR_RIGHT | STR_LEFT | STR_MAXIMAL | STR_INT);
         if (n) {
             nmatch = n;
             memcpy(match, smatch, n * 2 * sizeof(smatch[0]));
@@ -42,7 +42,9 @@
 #include "stk.h"
 #include "variables.h"
 
-#define NVCACHE 8  // must be a power of 2 and not zero
+#define NVCACHE_MIN 32    // initial number of nv_open() cache entries; must be a power of 2
+#define NVCACHE_MAX 2048  // the cache never grows beyond this many entries
+#define NVCACHE_PROBE 4   // number of slots searched for a name; must be a power of 2
 
 // This var used to be writable but was treated as if it was immutable except for one assignment
 // that failed to validate it was modifying only the first, and only, char. So we now make it
@@ -102,8 +104,24 @@ struct adata {
     char **argnam;
     int attsize;
     char *attval;
+    bool dynamic;
 };
 
+unsigned int sh_envserial;
+
+//
+// The environment list generated by the last call to sh_envgen() when none of the exported
+// variables computes its value on demand. It is reused until the variable tree changes or one of
+// the nv_*() functions that modify an exported variable increments sh_envserial.
+//
+static struct {
+    Dt_t *root;
+    Dt_t *view;
+    unsigned int serial;
+    int count;
+    char **vec;
+} envcache;
+
 struct sh_type {
     void *previous;
     Namval_t **nodes;
@@ -112,22 +130,37 @@ struct sh_type {
     short maxnodes;
 };
 
+//
+// The nv_open() cache maps a name looked up in a dictionary to the node it resolved to. It is an
+// open addressed hash table keyed by the name and dictionary in which an entry is always within
+// NVCACHE_PROBE slots of its hash. A second set of chains links the entries by node so nv_delete()
+// only visits the entries that refer to the node being deleted. Entries for a dictionary that
+// views another, such as a function scope, are stamped with the scope generation, which
+// sh_unscope() advances, so they expire together with the scope. The table doubles in size each
+// time a table's worth of live entries has been evicted, up to NVCACHE_MAX entries.
+//
 struct Namcache {
     struct Cache_entry {
         Dt_t *root;
         Dt_t *last_root;
         char *name;
-        Namval_t *np;
+        Namval_t *np;  // NULL if this entry is unused
         Namval_t *last_table;
         Namval_t *namespace;
         nvflag_t flags;
+        unsigned int hash;
+        unsigned int gen;  // scope generation or 0 if root doesn't view another dictionary
+        int npnext;        // next entry on the same node chain or -1
         short size;
         short len;
-    } entries[NVCACHE];
-    short index;
+    } *entries;
+    int *npchain;       // first entry on each node chain or -1
+    unsigned int mask;  // number of entries minus one
+    unsigned int gen;   // current scope generation, never 0
+    int evictions;      // live entries replaced since the table was last resized
     short ok;
 };
-static struct Namcache nvcache;
+static struct Namcache nvcache = {.gen = 1};
 
 bool nv_local = false;
 
@@ -769,7 +802,8 @@ Namval_t *nv_create(const char *name, Dt_t *root, nvflag_t flags, Namfun_t *dp)
                     struct Ufunction *rp;
                     if ((rp = shp->st.real_fun) && !rp->sdict && (flags & NV_STATIC)) {
                         Dt_t *dp = dtview(shp->var_tree, NULL);
-                        rp->sdict = dtopen(&_Nvdisc, Dtoset);
+                        sh_envserial++;
+                        rp->sdict = dtopen(&_Nvdisc, Dtohset);
                         dtuserdata(rp->sdict, shp, 1);
                         dtview(rp->sdict, dp);
                         dtview(shp->var_tree, rp->sdict);
@@ -1117,6 +1151,186 @@ Namval_t *nv_create(const char *name, Dt_t *root, nvflag_t flags, Namfun_t *dp)
     }
 }
 
+//
+// Mix the bits of <h> so that the low order bits can be used as a table index.
+//
+static_fn unsigned int cache_mix(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    return h ^ (h >> 16);
+}
+
+//
+// Hash the first <len> bytes of <name> as looked up in dictionary <root>.
+//
+static_fn unsigned int cache_hash(const char *name, size_t len, Dt_t *root) {
+    unsigned int h = (unsigned int)((uintptr_t)root >> 4);
+    while (len-- > 0) h = h * 33 + *(unsigned char *)name++;
+    return cache_mix(h);
+}
+
+//
+// Return the head of the chain of entries that may refer to node <np>.
+//
+static_fn int *cache_chain(Namval_t *np) {
+    return &nvcache.npchain[cache_mix((unsigned int)((uintptr_t)np >> 4)) & nvcache.mask];
+}
+
+//
+// Return true if <xp> holds an entry that has not been invalidated.
+//
+static_fn bool cache_live(struct Cache_entry *xp) {
+    return xp->np && (xp->gen == 0 || xp->gen == nvcache.gen);
+}
+
+//
+// Invalidate cache entry <xp> and remove it from its node chain.
+//
+static_fn void cache_drop(struct Cache_entry *xp) {
+    int n = xp - nvcache.entries;
+    int *pp = cache_chain(xp->np);
+
+    while (*pp != n) pp = &nvcache.entries[*pp].npnext;
+    *pp = xp->npnext;
+    xp->np = NULL;
+    xp->root = NULL;
+}
+
+//
+// Keep the name that nv_open() is resolving out of the cache. This is called when a subscript of
+// the name is an arithmetic expression that refers to variables without looking them up again.
+//
+void nv_nocache(void) { nvcache.ok = 0; }
+
+//
+// Return the entry for <name>, of which the first <len> bytes are significant, as looked up in
+// <root> with <flags>, or NULL if it isn't cached.
+//
+static_fn struct Cache_entry *cache_find(Shell_t *shp, const char *name, size_t len, Dt_t *root,
+                                         nvflag_t flags) {
+    unsigned int i, hash = cache_hash(name, len, root);
+    struct Cache_entry *xp;
+
+    flags &= NV_ARRAY | NV_NOSCOPE;
+    for (i = 0; i < NVCACHE_PROBE; i++) {
+        xp = &nvcache.entries[(hash + i) & nvcache.mask];
+        if (xp->hash == hash && xp->root == root && (size_t)xp->len == len && cache_live(xp) &&
+            xp->namespace == shp->namespace && xp->flags == flags &&
+            memcmp(xp->name, name, len) == 0) {
+            return xp;
+        }
+    }
+    return NULL;
+}
+
+//
+// Return an entry that isn't live within the probe window of <hash>, or NULL if there is none.
+//
+static_fn struct Cache_entry *cache_slot(unsigned int hash) {
+    unsigned int i;
+    struct Cache_entry *xp;
+
+    for (i = 0; i < NVCACHE_PROBE; i++) {
+        xp = &nvcache.entries[(hash + i) & nvcache.mask];
+        if (!cache_live(xp)) {
+            if (xp->np) cache_drop(xp);
+            return xp;
+        }
+    }
+    return NULL;
+}
+
+//
+// Add entry <xp> to the chain for its node.
+//
+static_fn void cache_link(struct Cache_entry *xp) {
+    int *pp = cache_chain(xp->np);
+    xp->npnext = *pp;
+    *pp = xp - nvcache.entries;
+}
+
+//
+// Resize the cache to <size> entries, which must be a power of 2. Live entries are kept unless
+// there is no room for them in their probe window.
+//
+static_fn void cache_resize(unsigned int size) {
+    struct Cache_entry *old = nvcache.entries, *xp, *yp;
+    unsigned int i, n = old ? nvcache.mask + 1 : 0;
+
+    nvcache.entries = calloc(size, sizeof(struct Cache_entry));
+    nvcache.npchain = realloc(nvcache.npchain, size * sizeof(int));
+    nvcache.mask = size - 1;
+    nvcache.evictions = 0;
+    for (i = 0; i < size; i++) nvcache.npchain[i] = -1;
+    for (i = 0, xp = old; i < n; i++, xp++) {
+        if (!cache_live(xp) || !(yp = cache_slot(xp->hash))) {
+            free(xp->name);
+            continue;
+        }
+        *yp = *xp;
+        cache_link(yp);
+    }
+    free(old);
+}
+
+//
+// Remember that <name>, of which the first <len> bytes are significant, resolved to <np> when
+// looked up in <root> with <flags>. If there's no room a live entry is evicted, and once a table's
+// worth of entries have been evicted the table doubles in size.
+//
+static_fn void cache_add(Shell_t *shp, const char *name, int len, Dt_t *root, Namval_t *np,
+                         nvflag_t flags) {
+    unsigned int hash = cache_hash(name, len, root);
+    struct Cache_entry *xp;
+
+    if (len >= SHRT_MAX - 32) return;
+    if (!nvcache.entries) cache_resize(NVCACHE_MIN);
+    if (!(xp = cache_slot(hash))) {
+        if (++nvcache.evictions > (int)nvcache.mask && nvcache.mask + 1 < NVCACHE_MAX) {
+            cache_resize(2 * (nvcache.mask + 1));
+            xp = cache_slot(hash);
+        }
+        if (!xp) {
+            xp = &nvcache.entries[(hash + (nvcache.evictions & (NVCACHE_PROBE - 1))) &
+                                  nvcache.mask];
+            cache_drop(xp);
+        }
+    }
+    if (len + 1 > xp->size) {
+        xp->size = roundof(len + 1, 32);
+        xp->name = realloc(xp->name, xp->size);
+    }
+    memcpy(xp->name, name, len);
+    xp->name[len] = 0;
+    xp->len = len;
+    xp->hash = hash;
+    xp->root = root;
+    xp->np = np;
+    xp->namespace = shp->namespace;
+    xp->last_table = shp->last_table;
+    xp->last_root = shp->last_root;
+    xp->flags = (flags & (NV_ARRAY | NV_NOSCOPE));
+    xp->gen = dtvnext(root) ? nvcache.gen : 0;
+    cache_link(xp);
+}
+
+//
+// Expire the cache entries made in function scopes. Called when a scope is removed.
+//
+static_fn void cache_endscope(void) {
+    unsigned int i;
+
+    if (++nvcache.gen != 0) return;
+    // The generation wrapped around so drop the entries that could otherwise come back to life.
+    nvcache.gen = 1;
+    if (!nvcache.entries) return;
+    for (i = 0; i <= nvcache.mask; i++) {
+        if (nvcache.entries[i].np && nvcache.entries[i].gen) cache_drop(&nvcache.entries[i]);
+    }
+}
+
 //
 // Delete the node <np> from the dictionary <root> and clear from the cache.
 // If <root> is NULL, only the cache is cleared.
@@ -1124,12 +1338,17 @@ Namval_t *nv_create(const char *name, Dt_t *root, nvflag_t flags, Namfun_t *dp)
 // If np==0  && !root && flags==0,  delete the Refdict dictionary.
 //
 void nv_delete(Namval_t *np, Dt_t *root, nvflag_t flags) {
-    int c;
-    struct Cache_entry *xp;
+    int n;
 
     nv_isvalid(flags);
-    for (c = 0, xp = nvcache.entries; c < NVCACHE; xp = &nvcache.entries[++c]) {
-        if (xp->np == np) xp->root = NULL;
+    if (np && nv_isattr(np, NV_EXPORT)) sh_envserial++;
+    if (np) sh_arithforget(np);
+    if (np && nvcache.entries) {
+        for (n = *cache_chain(np); n >= 0;) {
+            struct Cache_entry *xp = &nvcache.entries[n];
+            n = xp->npnext;
+            if (xp->np == np) cache_drop(xp);
+        }
     }
     if (!np && !root && flags == 0) {
         if (Refdict) dtclose(Refdict);
@@ -1161,7 +1380,7 @@ void nv_delete(Namval_t *np, Dt_t *root, nvflag_t flags) {
                     nv_associative(np, 0, ASSOC_OP_FREE);
                     free(np->nvfun);
                 }
-                free(np);
+                nv_freenode(np);
             }
         }
 #if 0
@@ -1262,21 +1481,17 @@ Namval_t *nv_open(const char *name, Dt_t *root, nvflag_t flags) {
     }
     c = !isaletter(c);
     if (c) goto skip;
-    for (c = 0, xp = nvcache.entries; c < NVCACHE; xp = &nvcache.entries[++c]) {
-        if (xp->root != root) continue;
-        if ((*name != '_' || name[1] != '.') && *name == *xp->name &&
-            xp->namespace == shp->namespace && (flags & (NV_ARRAY | NV_NOSCOPE)) == xp->flags &&
-            strncmp(xp->name, name, xp->len) == 0 &&
-            (name[xp->len] == 0 || name[xp->len] == '=' || name[xp->len] == '+')) {
-            sh_stats(STAT_NVHITS);
-            np = xp->np;
-            cp = (char *)name + xp->len;
-            if (nv_isarray(np) && !(flags & NV_MOVE)) nv_putsub(np, NULL, 0, ARRAY_UNDEF);
-            shp->last_table = xp->last_table;
-            shp->last_root = xp->last_root;
-            goto nocache;
-        }
-    }
+    if (nvcache.entries && (*name != '_' || name[1] != '.') &&
+        (xp = cache_find(shp, name, strcspn(name, "=+"), root, flags))) {
+        sh_stats(STAT_NVHITS);
+        np = xp->np;
+        cp = (char *)name + xp->len;
+        if (nv_isarray(np) && !(flags & NV_MOVE)) nv_putsub(np, NULL, 0, ARRAY_UNDEF);
+        shp->last_table = xp->last_table;
+        shp->last_root = xp->last_root;
+        goto nocache;
+    }
+    sh_stats(STAT_NVMISS);
     nvcache.ok = 1;
 #if SHOPT_BASH
     if (root == shp->fun_tree && sh_isoption(shp, SH_BASH)) {
@@ -1292,32 +1507,14 @@ Namval_t *nv_open(const char *name, Dt_t *root, nvflag_t flags) {
         cp = fun.last;
     }
     if (np && nvcache.ok && cp[-1] != ']') {
-        xp = &nvcache.entries[nvcache.index];
         if (*cp) {
             char *sp = strchr(name, *cp);
             if (!sp) goto nocache;
-            xp->len = sp - name;
+            c = sp - name;
         } else {
-            xp->len = strlen(name);
+            c = strlen(name);
         }
-        c = roundof(xp->len + 1, 32);
-        if (c > xp->size) {
-            if (xp->size == 0) {
-                xp->name = malloc(c);
-            } else {
-                xp->name = realloc(xp->name, c);
-            }
-            xp->size = c;
-        }
-        memcpy(xp->name, name, xp->len);
-        xp->name[xp->len] = 0;
-        xp->root = root;
-        xp->np = np;
-        xp->namespace = shp->namespace;
-        xp->last_table = shp->last_table;
-        xp->last_root = shp->last_root;
-        xp->flags = (flags & (NV_ARRAY | NV_NOSCOPE));
-        nvcache.index = (nvcache.index + 1) & (NVCACHE - 1);
+        cache_add(shp, name, c, root, np, flags);
     }
 nocache:
     nvcache.ok = 0;
@@ -1443,6 +1640,7 @@ void nv_putval(Namval_t *np, const void *vp, nvflag_t flags) {
         errormsg(SH_DICT, ERROR_exit(1), e_readonly, nv_name(np));
         __builtin_unreachable();
     }
+    if (nv_isattr(np, NV_EXPORT)) sh_envserial++;
     // The following could cause the shell to fork if assignment would cause a side effect.
     shp->argaddr = NULL;
     if (shp->subshell && !nv_local && !(flags & NV_RDONLY)) np = sh_assignok(np, 1);
@@ -1933,6 +2131,7 @@ static_fn void pushnam(Namval_t *np, void *data) {
     struct adata *ap = (struct adata *)data;
     ap->sh = sh_ptr(np);
     ap->tp = NULL;
+    if (nv_hasget(np) || nv_isarray(np) || nv_isref(np) || nv_isvtree(np)) ap->dynamic = true;
     if (nv_isattr(np, NV_IMPORT) && np->nvenv) {
         assert(np->nvenv_is_cp);
         *ap->argnam++ = (char *)np->nvenv;
@@ -1945,6 +2144,34 @@ static_fn void pushnam(Namval_t *np, void *data) {
     }
 }
 
+//
+// Save a copy of the environment list <er> with <count> entries in the cache.
+//
+static_fn void envsave(Shell_t *shp, char **er, int count) {
+    size_t size = (count + 1) * sizeof(char *);
+    char *cp, **vec;
+    int n;
+
+    for (n = 0; n < count; n++) size += strlen(er[n]) + 1;
+    vec = realloc(envcache.vec, size);
+    if (!vec) {
+        free(envcache.vec);
+        envcache.vec = NULL;
+        return;
+    }
+    cp = (char *)&vec[count + 1];
+    for (n = 0; n < count; n++) {
+        vec[n] = cp;
+        cp = stpcpy(cp, er[n]) + 1;
+    }
+    vec[count] = NULL;
+    envcache.vec = vec;
+    envcache.count = count;
+    envcache.root = shp->var_tree;
+    envcache.view = shp->var_tree->view;
+    envcache.serial = sh_envserial;
+}
+
 //
 // Generate the environment list for the child.
 //
@@ -1957,8 +2184,16 @@ char **sh_envgen(Shell_t *shp) {
     data.sh = shp;
     data.tp = NULL;
     data.mapname = 0;
+    data.dynamic = false;
     // L_ARGNOD gets generated automatically as full path name of command.
     nv_offattr(L_ARGNOD, NV_EXPORT);
+    if (envcache.vec && envcache.serial == sh_envserial && envcache.root == shp->var_tree &&
+        envcache.view == shp->var_tree->view) {
+        // Callers may use the two slots in front of the list, so give each one its own copy.
+        er = stkalloc(shp->stk, (envcache.count + 3) * sizeof(char *));
+        memcpy(er += 2, envcache.vec, (envcache.count + 1) * sizeof(char *));
+        return er;
+    }
     data.attsize = 6;
     namec = nv_scan(shp->var_tree, NULL, NULL, NV_EXPORT, NV_EXPORT);
     namec += shp->nenv;
@@ -1973,6 +2208,7 @@ char **sh_envgen(Shell_t *shp) {
     *data.attval = 0;
     if (cp != data.attval) data.argnam++;
     *data.argnam = 0;
+    if (!data.dynamic) envsave(shp, er, data.argnam - er);
     return er;
 }
 
@@ -2058,7 +2294,8 @@ void sh_scope(Shell_t *shp, struct argnod *envlist, int fun) {
     struct Ufunction *rp;
 
     if (shp->namespace) newroot = nv_dict(shp->namespace);
-    newscope = dtopen(&_Nvdisc, Dtoset);
+    sh_envserial++;
+    newscope = dtopen(&_Nvdisc, Dtohset);
     dtuserdata(newscope, shp, 1);
     if (envlist) {
         dtview(newscope, shp->var_tree);
@@ -2170,6 +2407,7 @@ void _nv_unset(Namval_t *np, nvflag_t flags) {
         errormsg(SH_DICT, ERROR_exit(1), e_readonly, nv_name(np));
         __builtin_unreachable();
     }
+    if (nv_isattr(np, NV_EXPORT)) sh_envserial++;
     if (is_afunction(np) && FETCH_VT(np->nvalue, rp)) {
         struct slnod *slp = (struct slnod *)(np->nvenv);
         if (FETCH_VT(np->nvalue, rp)->running) {
@@ -2203,6 +2441,8 @@ void _nv_unset(Namval_t *np, nvflag_t flags) {
         }
         if (rp->sdict) {
             Namval_t *mp, *nq;
+            // Only the static variables are to be deleted, not what the dictionary views.
+            dtview(rp->sdict, NULL);
             for (mp = (Namval_t *)dtfirst(rp->sdict); mp; mp = nq) {
                 nq = dtnext(rp->sdict, mp);
                 _nv_unset(mp, NV_RDONLY);
@@ -2210,6 +2450,8 @@ void _nv_unset(Namval_t *np, nvflag_t flags) {
             }
             dtclose(rp->sdict);
         }
+        sh_memgrow(MEM_FUNCTIONS, -(ssize_t)stksize(slp->slptr));
+        sh_memfree(MEM_FUNCTIONS, sizeof(struct Ufunction));
         stkclose(slp->slptr);
         free(FETCH_VT(np->nvalue, ip));
         STORE_VT(np->nvalue, ip, NULL);
@@ -2682,6 +2924,7 @@ void nv_newattr(Namval_t *np, nvflag_t newatts, int size) {
             _nv_unset(np, NV_EXPORT);
         }
         nv_setsize(np, size);
+        if ((np->nvflag | newatts) & NV_EXPORT) sh_envserial++;
         np->nvflag &= (NV_ARRAY | NV_NOFREE);
         np->nvflag |= newatts;
         if (cp) {
@@ -2785,13 +3028,14 @@ static_fn char *lastdot(char *cp, int eq, void *context) {
 // Purge all entries whose name is of the form name.
 //
 static_fn void cache_purge(const char *name) {
-    int c;
+    unsigned int i;
     size_t len = strlen(name);
     struct Cache_entry *xp;
 
-    for (c = 0, xp = nvcache.entries; c < NVCACHE; xp = &nvcache.entries[++c]) {
-        if (xp->len <= len || xp->name[len] != '.') continue;
-        if (strncmp(name, xp->name, len) == 0) xp->root = NULL;
+    if (!nvcache.entries) return;
+    for (i = 0, xp = nvcache.entries; i <= nvcache.mask; i++, xp++) {
+        if (!xp->np || (size_t)xp->len <= len || xp->name[len] != '.') continue;
+        if (strncmp(name, xp->name, len) == 0) cache_drop(xp);
     }
 }
 
@@ -3113,6 +3357,7 @@ Shscope_t *sh_getscope(Shell_t *shp, int index, int whence) {
 //
 Shscope_t *sh_setscope(Shell_t *shp, Shscope_t *scope) {
     Shscope_t *old = (Shscope_t *)shp->st.self;
+    sh_envserial++;
     *shp->st.self = shp->st;
     shp->st = *((struct sh_scoped *)scope);
     shp->var_tree = scope->var_tree;
@@ -3124,6 +3369,7 @@ Shscope_t *sh_setscope(Shell_t *shp, Shscope_t *scope) {
 void sh_unscope(Shell_t *shp) {
     Dt_t *root = shp->var_tree;
     Dt_t *dp = dtview(root, NULL);
+    sh_envserial++;
     if (dp) {
         table_unset(shp, root, NV_RDONLY | NV_NOSCOPE, dp);
         if (shp->st.real_fun && dp == shp->st.real_fun->sdict) {
@@ -3132,6 +3378,7 @@ void sh_unscope(Shell_t *shp) {
         }
         shp->var_tree = dp;
         dtclose(root);
+        cache_endscope();
     }
 }
 
@@ -549,7 +549,7 @@ static_fn void putdisc(Namval_t *np, const void *val, nvflag_t flag, Namfun_t *f
             if (mp && !nv_isattr(mp, NV_NOFREE) && is_abuiltin(mp)) {
                 if (mp->nvfun && !nv_isattr(mp, NV_NOFREE)) free(mp->nvfun);
                 dtdelete(shp->bltin_tree, mp);
-                free(mp);
+                nv_freenode(mp);
             }
         }
         nv_disc(np, fp, DISC_OP_POP);
@@ -732,9 +732,20 @@ static_fn void *newnode(const char *name) {
     assert(np);
     np->nvname = (char *)np + sizeof(Namval_t);
     memcpy(np->nvname, name, s);
+    sh_memalloc(MEM_VARS, sizeof(Namval_t) + s);
     return np;
 }
 
+//
+// Free a node removed from its dictionary. Only nodes made by newnode() were charged to .sh.mem.
+//
+void nv_freenode(Namval_t *np) {
+    if (np->nvname == (char *)np + sizeof(Namval_t)) {
+        sh_memfree(MEM_VARS, sizeof(Namval_t) + strlen(np->nvname) + 1);
+    }
+    free(np);
+}
+
 //
 // Clone a numeric value.
 //
@@ -812,6 +823,7 @@ int nv_clone(Namval_t *np, Namval_t *mp, nvflag_t flags) {
     }
     mp->nvfun = fp;
     fp = np->nvfun;
+    if (nv_isattr(np, NV_EXPORT) || nv_isattr(mp, NV_EXPORT)) sh_envserial++;
     if (fp) {
         Shell_t *shp = np->nvshell;
         Namval_t *last_table = shp->last_table;
@@ -1175,7 +1187,7 @@ static_fn Namfun_t *clone_table(Namval_t *np, Namval_t *mp, nvflag_t flags, Namf
     struct table *tp = (struct table *)fp;
     struct table *ntp = (struct table *)nv_clone_disc(fp, 0);
     Dt_t *oroot = tp->dict;
-    Dt_t *nroot = dtopen(&_Nvdisc, Dtoset);
+    Dt_t *nroot = dtopen(&_Nvdisc, oroot->meth);
     assert(nroot);
 
     dtuserdata(nroot, dtuserdata(oroot, 0, 0), 1);
@@ -1224,7 +1236,7 @@ static_fn void put_table(Namval_t *np, const void *val, nvflag_t flags, Namfun_t
         _nv_unset(mp, flags);
         nq = dtnext(root, mp);
         dtdelete(root, mp);
-        free(mp);
+        nv_freenode(mp);
     }
     dtclose(root);
     if (!(fp->nofree & 1)) free(fp);
@@ -394,6 +394,7 @@ void nv_attribute(Namval_t *np, Sfio_t *out, char *prefix, int noname) {
     char *ip = NULL;
     Namfun_t *fp = NULL;
     Namval_t *typep = NULL;
+    bool ordered = false;
 
     for (fp = np->nvfun; fp; fp = fp->next) {
         if ((typep = fp->type) ||
@@ -468,6 +469,7 @@ void nv_attribute(Namval_t *np, Sfio_t *out, char *prefix, int noname) {
                     char **xp = NULL;
                     if (ap && is_associative(ap)) {
                         if (tp->sh_name[1] != 'A') continue;
+                        ordered = ap->table && ap->table->meth == Dtiset;
                     } else if (tp->sh_name[1] == 'A') {
                         continue;
                     }
@@ -487,11 +489,19 @@ void nv_attribute(Namval_t *np, Sfio_t *out, char *prefix, int noname) {
                 }
                 if (prefix) {
                     if (*tp->sh_name == '-') sfprintf(out, "%.2s ", tp->sh_name);
+                    if (ordered) {
+                        sfwrite(out, "-O ", 3);
+                        ordered = false;
+                    }
                     if (ip) {
                         sfprintf(out, "[%s] ", ip);
                         ip = NULL;
                     }
                 } else {
+                    if (ordered) {
+                        sfputr(out, "ordered", ' ');
+                        ordered = false;
+                    }
                     sfputr(out, tp->sh_name + 3, ' ');
                 }
                 if ((val & (NV_LJUST | NV_RJUST | NV_ZFILL)) && !(val & NV_INTEGER) &&
@@ -1124,7 +1134,7 @@ static_fn char *walk_tree(Namval_t *np, Namval_t *xp, nvflag_t flags) {
 }
 
 Namfun_t *nv_isvtree(Namval_t *np) {
-    if (np == SH_STATS || np == SH_SIG) return (Namfun_t *)1;
+    if (np == SH_STATS || np == SH_MEM || np == SH_SIG) return (Namfun_t *)1;
     if (np) return nv_hasdisc(np, &treedisc);
     return NULL;
 }
@@ -567,6 +567,8 @@ static_fn void put_type(Namval_t *np, const void *val, nvflag_t flag, Namfun_t *
             if (!nv_hasdisc(nq, &type_disc)) {
                 _nv_unset(nq, flag | NV_TYPE | nv_isattr(nq, NV_RDONLY));
             }
+            // The members go away with the discipline so they must not be found in the cache.
+            nv_delete(nq, NULL, NV_NOFREE);
         }
         nv_disc(np, fp, DISC_OP_POP);
         if (!(fp->nofree & 1)) free(fp);
@@ -308,7 +308,7 @@ Shnode_t *sh_parse(Shell_t *shp, Sfio_t *iop, int flag) {
     int sav_prompt = shp->nextprompt;
 
     if (shp->binscript && (sffileno(iop) == shp->infd || (flag & SH_FUNEVAL))) {
-        return sh_trestore(shp, iop);
+        return sh_trestore(shp, iop, shp->binscript - 1);
     }
     fcsave(&sav_input);
     shp->st.staklist = NULL;
@@ -334,17 +334,18 @@ Shnode_t *sh_parse(Shell_t *shp, Sfio_t *iop, int flag) {
             fcclose();
             fcrestore(&sav_input);
             lexp->arg = sav_arg;
-            if (version > 3) {
+            if (version > PCACHE_VERSION) {
                 errormsg(SH_DICT, ERROR_exit(1), e_lexversion);
                 __builtin_unreachable();
             }
-            if (sffileno(iop) == shp->infd || (flag & SH_FUNEVAL)) shp->binscript = 1;
+            // Remember the version for the calls that read the rest of the script.
+            if (sffileno(iop) == shp->infd || (flag & SH_FUNEVAL)) shp->binscript = version + 1;
             sfgetc(iop);
-            t = sh_trestore(shp, iop);
+            t = sh_trestore(shp, iop, version);
             if (flag & SH_NL) {
                 Shnode_t *tt;
                 while (1) {
-                    if (!(tt = sh_trestore(shp, iop))) break;
+                    if (!(tt = sh_trestore(shp, iop, version))) break;
                     t = makelist(lexp, TLST, t, tt);
                 }
             }
@@ -782,6 +783,7 @@ static_fn Shnode_t *funct(Lex_t *lexp) {
                     np->nvalue, rp,
                     calloc(1, sizeof(struct Ufunction) + (shp->funload ? sizeof(Dtlink_t) : 0)));
                 memset(FETCH_VT(np->nvalue, rp), 0, sizeof(struct Ufunction));
+                sh_memalloc(MEM_FUNCTIONS, sizeof(struct Ufunction));
                 FETCH_VT(np->nvalue, rp)->argc = ((struct dolnod *)ac->comarg)->dolnum;
             }
         }
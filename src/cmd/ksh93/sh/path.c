@@ -51,6 +51,7 @@
 #include "path.h"
 #include "sfio.h"
 #include "shcmd.h"
+#include "shnodes.h"
 #include "stk.h"
 #include "test.h"
 #include "variables.h"
@@ -590,7 +591,11 @@ static_fn void funload(Shell_t *shp, int fno, const char *name) {
     shp->st.filename = pname;
     shp->funload = 1;
     error_info.line = 0;
-    sh_eval(shp, sfnew(NULL, buff, IOBSIZE, fno, SF_READ), SH_FUNEVAL);
+    if (pcache_open(shp, fno, pname)) {
+        sh_eval(shp, sfnew(NULL, NULL, SF_UNBOUND, fno, SF_READ), SH_FUNEVAL);
+    } else {
+        sh_eval(shp, sfnew(NULL, buff, IOBSIZE, fno, SF_READ), SH_FUNEVAL);
+    }
     sh_close(fno);
     shp->readscript = NULL;
     if (shp->namespace) {
@@ -0,0 +1,206 @@
+//
+// Cache of the parse trees of scripts read by the `.` command and of function files autoloaded from
+// FPATH. It is enabled by setting KSH_PARSE_CACHE to the name of a directory.
+//
+// Each entry is the tree of one script in the format written by sh_tdump(). It is named by a hash
+// of the script's path, device, inode, size and modification and change times, the shell version,
+// and the aliases and options that affect how the script is parsed. A script that has not changed
+// since it was last read is therefore restored from its entry rather than lexed and parsed again.
+// Entries are never rewritten in place; a new one is written to a temporary file which is renamed
+// once complete, so a concurrent reader sees either no entry or a whole one.
+//
+#include "config_ast.h"  // IWYU pragma: keep
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ast.h"
+#include "cdt.h"
+#include "defs.h"
+#include "name.h"
+#include "sfio.h"
+#include "shnodes.h"
+#include "tmx.h"
+#include "tv.h"
+
+#define CNTL(x) ((x)&037)
+static const char header[6] = {CNTL('k'), CNTL('s'), CNTL('h'), 0, PCACHE_VERSION, 0};
+
+struct Pcache {
+    Shell_t *shp;
+    int fd;        // descriptor of the script whose trees are recorded
+    bool failed;   // a tree could not be written
+    Sfio_t *out;   // the trees recorded so far
+    char name[1];  // pathname of the entry; must be last
+};
+
+//
+// FNV-1a hash of <len> bytes at <data> continuing from <h>.
+//
+static_fn uint64_t pcache_hash(uint64_t h, const void *data, size_t len) {
+    const unsigned char *cp = data;
+    while (len-- > 0) {
+        h ^= *cp++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+//
+// Return the hash identifying the entry for the script with pathname <path> and status <sp>.
+//
+static_fn uint64_t pcache_key(Shell_t *shp, const char *path, const struct stat *sp) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    Time_t t;
+    int opts = 0;
+
+    h = pcache_hash(h, path, strlen(path) + 1);
+    h = pcache_hash(h, &sp->st_dev, sizeof(sp->st_dev));
+    h = pcache_hash(h, &sp->st_ino, sizeof(sp->st_ino));
+    h = pcache_hash(h, &sp->st_size, sizeof(sp->st_size));
+    t = tmxgetmtime(sp);
+    h = pcache_hash(h, &t, sizeof(t));
+    t = tmxsns(sp->st_ctime, ST_CTIME_NSEC_GET(sp));
+    h = pcache_hash(h, &t, sizeof(t));
+    h = pcache_hash(h, e_version, strlen(e_version));
+    if (sh_isoption(shp, SH_POSIX)) opts |= 1;
+    if (sh_isoption(shp, SH_BASH)) opts |= 2;
+    if (sh_isoption(shp, SH_BRACEEXPAND)) opts |= 4;
+    if (sh_isoption(shp, SH_KEYWORD)) opts |= 8;
+    if (sh_isstate(shp, SH_PROFILE)) opts |= 16;
+    if (sh_isstate(shp, SH_NOALIAS)) opts |= 32;
+    h = pcache_hash(h, &opts, sizeof(opts));
+    if (!(opts & 32)) {
+        // Aliases are expanded as the script is parsed.
+        Namval_t *np;
+        for (np = dtfirst(shp->alias_tree); np; np = dtnext(shp->alias_tree, np)) {
+            char *cp = nv_getval(np);
+            if (!cp) continue;
+            h = pcache_hash(h, np->nvname, strlen(np->nvname) + 1);
+            h = pcache_hash(h, cp, strlen(cp) + 1);
+        }
+    }
+    return h;
+}
+
+//
+// Called with the descriptor <fd> of the script <path> which is about to be read. If it has an
+// entry in the cache <fd> is changed to refer to the entry and true is returned. Otherwise the
+// trees parsed from <fd> by the next sh_eval() are recorded as a new entry and false is returned.
+//
+bool pcache_open(Shell_t *shp, int fd, const char *path) {
+    Namval_t *np;
+    struct Pcache *pcp;
+    struct stat statb;
+    char *dir, name[PATH_MAX], buff[sizeof(header)];
+    int cfd;
+
+    np = nv_open("KSH_PARSE_CACHE", shp->var_tree, NV_NOADD);
+    if (!np || !(dir = nv_getval(np)) || !*dir) return false;
+    // These options have effects while parsing that a restored tree would not repeat.
+    if (sh_isoption(shp, SH_NOEXEC) || sh_isoption(shp, SH_VERBOSE)) return false;
+    if (fstat(fd, &statb) < 0 || !S_ISREG(statb.st_mode)) return false;
+    if (snprintf(name, sizeof(name), "%s/%016llx", dir,
+                 (unsigned long long)pcache_key(shp, path, &statb)) >= (int)sizeof(name)) {
+        return false;
+    }
+
+    cfd = open(name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (cfd >= 0) {
+        // Only trust an entry written by this user.
+        if (fstat(cfd, &statb) >= 0 && S_ISREG(statb.st_mode) && statb.st_uid == geteuid() &&
+            pread(cfd, buff, sizeof(buff), 0) == sizeof(buff) &&
+            memcmp(buff, header, sizeof(header)) == 0 && dup2(cfd, fd) >= 0) {
+            (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+            close(cfd);
+            sh_stats(STAT_PCHIT);
+            return true;
+        }
+        close(cfd);
+    }
+
+    sh_stats(STAT_PCMISS);
+    if (shp->parsecache) pcache_close(shp->parsecache, false);
+    pcp = malloc(sizeof(struct Pcache) + strlen(name));
+    if (!pcp) return false;
+    pcp->shp = shp;
+    pcp->fd = fd;
+    pcp->failed = false;
+    pcp->out = sfstropen();
+    if (!pcp->out) {
+        free(pcp);
+        return false;
+    }
+    sfwrite(pcp->out, header, sizeof(header));
+    strcpy(pcp->name, name);
+    shp->parsecache = pcp;
+    return false;
+}
+
+//
+// Called by sh_eval() for its input stream <iop>. Return the pending entry if it is for <iop>.
+//
+void *pcache_claim(Shell_t *shp, Sfio_t *iop) {
+    struct Pcache *pcp = shp->parsecache;
+
+    if (!pcp) return NULL;
+    shp->parsecache = NULL;
+    if (sffileno(iop) == pcp->fd) return pcp;
+    pcache_close(pcp, false);
+    return NULL;
+}
+
+//
+// Add tree <t> to the entry being recorded.
+//
+void pcache_record(void *ptr, const Shnode_t *t) {
+    struct Pcache *pcp = ptr;
+    Sfio_t *heredocs = pcp->shp->heredocs;
+    Sfoff_t off;
+
+    if (!t || pcp->failed) return;
+    // Writing here-documents moves the here-document file which the lexer may still be using.
+    off = heredocs ? sftell(heredocs) : 0;
+    if (sh_tdump(pcp->out, t, PCACHE_VERSION) < 0) pcp->failed = true;
+    if (heredocs) sfseek(heredocs, off, SEEK_SET);
+}
+
+//
+// Finish the entry being recorded. It is added to the cache if <keep> is true, which means the
+// whole script was parsed, and every tree was written.
+//
+void pcache_close(void *ptr, bool keep) {
+    struct Pcache *pcp = ptr;
+    char tmp[PATH_MAX + 16];
+    size_t size = sfstrtell(pcp->out);
+    int fd;
+
+    if (keep && !pcp->failed &&
+        snprintf(tmp, sizeof(tmp), "%s.%d", pcp->name, (int)getpid()) < (int)sizeof(tmp)) {
+        fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fd < 0 && errno == ENOENT) {
+            // Create the cache directory the first time it is used.
+            char *cp = strrchr(tmp, '/');
+            *cp = 0;
+            if (mkdir(tmp, 0700) >= 0) {
+                *cp = '/';
+                fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+            }
+        }
+        if (fd >= 0) {
+            bool ok = write(fd, sfstrbase(pcp->out), size) == (ssize_t)size;
+            if (close(fd) < 0) ok = false;
+            if (!ok || rename(tmp, pcp->name) < 0) unlink(tmp);
+        }
+    }
+    sfstrclose(pcp->out);
+    free(pcp);
+}
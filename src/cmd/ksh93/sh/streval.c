@@ -47,6 +47,7 @@
 
 #define MAXLEVEL 1024
 #define SMALL_STACK 12
+#define MAXCONST 8  // number of recent constants that are candidates for folding
 
 //
 // The following are used with tokenbits() macro.
@@ -82,6 +83,12 @@ typedef struct vars {  // vars stacked per invocation
     char infun;           // incremented by comma inside function
     int emode;
     Sfdouble_t (*convert)(const char **, struct lval *, int, Sfdouble_t);
+    int nconst;  // number of entries in consts[]
+    struct {     // integer constants most recently pushed, the last one on top
+        int start;
+        int end;
+        Sflong_t value;
+    } consts[MAXCONST];
 } vars_t;
 
 typedef Sfdouble_t (*Math_f)(Sfdouble_t, ...);
@@ -152,6 +159,112 @@ static_fn Sfdouble_t U2F(Sfulong_t u) {
 #define U2F(x) x
 #endif
 
+//
+// Apply operator op to the integers x and y, or to y alone for a unary operator, and store the
+// result in *r. Returns false, leaving *r alone, unless the result is an exact integer that is
+// equal to what the Sfdouble_t arithmetic in arith_exec() computes for the same operands. This
+// lets arith_exec() skip the conversions to and from Sfdouble_t when both operands are integers
+// and lets arith_compile() fold operators applied to constants.
+//
+static inline bool intop(int op, Sflong_t x, Sflong_t y, Sflong_t *r) {
+    Sflong_t z;
+
+    switch (op) {
+        case A_PLUS: {
+            if (__builtin_add_overflow(x, y, &z)) return false;
+            break;
+        }
+        case A_MINUS: {
+            if (__builtin_sub_overflow(x, y, &z)) return false;
+            break;
+        }
+        case A_TIMES: {
+            if (__builtin_mul_overflow(x, y, &z)) return false;
+            break;
+        }
+        case A_DIV: {
+            if (y == 0 || (y == -1 && x == LLONG_MIN)) return false;
+            // Integer division rounds toward negative infinity, as floorl() does.
+            z = x / y;
+            if (x % y && (x < 0) != (y < 0)) z--;
+            break;
+        }
+        case A_MOD: {
+            if (y == 0) return false;
+            z = y == -1 ? 0 : x % y;
+            break;
+        }
+        case A_AND: {
+            z = x & y;
+            break;
+        }
+        case A_OR: {
+            z = x | y;
+            break;
+        }
+        case A_XOR: {
+            z = x ^ y;
+            break;
+        }
+        case A_LSHIFT: {
+            if (y < 0) return false;
+            z = y >= CHAR_BIT * sizeof(Sfulong_t) ? 0 : (Sflong_t)((Sfulong_t)x << y);
+            break;
+        }
+        case A_RSHIFT: {
+            if (y < 0) return false;
+            z = y >= CHAR_BIT * sizeof(Sfulong_t) ? 0 : x >> y;
+            break;
+        }
+        case A_EQ: {
+            z = x == y;
+            break;
+        }
+        case A_NEQ: {
+            z = x != y;
+            break;
+        }
+        case A_LT: {
+            z = x < y;
+            break;
+        }
+        case A_LE: {
+            z = x <= y;
+            break;
+        }
+        case A_GT: {
+            z = x > y;
+            break;
+        }
+        case A_GE: {
+            z = x >= y;
+            break;
+        }
+        case A_UMINUS: {
+            if (y == LLONG_MIN) return false;
+            z = -y;
+            break;
+        }
+        case A_NOT: {
+            z = !y;
+            break;
+        }
+        case A_NOTNOT: {
+            z = y != 0;
+            break;
+        }
+        case A_TILDE: {
+            z = ~y;
+            break;
+        }
+        default: {
+            return false;
+        }
+    }
+    *r = z;
+    return true;
+}
+
 static_fn void array_args(Shell_t *shp, char *tp, int n) {
     while (n--) {
         if (tp[n] == 5) {
@@ -162,11 +275,15 @@ static_fn void array_args(Shell_t *shp, char *tp, int n) {
 }
 
 Sfdouble_t arith_exec(Arith_t *ep) {
-    Sfdouble_t num = 0, *dp, *sp;
+    Sfdouble_t num = 0, *dp, *sp, *sbase;
     unsigned char *cp = ep->code;
-    int c, type = 0;
+    int c, ik, type = 0;
     char *tp;
     Sfdouble_t d, small_stack[SMALL_STACK + 1], arg[9];
+    // Each stack entry, and num, also has its value as an integer when it is known to be one.
+    Sflong_t inum = 0, *istack, small_istack[SMALL_STACK];
+    char *iokstack, small_iokstack[SMALL_STACK];
+    bool iok = false, numint;
     const char *ptr = "";
     char *lastval = NULL;
     int lastsub = 0;
@@ -184,17 +301,33 @@ Sfdouble_t arith_exec(Arith_t *ep) {
     }
     if (ep->staksize < SMALL_STACK) {
         sp = small_stack;
+        tp = (char *)(sp + ep->staksize);
+        istack = small_istack;
+        iokstack = small_iokstack;
     } else {
-        sp = stkalloc(shp->stk, ep->staksize * (sizeof(Sfdouble_t) + 1));
+        sp = stkalloc(shp->stk, ep->staksize * (sizeof(Sfdouble_t) + sizeof(Sflong_t) + 2));
+        istack = (Sflong_t *)(sp + ep->staksize);
+        tp = (char *)(istack + ep->staksize);
+        iokstack = tp + ep->staksize;
     }
-    tp = (char *)(sp + ep->staksize);
+    sbase = sp;
     tp--, sp--;
     while ((c = *cp++)) {
+        numint = iok;
+        iok = false;
+        ik = sp - sbase;
         if (c & T_NOFLOAT) {
             if (type || ((c & T_BINARY) && (c & T_OP) != A_MOD && tp[-1] == 1)) {
                 arith_error(e_incompatible, ep->expr, ep->emode);
             }
         }
+        if (numint && (c & T_BINARY) && iokstack[ik - 1] &&
+            intop(c & T_OP, istack[ik - 1], inum, &inum)) {
+            // Both operands are exact integers and so is the result.
+            iok = true;
+            num = inum;
+            goto pop;
+        }
         switch (c & T_OP) {
             case A_JMP:
             case A_JMPZ:
@@ -206,33 +339,50 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 } else {
                     cp = (unsigned char *)ep + *((short *)cp);
                 }
+                iok = numint;
                 continue;
             }
             case A_NOTNOT: {
                 num = (num != 0);
+                inum = num;
+                iok = true;
                 type = 0;
                 break;
             }
             case A_PLUSPLUS: {
                 node.nosub = -1;
+                node.isint = numint && !__builtin_add_overflow(inum, 1, &node.ivalue);
                 (*ep->fun)(&ptr, &node, ASSIGN, num + 1);
+                iok = numint;
                 break;
             }
             case A_MINUSMINUS: {
                 node.nosub = -1;
+                node.isint = numint && !__builtin_sub_overflow(inum, 1, &node.ivalue);
                 (*ep->fun)(&ptr, &node, ASSIGN, num - 1);
+                iok = numint;
                 break;
             }
             case A_INCR: {
                 num = num + 1;
                 node.nosub = -1;
+                node.isint = numint && !__builtin_add_overflow(inum, 1, &node.ivalue);
                 num = (*ep->fun)(&ptr, &node, ASSIGN, num);
+                if (node.isint) {
+                    inum = node.ivalue;
+                    iok = true;
+                }
                 break;
             }
             case A_DECR: {
                 num = num - 1;
                 node.nosub = -1;
+                node.isint = numint && !__builtin_sub_overflow(inum, 1, &node.ivalue);
                 num = (*ep->fun)(&ptr, &node, ASSIGN, num);
+                if (node.isint) {
+                    inum = node.ivalue;
+                    iok = true;
+                }
                 break;
             }
             case A_SWAP: {
@@ -240,6 +390,10 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 sp[-1] = *sp;
                 type = tp[-1];
                 tp[-1] = *tp;
+                inum = istack[ik - 1];
+                iok = iokstack[ik - 1];
+                istack[ik - 1] = istack[ik];
+                iokstack[ik - 1] = iokstack[ik];
                 break;
             }
             case A_POP: {
@@ -261,6 +415,7 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 node.flag = c;
                 if (node.flag) lastval = NULL;
                 node.isfloat = 0;
+                node.isint = 0;
                 node.level = level;
                 node.nosub = 0;
                 node.nextop = *cp;
@@ -276,12 +431,23 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 }
                 if (node.value != (char *)dp) arith_error(node.value, ptr, ep->emode);
                 *++sp = num;
-                type = node.isfloat;
-                if ((d = num) > LDBL_LLONG_MAX && num <= LDBL_ULLONG_MAX) {
-                    type = TYPE_U;
-                    d -= LDBL_LLONG_MAX;
+                if (node.isint) {
+                    inum = node.ivalue;
+                    iok = true;
+                    type = 0;
+                } else {
+                    type = node.isfloat;
+                    if ((d = num) > LDBL_LLONG_MAX && num <= LDBL_ULLONG_MAX) {
+                        type = TYPE_U;
+                        d -= LDBL_LLONG_MAX;
+                    }
+                    if ((Sflong_t)d != d) {
+                        type = TYPE_LD;
+                    } else if (type == 0) {
+                        inum = (Sflong_t)d;
+                        iok = true;
+                    }
                 }
-                if ((Sflong_t)d != d) type = TYPE_LD;
                 *++tp = type;
                 c = 0;
                 break;
@@ -306,15 +472,26 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 node.flag = c;
                 if (lastval) node.eflag = 1;
                 node.ptr = NULL;
+                node.isint = numint;
+                node.ivalue = inum;
                 num = (*ep->fun)(&ptr, &node, ASSIGN, num);
+                if (numint && node.isint) {
+                    inum = node.ivalue;
+                    iok = true;
+                } else if (numint && num == (Sfdouble_t)inum) {
+                    iok = true;
+                }
                 if (lastval && node.ptr) {
                     Sfdouble_t r;
                     node.flag = 0;
                     node.value = lastval;
+                    node.isint = 0;
                     r = (*ep->fun)(&ptr, &node, VALUE, num);
+                    iok = false;
                     if (r != num) {
                         node.flag = c;
                         node.value = (char *)dp;
+                        node.isint = 0;
                         num = (*ep->fun)(&ptr, &node, ASSIGN, r);
                     }
 
@@ -330,6 +507,7 @@ Sfdouble_t arith_exec(Arith_t *ep) {
             case A_PUSHF: {
                 cp = roundptr(ep, cp, Math_f);
                 *++sp = (Sfdouble_t)(cp - ep->code);
+                iokstack[ik + 1] = 0;
                 cp += sizeof(Math_f);
                 *++tp = *cp++;
                 node.userfn = 0;
@@ -345,16 +523,39 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 *++tp = type = *cp++;
                 break;
             }
+            case A_PUSHI: {
+                cp = roundptr(ep, cp, Sflong_t);
+                inum = *((Sflong_t *)cp);
+                cp += sizeof(Sflong_t);
+                iok = true;
+                num = inum;
+                *++sp = num;
+                *++tp = type = 0;
+                break;
+            }
             case A_NOT: {
                 type = 0;
                 num = !num;
+                inum = num;
+                iok = true;
                 break;
             }
             case A_UMINUS: {
+                if (numint && intop(A_UMINUS, 0, inum, &inum)) {
+                    iok = true;
+                    num = inum;
+                    break;
+                }
                 num = -num;
                 break;
             }
             case A_TILDE: {
+                if (numint) {
+                    inum = ~inum;
+                    iok = true;
+                    num = inum;
+                    break;
+                }
                 num = ~((Sflong_t)(num));
                 break;
             }
@@ -557,6 +758,7 @@ Sfdouble_t arith_exec(Arith_t *ep) {
                 break;
             }
         }
+    pop:
         if (c) lastval = NULL;
         if (c & T_BINARY) {
             node.ptr = NULL;
@@ -565,6 +767,8 @@ Sfdouble_t arith_exec(Arith_t *ep) {
         }
         *sp = num;
         *tp = type;
+        istack[sp - sbase] = inum;
+        iokstack[sp - sbase] = iok;
     }
     if (level > 0) level--;
     if (type == 0 && !num) num = 0;
@@ -651,6 +855,47 @@ static_fn int gettok(vars_t *vp) {
     }
 }
 
+//
+// Emit an integer constant and remember where its code is so that operators applied to constants
+// can be folded at compile time.
+//
+static_fn void pushint(vars_t *vp, Sflong_t n) {
+    Stk_t *stkp = vp->shp->stk;
+    int start = stktell(stkp);
+
+    sfputc(stkp, A_PUSHI);
+    stkpush(stkp, vp, n, Sflong_t);
+    if (vp->nconst == MAXCONST) {
+        memmove(vp->consts, vp->consts + 1, (MAXCONST - 1) * sizeof(vp->consts[0]));
+        vp->nconst--;
+    }
+    vp->consts[vp->nconst].start = start;
+    vp->consts[vp->nconst].end = stktell(stkp);
+    vp->consts[vp->nconst++].value = n;
+}
+
+//
+// Replace the code for the nargs operands of op with the result when they are all constants that
+// were just pushed. Returns false if op has to be evaluated at run time.
+//
+static_fn bool foldint(vars_t *vp, int op, int nargs) {
+    Stk_t *stkp = vp->shp->stk;
+    Sflong_t x = 0, y, r;
+    int n = vp->nconst;
+
+    if (n < nargs || vp->consts[n - 1].end != stktell(stkp)) return false;
+    y = vp->consts[n - 1].value;
+    if (nargs == 2) {
+        if (vp->consts[n - 2].end != vp->consts[n - 1].start) return false;
+        x = vp->consts[n - 2].value;
+    }
+    if (!intop(op, x, y, &r)) return false;
+    vp->nconst -= nargs;
+    stkseek(stkp, vp->consts[vp->nconst].start);
+    pushint(vp, r);
+    return true;
+}
+
 //
 // Evaluate a subexpression with precedence.
 //
@@ -698,7 +943,7 @@ again:
             op |= T_NOFLOAT;
         common:
             if (!expr(vp, c)) return false;
-            sfputc(shp->stk, op);
+            if (!foldint(vp, op & T_OP, 1)) sfputc(shp->stk, op);
             break;
         }
         default: {
@@ -846,6 +1091,8 @@ again:
                 sfputc(shp->stk, A_POP);
                 if (!expr(vp, 3)) return false;
                 *((short *)stkptr(shp->stk, offset2)) = stktell(shp->stk);
+                // Constants before a jump target cannot be folded with what follows it.
+                vp->nconst = 0;
                 lvalue.value = NULL;
                 wasop = 0;
                 break;
@@ -869,6 +1116,7 @@ again:
                 sfputc(shp->stk, A_POP);
                 if (!expr(vp, c)) return false;
                 *((short *)stkptr(shp->stk, offset)) = stktell(shp->stk);
+                vp->nconst = 0;
                 if (op != A_QCOLON) sfputc(shp->stk, A_NOTNOT);
                 lvalue.value = NULL;
                 wasop = 0;
@@ -893,7 +1141,7 @@ again:
             case A_GT:
             case A_GE:
             case A_POW: {
-                sfputc(shp->stk, op | T_BINARY);
+                if (!foldint(vp, op & T_OP, 2)) sfputc(shp->stk, op | T_BINARY);
                 vp->staksize--;
                 break;
             }
@@ -935,10 +1183,15 @@ again:
                 if (op == A_DIG || op == A_LIT || lvalue.isfloat == TYPE_LD)
 #endif
                 {
-                    sfputc(shp->stk, A_PUSHN);
                     if (vp->staksize++ >= vp->stakmaxsize) vp->stakmaxsize = vp->staksize;
-                    stkpush(shp->stk, vp, d, Sfdouble_t);
-                    sfputc(shp->stk, lvalue.isfloat);
+                    if (lvalue.isfloat == 0 && d >= LDBL_LLONG_MIN && d <= LDBL_LLONG_MAX &&
+                        (Sflong_t)d == d) {
+                        pushint(vp, (Sflong_t)d);
+                    } else {
+                        sfputc(shp->stk, A_PUSHN);
+                        stkpush(shp->stk, vp, d, Sfdouble_t);
+                        sfputc(shp->stk, lvalue.isfloat);
+                    }
                 }
 
                 // Check for function call.
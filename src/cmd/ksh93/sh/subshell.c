@@ -231,7 +231,7 @@ bool nv_subsaved(Namval_t *np, bool table) {
                     } else {
                         sp->svar = lp->next;
                     }
-                    free(np);
+                    nv_freenode(np);
                     free(lp);
                 }
                 return true;
@@ -371,7 +371,7 @@ Dt_t *sh_subaliastree(Shell_t *shp, int create) {
     struct subshell *sp = subshell_data;
     if (!sp || shp->curenv == 0) return shp->alias_tree;
     if (!sp->salias && create) {
-        sp->salias = dtopen(&_Nvdisc, Dtoset);
+        sp->salias = dtopen(&_Nvdisc, Dtohset);
         dtuserdata(sp->salias, shp, 1);
         dtview(sp->salias, shp->alias_tree);
         shp->alias_tree = sp->salias;
@@ -387,7 +387,7 @@ Dt_t *sh_subfuntree(Shell_t *shp, int create) {
     struct subshell *sp = subshell_data;
     if (!sp || shp->curenv == 0) return shp->fun_tree;
     if (!sp->sfun && create) {
-        sp->sfun = dtopen(&_Nvdisc, Dtoset);
+        sp->sfun = dtopen(&_Nvdisc, Dtohset);
         dtuserdata(sp->sfun, shp, 1);
         dtview(sp->sfun, shp->fun_tree);
         shp->fun_tree = sp->sfun;
@@ -42,9 +42,15 @@ static_fn int dump_p_tree(const Shnode_t *);
 static_fn int dump_p_string(const char *);
 
 static Sfio_t *outfile;
+static int dump_version;
 
-int sh_tdump(Sfio_t *out, const Shnode_t *t) {
+//
+// Write tree <t> to <out> in the format of the given version. Version 4 adds the location of each
+// function body in the script so that a restored function can still be listed with `typeset -f`.
+//
+int sh_tdump(Sfio_t *out, const Shnode_t *t, int version) {
     outfile = out;
+    dump_version = version;
     return dump_p_tree(t);
 }
 
@@ -106,6 +112,15 @@ static_fn int dump_p_tree(const Shnode_t *t) {
         }
         case TFUN: {
             if (sfputu(outfile, t->funct.functline) < 0) return -1;
+            if (dump_version > 3) {
+                const struct slnod *slp = t->funct.functstak;
+                // A body kept in a temporary file can't be found again by another process.
+                Sfoff_t loc = (t->funct.functtyp & FPIN) ? -1 : t->funct.functloc;
+                if (sfputl(outfile, slp ? loc : -1) < 0) return -1;
+                if (sfputu(outfile, slp ? ((struct functnod *)(slp + 1))->functline : 0) < 0) {
+                    return -1;
+                }
+            }
             if (dump_p_string(t->funct.functnam) < 0) return -1;
             if (dump_p_tree(t->funct.functtre) < 0) return -1;
             return dump_p_tree((Shnode_t *)t->funct.functargs);
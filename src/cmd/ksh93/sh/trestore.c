@@ -45,12 +45,17 @@ static_fn char *r_string(Stk_t *);
 static_fn void r_comarg(Shell_t *, struct comnod *);
 
 static Sfio_t *infile;
+static int restore_version;
 
 #define getnode(s, type) (stkalloc((s), sizeof(struct type)))
 
-Shnode_t *sh_trestore(Shell_t *shp, Sfio_t *in) {
+//
+// Read a tree written by sh_tdump() in format <version>.
+//
+Shnode_t *sh_trestore(Shell_t *shp, Sfio_t *in, int version) {
     Shnode_t *t;
     infile = in;
+    restore_version = version;
     t = r_tree(shp);
     return t;
 }
@@ -145,9 +150,14 @@ static_fn Shnode_t *r_tree(Shell_t *shp) {
             Sfio_t *savstk;
             struct slnod *slp;
             struct functnod *fp;
+            int64_t size = 0;
             t = getnode(shp->stk, functnod);
             t->funct.functloc = -1;
             t->funct.functline = sfgetu(infile);
+            if (restore_version > 3) {
+                t->funct.functloc = sfgetl(infile);
+                size = sfgetu(infile);
+            }
             t->funct.functnam = r_string(shp->stk);
             savstk = stkopen(STK_SMALL);
             savstk = stkinstall(savstk, 0);
@@ -158,12 +168,15 @@ static_fn Shnode_t *r_tree(Shell_t *shp) {
             fp = (struct functnod *)(slp + 1);
             memset(fp, 0, sizeof(*fp));
             fp->functtyp = TFUN | FAMP;
+            fp->functline = size;
             if (shp->st.filename) fp->functnam = stkcopy(shp->stk, shp->st.filename);
             t->funct.functtre = r_tree(shp);
             t->funct.functstak = slp;
             t->funct.functargs = (struct comnod *)r_tree(shp);
             slp->slptr = stkinstall(savstk, 0);
             slp->slchild = shp->st.staklist;
+            // As in the parser, list the new stack so sh_freeup() drops its initial reference.
+            shp->st.staklist = slp;
             break;
         }
         case TTST: {
@@ -46,11 +46,16 @@
 #include <malloc.h>
 #endif
 
+#if _lib_posix_spawn
+#include <spawn.h>
+#endif
+
 #include "argnod.h"
 #include "ast.h"
 #include "ast_assert.h"
 #include "builtins.h"
 #include "cdt.h"
+#include "cmdext.h"
 #include "defs.h"
 #include "error.h"
 #include "fault.h"
@@ -515,6 +520,156 @@ static_fn int xec_p_switch(Shell_t *shp, struct regnod *reg) {
     return n;
 }
 
+//
+// Return false if the text of a word, redirection or arithmetic expression may run a command
+// substitution or process substitution. This errs on the side of false.
+//
+static_fn bool xec_nocomsub(const char *cp) {
+    if (!cp) return true;
+    for (; *cp; cp++) {
+        if (*cp == '`') return false;
+        if (*cp != '$') continue;
+        if (cp[1] == '(' && cp[2] != '(') return false;
+        if (cp[1] == '{' && (cp[2] == ' ' || cp[2] == '\t' || cp[2] == '\n' || cp[2] == '|')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_fn bool xec_argsafe(struct argnod *arg) {
+    for (; arg; arg = arg->argnxt.ap) {
+        // Compound assignments and process substitutions have no text of their own.
+        if (!*arg->argval || !xec_nocomsub(arg->argval)) return false;
+    }
+    return true;
+}
+
+static_fn bool xec_iosafe(struct ionod *iop) {
+    for (; iop; iop = iop->ionxt) {
+        if (!(iop->iofile & IODOC) && !xec_nocomsub(iop->ioname)) return false;
+    }
+    return true;
+}
+
+//
+// Return true if nothing run by <t> other than the read builtin can consume the standard input,
+// so that read can buffer ahead on it instead of reading pipes a byte at a time. Only a few
+// builtins that never read standard input are allowed, and in <child> processes not even read.
+//
+static_fn bool sh_ownsinput(const Shnode_t *t, bool child) {
+    if (!t) return true;
+    switch (t->tre.tretyp & COMMSK) {
+        case TCOM: {
+            const struct comnod *com = &t->com;
+            Namval_t *np = com->comnamp;
+            if (!xec_iosafe(com->comio)) return false;
+            if (com->comarg) {
+                Shbltin_f fn;
+                if (!np || !is_abuiltin(np)) return false;
+                fn = funptr(np);
+                if (fn == b_read) {
+                    if (child) return false;
+                } else if (fn != b_print && fn != b_printf && fn != b_true && fn != b_false &&
+                           fn != b_test && fn != b_let && fn != b_break && fn != b_shift) {
+                    return false;
+                }
+                if ((com->comtyp & COMSCAN) && !xec_argsafe(com->comarg)) return false;
+            }
+            return xec_argsafe(com->comset);
+        }
+        case TTIME:
+        case TPAR: {
+            return sh_ownsinput(t->par.partre, true);
+        }
+        case TFORK: {
+            return xec_iosafe(t->fork.forkio) && sh_ownsinput(t->fork.forktre, true);
+        }
+        case TSETIO: {
+            return xec_iosafe(t->fork.forkio) && sh_ownsinput(t->fork.forktre, child);
+        }
+        case TFIL: {
+            // Only the first command of a pipeline reads the same standard input.
+            return sh_ownsinput(t->lst.lstlef, true);
+        }
+        case TIF: {
+            return sh_ownsinput(t->if_.iftre, child) && sh_ownsinput(t->if_.thtre, child) &&
+                   sh_ownsinput(t->if_.eltre, child);
+        }
+        case TWH: {
+            return sh_ownsinput((Shnode_t *)t->wh.whinc, child) &&
+                   sh_ownsinput(t->wh.whtre, child) && sh_ownsinput(t->wh.dotre, child);
+        }
+        case TLST:
+        case TAND:
+        case TORF: {
+            return sh_ownsinput(t->lst.lstlef, child) && sh_ownsinput(t->lst.lstrit, child);
+        }
+        case TARITH: {
+            return xec_argsafe(t->ar.arexpr);
+        }
+        case TFOR: {
+            // A select loop reads its replies from the standard input.
+            if (t->tre.tretyp & COMSCAN) return false;
+            if (t->for_.forlst && (t->for_.forlst->comtyp & COMSCAN) &&
+                !xec_argsafe(t->for_.forlst->comarg)) {
+                return false;
+            }
+            return sh_ownsinput(t->for_.fortre, child);
+        }
+        case TSW: {
+            struct regnod *reg;
+            if (!xec_argsafe(t->sw.swarg) || !xec_iosafe(t->sw.swio)) return false;
+            for (reg = t->sw.swlst; reg; reg = reg->regnxt) {
+                if (!xec_argsafe(reg->regptr) || !sh_ownsinput(reg->regcom, child)) return false;
+            }
+            return true;
+        }
+        case TTST: {
+            if ((t->tre.tretyp & TPAREN) == TPAREN) return sh_ownsinput(t->lst.lstlef, child);
+            if (!xec_argsafe(&t->lst.lstlef->arg)) return false;
+            return !(t->tre.tretyp & TBINARY) || xec_argsafe(&t->lst.lstrit->arg);
+        }
+        default: { return false; }
+    }
+}
+
+//
+// Return true if the redirections <iop> replace the standard input with a new file for the
+// duration of the command.
+//
+static_fn bool xec_newinput(struct ionod *iop) {
+    for (; iop; iop = iop->ionxt) {
+        if ((iop->iofile & IOUFD) == 0 && !(iop->iofile & (IOPUT | IOMOV | IORDW | IOLSEEK))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Return true if read can buffer ahead on the standard input of a loop of type <type> that owns its
+// input, once the redirections <iop> are done. What read takes ahead of the loop is lost to anyone
+// else who reads the same file, so this is only for the pipe the shell made for the loop or a
+// regular file that no other descriptor refers to. A FIFO, or /dev/stdin or /dev/fd/n, which
+// reopen a file the shell already has, are read a byte at a time as before.
+//
+static_fn bool xec_readahead(Shell_t *shp, struct ionod *iop, int type) {
+    struct stat statb, other;
+    int fd;
+
+    if (!xec_newinput(iop)) return (type & FPIN) != 0;
+    if (fstat(0, &statb) < 0 || !S_ISREG(statb.st_mode)) return false;
+    for (fd = 1; fd < shp->gd->lim.open_max; fd++) {
+        if (fd >= 10 && (!shp->fdstatus[fd] || shp->fdstatus[fd] == IOCLOSE)) continue;
+        if (fstat(fd, &other) >= 0 && other.st_dev == statb.st_dev &&
+            other.st_ino == statb.st_ino) {
+            return false;
+        }
+    }
+    return true;
+}
+
 #define OPTIMIZE_FLAG (ARG_OPTIMIZE)
 #define OPTIMIZE (flags & OPTIMIZE_FLAG)
 
@@ -796,6 +951,7 @@ static_fn Namval_t *enter_namespace(Shell_t *shp, Namval_t *nsp) {
     }
     if (!nsp && !onsp) return NULL;
     if (onsp == nsp) return nsp;
+    sh_envserial++;
     if (onsp) {
         oroot = nv_dict(onsp);
         if (!nsp) {
@@ -927,6 +1083,499 @@ done:
     sh_done(shp, 0);
 }
 
+//
+// The builtins that sh_pipecomsub() may run. A filter reads its standard input so it may not be
+// the first element of the pipeline, whose standard input is not replaced.
+//
+static const struct {
+    Shbltin_f fun;
+    bool filter;
+} pipe_bltins[] = {
+    {b_print, false},   {b_printf, false},   {B_echo, false},     {b_true, false},
+    {b_false, false},   {b_basename, false}, {b_dirname, false},  {b_uname, false},
+    {b_cat, true},      {b_cut, true},       {b_head, true},      {b_wc, true},
+};
+
+#define PIPE_MAX 16  // the most elements sh_pipecomsub() will run
+
+//
+// Return true if expanding the word <s>, which is not ARG_RAW, can not have side effects or fail.
+// This rules out command and arithmetic substitutions, ${x=y} and ${x?y}, and set -u. It also rules
+// out any ${...} that is more than a name, because substring offsets and subscripts are arithmetic
+// that can fail, and a failed expansion would end the shell rather than a forked child. Nor may
+// the word refer to a variable with a discipline, such as RANDOM, or to a name with a dot, such as
+// ${.sh.pid}, whose value would differ or whose state would change in the current shell.
+//
+static_fn bool pure_word(Shell_t *shp, const char *s) {
+    char name[64];
+    const char *cp;
+    Namval_t *np;
+    size_t n;
+
+    if (sh_isoption(shp, SH_NOUNSET) || strpbrk(s, "(`=?")) return false;
+    while ((s = strchr(s, '$'))) {
+        cp = ++s;
+        if (*cp == '{') cp++;
+        for (s = cp; isalnum(*s) || *s == '_' || *s == '.'; s++) {
+            ;  // empty loop
+        }
+        n = s - cp;
+        if (cp[-1] == '{') {
+            if (!n && *s && strchr("@*#!$-", *s)) s++;
+            if (*s != '}') return false;
+        }
+        if (!n || isdigit(*cp)) continue;
+        if (n >= sizeof(name) || memchr(cp, '.', n)) return false;
+        memcpy(name, cp, n);
+        name[n] = 0;
+        np = nv_search(name, shp->var_tree, 0);
+        if (np && np->nvfun) return false;
+    }
+    return true;
+}
+
+//
+// Return the simple command that is element <index> of a pipeline whose first element is at <t> if
+// sh_pipecomsub() can run it, otherwise NULL. <last> is true for the last element.
+//
+static_fn const Shnode_t *pipe_element(Shell_t *shp, const Shnode_t *t, int index, bool last) {
+    const struct argnod *ap = NULL;
+    Namval_t *np;
+    char *name, **argv;
+    int argc, i;
+
+    while ((t->tre.tretyp & COMMSK) == TFORK || (t->tre.tretyp & COMMSK) == TSETIO) {
+        if (t->fork.forkio) return NULL;
+        t = t->fork.forktre;
+    }
+    if ((t->tre.tretyp & COMMSK) != TCOM || t->tre.treio || t->com.comset || !t->com.comarg) {
+        return NULL;
+    }
+    if (t->com.comtyp & COMSCAN) {
+        ap = t->com.comarg;
+        if (!(ap->argflag & ARG_RAW)) return NULL;
+        name = (char *)ap->argval;
+        argv = NULL;
+        argc = 0;
+    } else {
+        struct dolnod *dp = (struct dolnod *)t->com.comarg;
+        argv = dp->dolval + dp->dolbot;
+        argc = dp->dolnum;
+        name = argv[0];
+    }
+    if (strpbrk(name, "./=")) return NULL;
+    // Find the builtin the way sh_exec() would without searching PATH. A builtin bound to a
+    // directory on PATH is found from its tracked alias.
+    np = nv_search(name, shp->fun_tree, 0);
+    if (!np) {
+        np = nv_search(name, shp->track_tree, 0);
+        if (!np || nv_isattr(np, NV_NOALIAS) || !FETCH_VT(np->nvalue, const_cp)) return NULL;
+        np = nv_search(nv_getval(np), shp->bltin_tree, 0);
+        if (!np) return NULL;
+    }
+    if (!is_abuiltin(np)) return NULL;
+    for (i = 0; i < (int)(sizeof(pipe_bltins) / sizeof(*pipe_bltins)); i++) {
+        if (pipe_bltins[i].fun == funptr(np)) break;
+    }
+    if (i == sizeof(pipe_bltins) / sizeof(*pipe_bltins)) return NULL;
+    if (index == 0 && pipe_bltins[i].filter) return NULL;
+    if (last) return t;
+    // The other elements would be forked, so expanding their arguments must have no side effects
+    // and they must not assign variables as printf -v does.
+    if (!ap) {
+        for (i = 1; i < argc; i++) {
+            if (*argv[i] == '-' && strchr(argv[i], 'v')) return NULL;
+        }
+    }
+    while (ap && (ap = ap->argnxt.ap)) {
+        if (!(ap->argflag & ARG_RAW) && !pure_word(shp, ap->argval)) return NULL;
+        if (*ap->argval == '-' && strchr(ap->argval, 'v')) return NULL;
+    }
+    return t;
+}
+
+//
+// Replace the contents of the standard stream <std> by those of <f> and return a stream holding
+// what <std> had. Return NULL, with <std> unchanged, if the streams can not be swapped.
+//
+static_fn Sfio_t *pipe_swap(Sfio_t *std, Sfio_t *f) {
+    Sfio_t *save = sfswap(std, NULL);
+    if (save && sfswap(f, std) != std) {
+        sfswap(save, std);
+        save = NULL;
+    }
+    return save;
+}
+
+//
+// Put back the contents <save> of the standard stream <std> that pipe_swap() replaced and return
+// a stream holding what <std> had in the meantime.
+//
+static_fn Sfio_t *pipe_restore(Sfio_t *std, Sfio_t *save) {
+    Sfio_t *f = pipe_swap(std, save);
+    if (!f) {
+        errormsg(SH_DICT, ERROR_system(1), e_redirect);
+        __builtin_unreachable();
+    }
+    return f;
+}
+
+//
+// Run pipeline <t> whose output is being collected in memory by a command substitution without
+// forking, if each of its elements is a simple command that runs one of the builtins in
+// pipe_bltins[]. The elements are run one after the other in the current process. The output of
+// each is written to a string stream which is then read as the standard input of the next.
+// Return false, having done nothing, if the pipeline can not be run this way.
+//
+static_fn bool sh_pipecomsub(Shell_t *shp, const Shnode_t *t, int flags) {
+    const Shnode_t *elem[PIPE_MAX];
+    int status[PIPE_MAX];
+    Sfio_t *data = NULL, *next, *savein, *saveout;
+    checkpt_t *buffp;
+    int n, i, jmpval;
+
+    if (!shp->comsub || !(sfset(sfstdout, 0, 0) & SF_STRING) || (t->tre.tretyp & FSHOWME) ||
+        shp->st.trap[SH_DEBUGTRAP]) {
+        return false;
+    }
+    for (n = 0; (t->tre.tretyp & COMMSK) == TFIL; n++, t = t->lst.lstrit) {
+        if (n == PIPE_MAX - 1 || !(elem[n] = pipe_element(shp, t->lst.lstlef, n, false))) {
+            return false;
+        }
+    }
+    if (!(elem[n] = pipe_element(shp, t, n, true))) return false;
+    n++;
+    buffp = stkalloc(shp->stk, sizeof(checkpt_t));
+    for (i = 0; i < n; i++) {
+        savein = saveout = next = NULL;
+        if (data) {
+            Sfio_t *in = sfnew(NULL, sfstrbase(data), sfstrtell(data), -1, SF_READ | SF_STRING);
+            if (!in) {
+                sfclose(data);
+                errormsg(SH_DICT, ERROR_system(1), e_tmpcreate);
+                __builtin_unreachable();
+            }
+            if (!(savein = pipe_swap(sfstdin, in))) {
+                sfclose(in);
+                sfclose(data);
+                errormsg(SH_DICT, ERROR_system(1), e_redirect);
+                __builtin_unreachable();
+            }
+        }
+        if (i < n - 1) {
+            if (!(next = sfstropen())) {
+                if (savein) sfclose(pipe_restore(sfstdin, savein));
+                if (data) sfclose(data);
+                errormsg(SH_DICT, ERROR_system(1), e_tmpcreate);
+                __builtin_unreachable();
+            }
+            if (!(saveout = pipe_swap(sfstdout, next))) {
+                sfclose(next);
+                // Nothing has run yet, so the pipeline can still be forked.
+                if (i == 0) return false;
+                if (savein) sfclose(pipe_restore(sfstdin, savein));
+                if (data) sfclose(data);
+                errormsg(SH_DICT, ERROR_system(1), e_redirect);
+                __builtin_unreachable();
+            }
+        }
+        sh_pushcontext(shp, buffp, SH_JMPIO);
+        jmpval = sigsetjmp(buffp->buff, 0);
+        // Like a forked element of the pipeline, an element other than the last does not exit the
+        // shell when it fails with errexit set.
+        if (jmpval == 0) sh_exec(shp, elem[i], i < n - 1 ? 0 : flags);
+        sh_popcontext(shp, buffp);
+        sh_iorestore(shp, buffp->topfd, jmpval);
+        status[i] = shp->exitval;
+        if (saveout) next = pipe_restore(sfstdout, saveout);
+        if (savein) sfclose(pipe_restore(sfstdin, savein));
+        if (data) sfclose(data);
+        data = next;
+        if (jmpval > SH_JMPIO) {
+            if (data) sfclose(data);
+            siglongjmp(shp->jmplist->buff, jmpval);
+        }
+    }
+    n = status[--i];
+    if (n == 0 && sh_isoption(shp, SH_PIPEFAIL)) {
+        while (i-- > 0) {
+            if (status[i]) {
+                n = status[i];
+                break;
+            }
+        }
+    }
+    shp->exitval = n;
+    return true;
+}
+
+#if !USE_SPAWN && _lib_posix_spawn
+
+//
+// Add the actions for the redirections <iop> of a command started by sh_spawn() to <fa>. Only
+// opening a file and duplicating or closing a descriptor are handled. Return false for any other
+// redirection, and for a file whose open could block since the child opens it with all signals
+// blocked.
+//
+static_fn bool spawn_redirect(Shell_t *shp, posix_spawn_file_actions_t *fa,
+                              const struct ionod *iop) {
+    struct stat statb;
+    char *fname;
+    int fn, dupfd, iof, oflag;
+
+    for (; iop; iop = iop->ionxt) {
+        iof = iop->iofile;
+        fn = iof & IOUFD;
+        if (fn > 9 || iop->iovname || (iof & (IODOC | IOLSEEK | IOPROCSUB | IOREWRITE))) {
+            return false;
+        }
+        fname = iop->ioname;
+        if (!(iof & IORAW)) {
+            if (sh_isoption(shp, SH_INTERACTIVE) || !pure_word(shp, fname)) return false;
+            fname = sh_mactrim(shp, fname, 0);
+        }
+        if (iof & IOMOV) {
+            if (fname[0] == '-' && fname[1] == 0) {
+                if (posix_spawn_file_actions_addclose(fa, fn)) return false;
+                continue;
+            }
+            if (fname[0] < '0' || fname[0] > '2' || fname[1]) return false;
+            dupfd = fname[0] - '0';
+            if (shp->sftable[dupfd] && (sfset(shp->sftable[dupfd], 0, 0) & SF_STRING)) {
+                return false;
+            }
+            if (posix_spawn_file_actions_adddup2(fa, dupfd, fn)) return false;
+            continue;
+        }
+        // Other files under /dev may be special to sh_open(), or be FIFOs or terminals.
+        if (strcmp(fname, "/dev/null") != 0) {
+            if (strncmp(fname, "/dev/", 5) == 0) return false;
+            if (stat(fname, &statb) >= 0 && !S_ISREG(statb.st_mode)) return false;
+        }
+        if (iof & IORDW) {
+            oflag = O_RDWR | O_CREAT;
+        } else if (!(iof & IOPUT)) {
+            oflag = O_RDONLY;
+        } else if (iof & IOAPP) {
+            oflag = O_WRONLY | O_CREAT | O_APPEND;
+        } else if ((iof & IOCLOB) || !sh_isoption(shp, SH_NOCLOBBER)) {
+            oflag = O_WRONLY | O_CREAT | O_TRUNC;
+        } else {
+            return false;
+        }
+        if (posix_spawn_file_actions_addopen(fa, fn, fname, oflag, 0666)) return false;
+    }
+    return true;
+}
+
+//
+// Return true if the descriptor <fd> is closed or is closed by exec(). The pipe descriptors that a
+// forked child closes are close-on-exec, so a spawned command doesn't inherit them either.
+//
+static_fn bool spawn_closes(int fd) {
+    int flags;
+
+    return fd < 0 || (flags = fcntl(fd, F_GETFD)) < 0 || (flags & FD_CLOEXEC);
+}
+
+//
+// Add the actions that connect the pipes of a pipeline element or coprocess of type <type> to the
+// standard input and output of a command started by sh_spawn() to <fa>, the same way
+// forked_child() does. Return false if a descriptor the forked child would close is left open.
+//
+static_fn bool spawn_pipes(Shell_t *shp, posix_spawn_file_actions_t *fa, int type) {
+    if (type & FPIN) {
+        if (!spawn_closes(shp->inpipe[0]) || !spawn_closes(shp->inpipe[1])) return false;
+        if (posix_spawn_file_actions_adddup2(fa, shp->inpipe[0], 0)) return false;
+    }
+    if (type & FPOU) {
+        if (!spawn_closes(shp->outpipe[0]) || !spawn_closes(shp->outpipe[1])) return false;
+        if (posix_spawn_file_actions_adddup2(fa, shp->outpipe[1], 1)) return false;
+    }
+    return true;
+}
+
+//
+// Start the external command <argv> of the simple command <t> with posix_spawn() rather than with
+// fork() and exec(). Unlike fork(), the cost of posix_spawn() does not grow with the size of the
+// shell. The child joins or creates a process group and takes the terminal just as _sh_fork()
+// arranges for a forked child, so job control is not affected. That holds for an element of a
+// pipeline and for a command run with &, which without job control ignores interrupts and reads
+// /dev/null as forked_child() arranges. Return the pid of the command, or 0 to have the caller
+// fork. That includes any command that fails to start, such as a script without #!, so that the
+// forked child reports the error or runs the script as it always has.
+//
+static_fn pid_t sh_spawn(Shell_t *shp, const Shnode_t *t, char *argv[], int type, int *jobid) {
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    struct argnod *ap;
+    Namval_t *np;
+    Pathcomp_t *pp;
+    sigset_t set, oset;
+    struct sigaction oint, oquit, ign;
+    char **envp, *path, *cp, name[64];
+    pid_t pid = 0, pgid = -1;
+    int lineno = shp->st.firstline;
+    int fg = 0, sig, n;
+    short flags = POSIX_SPAWN_SETSIGMASK;
+    bool noint = (type & FINT) && !sh_isstate(shp, SH_MONITOR);
+
+    if ((type & COMMSK) != TCOM || (type & (FCOOP | FSHOWME))) return 0;
+    // The forked child of a background command would renice itself or close the coprocess pipe.
+    if ((type & FAMP) && (sh_isoption(shp, SH_BGNICE) || !spawn_closes(shp->coutpipe))) return 0;
+    if (sh_isoption(shp, SH_RESTRICTED) || sh_isoption(shp, SH_XTRACE) ||
+        shp->st.trap[SH_DEBUGTRAP] || shp->xargmin || shp->savesig || shp->namespace) {
+        return 0;
+    }
+    // A forked child ignores the signals trapped with an empty action, which exec() keeps ignored
+    // only if the shell does not catch them.
+    for (sig = 1; sig < shp->st.trapmax; sig++) {
+        cp = shp->st.trapcom[sig];
+        if (cp && !*cp && (shp->sigflag[sig] & SH_SIGFAULT)) return 0;
+    }
+#ifdef JOBS
+    if (sh_isstate(shp, SH_MONITOR) && (job.jobcontrol || (type & FAMP))) {
+        // A background job is a process group of its own and doesn't take the terminal.
+        pgid = (type & FAMP) ? 0 : job.curpgid;
+#if _lib_posix_spawn_file_actions_addtcsetpgrp_np
+        fg = !pgid && !(type & FAMP);
+#else
+        if (!pgid && !(type & FAMP)) return 0;
+#endif
+    }
+#endif  // JOBS
+    path = argv[0];
+    if (!strchr(path, '/')) {
+        np = nv_search(path, shp->track_tree, 0);
+        if (!np || nv_isattr(np, NV_NOALIAS) || !FETCH_VT(np->nvalue, const_cp)) return 0;
+        path = nv_getval(np);
+        if (!path || *path != '/') return 0;
+        for (pp = path_get(shp, argv[0]); pp; pp = pp->next) {
+            if (pp->lib) return 0;
+        }
+    }
+    // Only literal assignments to variables without attributes or disciplines.
+    for (ap = t->com.comset; ap; ap = ap->argnxt.ap) {
+        if (!(ap->argflag & ARG_RAW) || (ap->argflag & ARG_APPEND)) return 0;
+        cp = ap->argval;
+        for (n = 0; isalnum(cp[n]) || cp[n] == '_'; n++) {
+            ;  // empty loop
+        }
+        if (n == 0 || isdigit(*cp) || cp[n] != '=' || n >= (int)sizeof(name)) return 0;
+        memcpy(name, cp, n);
+        name[n] = 0;
+        np = nv_search(name, shp->var_tree, 0);
+        if (np && (np->nvfun || nv_isattr(np, ~(NV_EXPORT | NV_IMPORT | NV_NOFREE | NV_TAGGED)))) {
+            return 0;
+        }
+    }
+    if (posix_spawn_file_actions_init(&fa)) return 0;
+    if (posix_spawnattr_init(&attr)) {
+        posix_spawn_file_actions_destroy(&fa);
+        return 0;
+    }
+#if _lib_posix_spawn_file_actions_addtcsetpgrp_np
+    if (fg && posix_spawn_file_actions_addtcsetpgrp_np(&fa, job.fd)) goto done;
+#endif
+    if (noint && !shp->st.ioset &&
+        posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0)) {
+        goto done;
+    }
+    if (!spawn_pipes(shp, &fa, type) || !spawn_redirect(shp, &fa, t->com.comio)) goto done;
+    if (pgid >= 0) {
+        if (posix_spawnattr_setpgroup(&attr, pgid)) goto done;
+        flags |= POSIX_SPAWN_SETPGROUP;
+    }
+    if (pgid >= 0 && job.jobcontrol) {
+        sigemptyset(&set);
+#ifdef SIGTSTP
+        sigaddset(&set, SIGTTIN);
+        sigaddset(&set, SIGTTOU);
+        sigaddset(&set, SIGTSTP);
+#endif  // SIGTSTP
+        if (posix_spawnattr_setsigdefault(&attr, &set)) goto done;
+        flags |= POSIX_SPAWN_SETSIGDEF;
+    }
+    if (t->com.comset) sh_scope(shp, t->com.comset, 0);
+    envp = sh_envgen(shp);
+    if (t->com.comset) sh_unscope(shp);
+    // Restore firstline in case LINENO was exported.
+    shp->st.firstline = lineno;
+    // Pass the pid of the shell and the command path in $_ as path_spawn() does.
+    sfprintf(shp->stk, "_=*%d*%s", getpid(), path);
+    *--envp = stkfreeze(shp->stk, 1);
+    if (!shp->pathlist) path_get(shp, "");
+    sfsync(NULL);
+    shp->trapnote &= ~SH_SIGTERM;
+    sigfillset(&set);
+    sigprocmask(SIG_BLOCK, &set, &oset);
+    if (posix_spawnattr_setsigmask(&attr, &oset) || posix_spawnattr_setflags(&attr, flags)) {
+        sigprocmask(SIG_SETMASK, &oset, NULL);
+        goto done;
+    }
+    if (noint) {
+        // The child can only inherit ignored interrupts, so ignore them while it is spawned. An
+        // interrupt that is already pending would be discarded; fork instead.
+        if (sigpending(&set) < 0 || sigismember(&set, SIGINT) || sigismember(&set, SIGQUIT)) {
+            sigprocmask(SIG_SETMASK, &oset, NULL);
+            goto done;
+        }
+        memset(&ign, 0, sizeof(ign));
+        ign.sa_handler = SIG_IGN;
+        sigaction(SIGINT, &ign, &oint);
+        sigaction(SIGQUIT, &ign, &oquit);
+    }
+    job_lock();
+    n = posix_spawn(&pid, path, &fa, &attr, argv, envp);
+    if (noint) {
+        sigaction(SIGINT, &oint, NULL);
+        sigaction(SIGQUIT, &oquit, NULL);
+    }
+    if (n == 0) {
+        _sh_fork(shp, pid, type, jobid);
+        sh_stats(STAT_SPAWN);
+        sigprocmask(SIG_SETMASK, &oset, NULL);
+        job_fork(pid);
+    } else {
+        pid = 0;
+        sigprocmask(SIG_SETMASK, &oset, NULL);
+        job_unlock();
+    }
+done:
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&fa);
+    return pid;
+}
+
+//
+// Start the simple command run by the fork node <t>, a command run with & or an element of a
+// pipeline other than the last, with sh_spawn(). The forked child would expand the words of the
+// command, so they are expanded here only if that can not have side effects. Return the pid of
+// the command, or 0 to have the caller fork.
+//
+static_fn pid_t sh_spawnfork(Shell_t *shp, const Shnode_t *t, int type, int *jobid) {
+    const Shnode_t *tc = t->fork.forktre;
+    const struct argnod *ap;
+    char **argv;
+    int argn;
+
+    if (t->fork.forkio || !tc || (tc->tre.tretyp & COMMSK) != TCOM || tc->com.comnamp ||
+        !tc->com.comarg) {
+        return 0;
+    }
+    if (tc->com.comtyp & COMSCAN) {
+        for (ap = tc->com.comarg; ap; ap = ap->argnxt.ap) {
+            if (!(ap->argflag & ARG_RAW) && !pure_word(shp, ap->argval)) return 0;
+        }
+    }
+    argv = sh_argbuild(shp, &argn, &tc->com, 0);
+    // A function or builtin runs in the forked child.
+    if (!argv[0] || nv_search(argv[0], shp->fun_tree, 0)) return 0;
+    return sh_spawn(shp, tc, argv, type & ~COMMSK, jobid);
+}
+
+#endif  // !USE_SPAWN && _lib_posix_spawn
+
 int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
     sh_sigcheck(shp);
 
@@ -1089,6 +1738,7 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                         if (checkopt(com, 'C')) nvflags |= NV_COMVAR;
                         if (checkopt(com, 'S')) nvflags |= NV_STATIC;
                         if (checkopt(com, 'm')) nvflags |= NV_MOVE;
+                        if ((nvflags & NV_ARRAY) && checkopt(com, 'O')) shp->assoc_order = true;
                         if (checkopt(com, 'n')) {
                             nvflags |= NV_NOREF;
                         } else if (argn >= 3 && checkopt(com, 'T')) {
@@ -1131,6 +1781,7 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                     if (t->com.comtyp & COMFIXED) ((Shnode_t *)t)->com.comtyp &= ~COMFIXED;
                     shp->nodelist = sh_setlist(shp, argp, nvflags, tp);
                     if (np == shp->typeinit) shp->typeinit = NULL;
+                    shp->assoc_order = false;
                     shp->envlist = argp;
                     argp = NULL;
                 }
@@ -1587,7 +2238,15 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                     break;
                 }
 #else   // USE_SPAWN
-                parent = sh_fork(shp, type, &jobid);
+                parent = 0;
+#if _lib_posix_spawn
+                if (com) {
+                    parent = sh_spawn(shp, t, com, type, &jobid);
+                } else if ((type & COMMSK) == TFORK) {
+                    parent = sh_spawnfork(shp, t, type, &jobid);
+                }
+#endif
+                if (!parent) parent = sh_fork(shp, type, &jobid);
 #endif  // USE_SPAWN
             }
 #if SHOPT_COSHELL
@@ -1608,6 +2267,7 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
             if (type & FPCL) sh_close(shp->inpipe[0]);
             if (type & (FCOOP | FAMP)) {
                 shp->bckpid = parent;
+                job_async(parent);
             } else if (!(type & (FAMP | FPOU))) {
                 if (!sh_isoption(shp, SH_MONITOR)) {
                     if (!(shp->sigflag[SIGINT] & (SH_SIGFAULT | SH_SIGOFF))) {
@@ -1652,6 +2312,10 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
             pid_t pid;
             int jmpval, waitall;
             int simple = (t->fork.forktre->tre.tretyp & COMMSK) == TCOM;
+            int readahead = shp->readahead;
+            bool owner = (t->fork.forktre->tre.tretyp & COMMSK) == TWH &&
+                         ((type & FPIN) || xec_newinput(t->fork.forkio)) &&
+                         sh_ownsinput(t->fork.forktre, false);
             checkpt_t *buffp = stkalloc(shp->stk, sizeof(checkpt_t));
 #if SHOPT_COSHELL
             if (shp->inpool) {
@@ -1685,6 +2349,10 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
             if (jmpval == 0) {
                 if (shp->comsub) tsetio = 1;
                 sh_redirect(shp, t->fork.forkio, execflg);
+                // A loop reading its own input can let read buffer ahead, see sh_ownsinput().
+                if (owner && xec_readahead(shp, t->fork.forkio, type)) {
+                    shp->readahead = shp->topfd;
+                }
                 (t->fork.forktre)->tre.tretyp |= t->tre.tretyp & FSHOWME;
                 t = t->fork.forktre;
 #if SHOPT_BASH
@@ -1701,6 +2369,7 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                 sfsync(shp->outpool);
             }
             sh_popcontext(shp, buffp);
+            shp->readahead = readahead;
             sh_iorestore(shp, buffp->topfd, jmpval);
 #if USE_SPAWN
             if (shp->vexp->cur > vexi) sh_vexrestore(shp, buffp->vexi);
@@ -1808,6 +2477,7 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
             }
             pvo[2] = pvn[2] = 0;
 #endif  // SHOPT_COSHELL
+            if (sh_pipecomsub(shp, t, flags)) break;
             job.curjobid = 0;
             if (shp->subshell) {
                 sh_subtmpfile(shp);
@@ -2280,7 +2950,7 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                     if (sp) *sp++ = '.';
                 }
                 if (!nv_istable(np)) {
-                    Dt_t *root = dtopen(&_Nvdisc, Dtoset);
+                    Dt_t *root = dtopen(&_Nvdisc, Dtohset);
                     dtuserdata(root, shp, 1);
                     nv_mount(np, NULL, root);
                     STORE_VT(np->nvalue, const_cp, Empty);
@@ -2331,10 +3001,13 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                 struct Ufunction *rp = FETCH_VT(np->nvalue, rp);
                 slp = (struct slnod *)np->nvenv;
                 sh_funstaks(slp->slchild, -1);
+                sh_memgrow(MEM_FUNCTIONS, -(ssize_t)stksize(slp->slptr));
                 stkclose(slp->slptr);
                 if (rp->sdict) {
                     Namval_t *nq;
                     shp->last_root = rp->sdict;
+                    // Only the static variables are to be deleted, not what the dictionary views.
+                    dtview(rp->sdict, NULL);
                     for (mp = dtfirst(rp->sdict); mp; mp = nq) {
                         _nv_unset(mp, NV_RDONLY);
                         nq = dtnext(rp->sdict, mp);
@@ -2344,13 +3017,17 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                     rp->sdict = NULL;
                 }
                 if (shp->funload) {
-                    if (!shp->fpathdict) free(FETCH_VT(np->nvalue, rp));
+                    if (!shp->fpathdict) {
+                        sh_memfree(MEM_FUNCTIONS, sizeof(struct Ufunction));
+                        free(FETCH_VT(np->nvalue, rp));
+                    }
                     STORE_VT(np->nvalue, rp, NULL);
                 }
             }
             if (!FETCH_VT(np->nvalue, rp)) {
                 struct Ufunction *rp =
                     calloc(1, sizeof(struct Ufunction) + (shp->funload ? sizeof(Dtlink_t) : 0));
+                sh_memalloc(MEM_FUNCTIONS, sizeof(struct Ufunction));
                 STORE_VT(np->nvalue, rp, rp);
             }
             if (t->funct.functstak) {
@@ -2362,6 +3039,8 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
                 slp = t->funct.functstak;
                 sh_funstaks(slp->slchild, 1);
                 stklink(slp->slptr);
+                // The parse tree of the body is charged to the function as long as it is defined.
+                sh_memgrow(MEM_FUNCTIONS, stksize(slp->slptr));
                 np->nvenv = (Namval_t *)slp;
                 nv_funtree(np) = (int *)(t->funct.functtre);
                 FETCH_VT(np->nvalue, rp)->hoffset = t->funct.functloc;
@@ -2484,6 +3163,12 @@ int sh_exec(Shell_t *shp, const Shnode_t *t, int flags) {
         while ((pid = *procsub++)) job_wait(pid);
         shp->exitval = exitval;
     }
+    // Reap the children whose SIGCHLD was deferred, so that a loop running only builtins sees them
+    // complete.
+    if (job.savesig && !job.in_critical) {
+        job_lock();
+        job_unlock();
+    }
     if (shp->trapnote || (shp->exitval && sh_isstate(shp, SH_ERREXIT) && t && echeck)) {
         sh_chktrap(shp);
     }
@@ -3295,6 +3980,7 @@ int sh_eval(Shell_t *shp, Sfio_t *iop, int mode) {
     int binscript = shp->binscript;
     char comsub = shp->comsub;
     Sfio_t *iosaved = io_save;
+    void *volatile pcache = pcache_claim(shp, iop);
 
     io_save = iop;  // preserve correct value across longjmp
     shp->binscript = 0;
@@ -3314,10 +4000,16 @@ int sh_eval(Shell_t *shp, Sfio_t *iop, int mode) {
             if (traceon) sh_offoption(shp, SH_XTRACE);
         }
         t = sh_parse(shp, iop, (mode & (SH_READEVAL | SH_FUNEVAL)) ? mode & SH_FUNEVAL : SH_NL);
+        if (pcache) pcache_record(pcache, t);
         if (!(mode & SH_FUNEVAL) || !sfreserve(iop, 0, 0)) {
             if (!(mode & SH_READEVAL)) sfclose(iop);
             io_save = 0;
             mode &= ~SH_FUNEVAL;
+            // All of the input has been parsed so the trees can be cached.
+            if (pcache) {
+                pcache_close(pcache, true);
+                pcache = NULL;
+            }
         }
         mode &= ~SH_READEVAL;
         if (!sh_isoption(shp, SH_VERBOSE)) sh_offstate(shp, SH_VERBOSE);
@@ -3330,6 +4022,7 @@ int sh_eval(Shell_t *shp, Sfio_t *iop, int mode) {
         if (!io_save) break;
     }
     sh_popcontext(shp, buffp);
+    if (pcache) pcache_close(pcache, false);
     shp->binscript = binscript;
     shp->comsub = comsub;
     if (traceon) sh_onoption(shp, SH_XTRACE);
@@ -1073,3 +1073,52 @@ function f
 [[ $(( (2**32) << 67 )) == 0 ]] || log_error 'left shift count 67 is non-zero'
 
 [[ 0x123 -eq 0x122+0x1 ]] || log_error "[[...]] does not support math operations on hexadecimal numbers"
+
+# Expressions evaluated from strings are compiled once and reused; the reused program must see the
+# same variables a freshly compiled one would.
+expect=$'2\n3\n6\n11\n4\n5 8\n11\n9\n9\n2 1 2 1 \n6\n8\nafter'
+actual=$($SHELL -c 'expr="n + 1"
+    n=1; print $(( expr ))
+    n=2; print $(( expr ))
+    unset n; n=5; print $(( expr ))
+    function f { typeset n=10; print $(( expr )); }
+    f
+    n=3; print $(( expr ))
+    function g { typeset -n r=$1; let "r += 1"; }
+    integer a=4 b=7; g a; g b; print $a $b
+    let "v = 010 + 1"; print $v
+    print $(( 010 + 1 ))
+    set -o letoctal; let "v = 010 + 1"; print $v
+    compound -a x=( (pid=1) (pid=2) )
+    for j in 1 0 1 0; do print -n "${x[j].pid} "; done; print
+    double="m * 2"
+    ( let "m = 3"; print $(( double )) )
+    m=4; print $(( double ))
+    let "q = 1/0"
+    print after' 2> /dev/null)
+[[ $actual == "$expect" ]] || log_error 'cached arithmetic expressions' "$expect" "$actual"
+
+# Integer arithmetic is done in 64 bit integers when it cannot overflow and falls back to long
+# double arithmetic when it does, including when the operands are constants folded at compile time.
+[[ $(( 2**62 * 4 )) == 1.84467440737095516e+19 ]] || log_error 'constant multiplication overflow'
+[[ $(( 9223372036854775807 + 1 )) == 9223372036854775808 ]] || log_error 'constant addition overflow'
+integer big=4611686018427387904
+[[ $(( big * 4 )) == 1.84467440737095516e+19 ]] || log_error 'variable multiplication overflow'
+[[ $(( -7 / 2 )) == -4 && $(( 7 / -2 )) == -4 && $(( -7 % 2 )) == -1 ]] ||
+    log_error 'integer division of negative operands'
+integer m=-7 d=2
+[[ $(( m / d )) == -4 && $(( m % d )) == -1 ]] || log_error 'integer division of negative variables'
+[[ $(( 1 << 63 )) == -9223372036854775808 && $(( 1 << 64 )) == 0 && $(( -16 >> 2 )) == -4 ]] ||
+    log_error 'integer shifts'
+[[ $(( (1 ? 2 : 3) + 4 )) == 6 && $(( -(0 ? 5 : 6) )) == -6 && $(( (0 || 0) - 3 )) == -3 ]] ||
+    log_error 'constants are folded across a conditional'
+[[ $(( 1.5 + 1 )) == 2.5 && $(( 3 / 2.0 )) == 1.5 ]] || log_error 'mixed integer and float operands'
+integer z
+(( z = 3.7 ))
+[[ $z == 3 && $(( (z = 3.7) / 2 )) == 1.5 ]] || log_error 'assignment of a float to an integer'
+typeset -si s=32767
+(( s++ ))
+[[ $s == -32768 ]] || log_error 'short integer wraps around'
+integer n=9223372036854775807
+(( n++ ))
+[[ $n == -9223372036854775808 ]] || log_error 'long integer increment overflow'
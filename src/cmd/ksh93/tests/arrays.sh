@@ -872,3 +872,96 @@ unset foo bar
 typeset -a foo=([1]=w [2]=x) bar=(a b c)
 foo+=("${bar[@]}")
 [[ $(typeset -p foo) == 'typeset -a foo=([1]=w [2]=x [3]=a [4]=b [5]=c)' ]] || log_error 'Appending does not work if array contains empty indexes'
+
+# The strings of the elements of a large array are kept in storage that the array owns.
+unset big copy
+for ((i = 0; i < 20000; i++)); do big[i]=value$i; done
+for ((i = 0; i < 20000; i += 2)); do unset "big[i]"; done
+for ((i = 1; i < 20000; i += 4)); do big[i]+=x; done
+big+=(last)
+(( ${#big[@]} == 10001 )) || log_error 'large array has the wrong number of elements' 10001 "${#big[@]}"
+[[ ${big[1]} == value1x && ${big[3]} == value3 && ${big[20000]} == last ]] ||
+    log_error 'large array has the wrong values' 'value1x value3 last' "${big[1]} ${big[3]} ${big[20000]}"
+(big[3]=changed; unset "big[5]"; [[ ${big[3]} == changed && ! ${big[5]} ]]) ||
+    log_error 'large array is not changed in a subshell'
+[[ ${big[3]} == value3 && ${big[5]} == value5x ]] ||
+    log_error 'large array is changed by a subshell' 'value3 value5x' "${big[3]} ${big[5]}"
+copy=("${big[@]}")
+unset big
+[[ ${copy[0]} == value1x && ${copy[10000]} == last ]] || log_error 'copy of a large array is wrong'
+for ((i = 0; i < 1000; i++)); do bigger[i]=v$i; done
+typeset -A bigger 2> /dev/null
+[[ ${bigger[999]} == v999 ]] || log_error 'large array is wrong after conversion' v999 "${bigger[999]}"
+unset copy bigger
+
+# The strings that read -l loads are copied whole when the storage of the array is compacted.
+for ((i = 0; i < 20000; i++)); do print abcdefghi$i; done > "$TEST_DIR/lines"
+read -l big < "$TEST_DIR/lines"
+for ((i = 0; i < 20000; i += 2)); do unset "big[i]"; done
+[[ ${big[1]} == abcdefghi1 && ${big[19999]} == abcdefghi19999 ]] ||
+    log_error 'read -l array is wrong after compaction' 'abcdefghi1 abcdefghi19999' "${big[1]} ${big[19999]}"
+for ((i = 1; i < 15000; i += 2)); do unset "big[i]"; done
+[[ ${big[15001]} == abcdefghi15001 && ${#big[@]} == 2500 ]] ||
+    log_error 'read -l array is wrong after compacting twice' 'abcdefghi15001 2500' "${big[15001]} ${#big[@]}"
+unset big
+
+# Associative arrays declared with typeset -O list their subscripts in insertion order.
+unset ord
+typeset -A -O ord=([zeta]=1 [alpha]=2 [mid]=3)
+ord[beta]=4
+[[ ${!ord[*]} == 'zeta alpha mid beta' ]] || log_error 'typeset -O array is not in insertion order' 'zeta alpha mid beta' "${!ord[*]}"
+unset 'ord[alpha]'
+ord[alpha]=5
+[[ ${!ord[*]} == 'zeta mid beta alpha' ]] || log_error 'reassigned subscript of typeset -O array should be last' 'zeta mid beta alpha' "${!ord[*]}"
+expect='typeset -A -O ord=([zeta]=1 [mid]=3 [beta]=4 [alpha]=5)'
+actual=$(typeset -p ord)
+[[ $actual == "$expect" ]] || log_error 'typeset -p of a typeset -O array is wrong' "$expect" "$actual"
+eval "unset ord; $actual"
+[[ ${!ord[*]} == 'zeta mid beta alpha' ]] || log_error 'typeset -p output does not recreate the order' 'zeta mid beta alpha' "${!ord[*]}"
+(ord[new]=6; unset 'ord[zeta]'; [[ ${!ord[*]} == 'mid beta alpha new' ]]) || log_error 'typeset -O array is wrong in a subshell'
+[[ ${!ord[*]} == 'zeta mid beta alpha' ]] || log_error 'typeset -O array is changed by a subshell' 'zeta mid beta alpha' "${!ord[*]}"
+typeset -A sorted=([zeta]=1 [alpha]=2)
+[[ ${!sorted[*]} == 'alpha zeta' ]] || log_error 'associative array without -O is not sorted' 'alpha zeta' "${!sorted[*]}"
+unset ord sorted
+
+# Large associative arrays, which are indexed by hash, in both orders.
+typeset -A big
+typeset -A -O bigo
+for ((i = 999; i >= 0; i--)); do big[k$i]=$i bigo[k$i]=$i; done
+for ((i = 0; i < 1000; i += 3)); do unset "big[k$i]" "bigo[k$i]"; done
+(( ${#big[@]} == 666 && ${#bigo[@]} == 666 )) || log_error 'large associative arrays have the wrong size' '666 666' "${#big[@]} ${#bigo[@]}"
+[[ ${big[k998]} == 998 && ! ${big[k999]} && ${bigo[k1]} == 1 ]] || log_error 'large associative arrays have the wrong values'
+set -- "${!big[@]}"
+[[ $1 == k1 && ${@: -1} == k998 ]] || log_error 'large associative array is not sorted' 'k1 k998' "$1 ${@: -1}"
+set -- "${!bigo[@]}"
+[[ $1 == k998 && ${@: -1} == k1 ]] || log_error 'large typeset -O array is not in insertion order' 'k998 k1' "$1 ${@: -1}"
+unset big bigo
+
+# The numbers of large numeric arrays are kept in storage that the array owns.
+unset cnt flt
+typeset -ia cnt
+typeset -Fa flt
+for ((i = 0; i < 2000; i++)); do ((cnt[i] = i)); flt[i]=i/4.0; done
+for ((i = 0; i < 2000; i++)); do ((cnt[i % 10] += 1, flt[i] *= 2)); done
+for ((i = 0; i < 2000; i += 2)); do unset "cnt[i]"; done
+for ((i = 1; i < 2000; i += 4)); do cnt[i]+=1000; done
+(( ${#cnt[@]} == 1000 )) || log_error 'large integer array has the wrong number of elements' 1000 "${#cnt[@]}"
+[[ ${cnt[1]} == 1201 && ${cnt[3]} == 203 && ${cnt[1997]} == 2997 && ! ${cnt[4]} ]] ||
+    log_error 'large integer array has the wrong values' '1201 203 2997' "${cnt[1]} ${cnt[3]} ${cnt[1997]}"
+(( flt[7] == 3.5 && flt[1999] == 999.5 )) || log_error 'large float array has the wrong values' '3.5 999.5' "${flt[7]} ${flt[1999]}"
+for ((i = 0; i < 2000; i += 2)); do ((cnt[i] = -i)); done
+(( cnt[0] == 0 && cnt[1998] == -1998 && ${#cnt[@]} == 2000 )) || log_error 'unset elements of a large integer array are not reassigned'
+(( cnt[3] = 7, flt[3] = 0.25 ))
+[[ ${cnt[3]} == 7 && ${flt[3]} == 0.25* ]] || log_error 'elements of large numeric arrays are not assigned in place'
+( ((cnt[3] = 99, flt[3] = 99)); unset "cnt[5]"; (( cnt[3] == 99 && flt[3] == 99 )) && [[ ! ${cnt[5]} ]] ) ||
+    log_error 'large numeric arrays are not changed in a subshell'
+(( cnt[3] == 7 && flt[3] == 0.25 && cnt[5] == 1205 )) || log_error 'large numeric arrays are changed by a subshell'
+typeset -ia small=(1 2 3)
+(small[1]=9; ((small[2] += 5)))
+[[ ${small[*]} == '1 2 3' ]] || log_error 'integer array is changed by a subshell' '1 2 3' "${small[*]}"
+typeset -li cnt
+(( cnt[1997] == 2997 && ${#cnt[@]} == 2000 )) || log_error 'large integer array is wrong after typeset -li' 2997 "${cnt[1997]}"
+(( cnt[1997] += 2**40 )) && (( cnt[1997] == 2**40 + 2997 )) || log_error 'typeset -li array does not hold 64 bit numbers'
+typeset -A cnt 2> /dev/null
+(( cnt[1997] == 2**40 + 2997 && cnt[3] == 7 )) || log_error 'large integer array is wrong after conversion' "$(( 2**40 + 2997 ))" "${cnt[1997]}"
+unset cnt flt small
@@ -132,3 +132,20 @@ expect="a^Ib"
 actual=$(cat this_file_does_not_exist 2>&1)
 expect="this_file_does_not_exist: cannot open [No such file or directory]"
 [[ "$actual" =~ "$expect" ]] || log_error "cat should give an error on non-existent files" "$expect" "$actual"
+
+# ==========
+# Special characters anywhere in lines longer than the blocks scanned at once.
+line='0123456789abcdefghijklmnopqrstuvwxyz'
+print -r -- "$line"$'\001'"$line"$'\t'"$line"$'\177\n\n\n'"$line"$'\x9b'"$line" > "$TEST_DIR/long_lines"
+actual=$(LC_ALL=C cat -vn "$TEST_DIR/long_lines")
+expect="     1"$'\t'"$line^A$line"$'\t'"$line^?"$'\n     2\t\n     3\t\n     4\t'"${line}M^[$line"
+[[ "$actual" = "$expect" ]] || log_error "cat -vn of long lines failed" "$expect" "$actual"
+actual=$(LC_ALL=C cat -tbs "$TEST_DIR/long_lines")
+expect="     1"$'\t'"$line^A$line^I$line^?"$'\n\n     2\t'"${line}M^[$line"
+[[ "$actual" = "$expect" ]] || log_error "cat -tbs of long lines failed" "$expect" "$actual"
+
+# ==========
+# Line numbers wider than the field.
+actual=$(for ((i = 0; i < 1000000; i++)); do print; done | cat -n | tail -n 1)
+expect=$'1000000\t'
+[[ "$actual" = "$expect" ]] || log_error "cat -n of a million lines failed" "$expect" "$actual"
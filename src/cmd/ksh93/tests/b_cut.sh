@@ -104,3 +104,27 @@ expect=$'cut: bad list for c/f option'
 [[ "$actual" =~ "$expect" ]] || log_error "'cut -b1 f1' should show an error" "$expect" "$actual"
 
 # TODO: Add tests for multibyte characters
+
+# ==========
+# Fields of files large enough to be cut on several threads, whole and after the first line.
+print -r -- $'one:two:three\nno delimiter\n::\n1:2:3:4:5:6:7:8:9' > "$TEST_DIR/in"
+print -r -- $'two:three\nno delimiter\n:\n2:3' > "$TEST_DIR/expect"
+for ((i = 0; i < 17; i++)); do
+    cat "$TEST_DIR/in" "$TEST_DIR/in" > "$TEST_DIR/tmp" && mv "$TEST_DIR/tmp" "$TEST_DIR/in"
+    cat "$TEST_DIR/expect" "$TEST_DIR/expect" > "$TEST_DIR/tmp" && mv "$TEST_DIR/tmp" "$TEST_DIR/expect"
+done
+print -n 'last:line' >> "$TEST_DIR/in"
+print -n 'line' >> "$TEST_DIR/expect"
+cut -d: -f2,3 "$TEST_DIR/in" > "$TEST_DIR/actual"
+cmp -s "$TEST_DIR/expect" "$TEST_DIR/actual" || log_error "'cut -f' of a large file failed"
+{ read -r; cut -d: -f2,3; } < "$TEST_DIR/in" > "$TEST_DIR/actual"
+tail -n +2 "$TEST_DIR/expect" | cmp -s - "$TEST_DIR/actual" ||
+    log_error "'cut -f' of a large file after its first line failed"
+actual=$(cut -s -d: -f1 "$TEST_DIR/in" | wc -l)
+expect=$(( 3 << 17 ))
+(( actual == expect )) || log_error "'cut -s' of a large file failed" "$expect" "$actual"
+if [[ -w /dev/full ]]; then
+    actual=$(cut -d: -f2,3 "$TEST_DIR/in" 2>&1 > /dev/full; print $?)
+    [[ $actual == *'write error'*$'\n'1 ]] ||
+        log_error "'cut -f' of a large file should report a write error" "write error" "$actual"
+fi
@@ -53,3 +53,93 @@ expect="(pwd: $OLDPWD)"
 [[ "$actual" =~ "$expect" ]] || log_error "jobs builtin does not list correct working directory"
 kill -15 $!
 cd $OLDPWD
+
+# ======
+# wait finds the exit status of each of many background jobs in any order
+unset pids
+integer i
+for (( i=0 ; i < 300 ; i++ ))
+do
+    ( exit $((i % 5)) ) &
+    pids[i]=$!
+done
+for (( i=0 ; i < 300 ; i += 2 ))
+do
+    wait ${pids[i]}
+    (( $? == i % 5 )) || log_error "wait for job $i of 300 has the wrong exit status"
+done
+sleep 0.1
+for (( i=299 ; i > 0 ; i -= 2 ))
+do
+    wait ${pids[i]}
+    (( $? == i % 5 )) || log_error "saved exit status of job $i of 300 is wrong"
+done
+
+# Saved exit statuses from a subshell don't hide those of the parent shell
+( exit 4 ) &
+pid1=$!
+sleep 0.1
+(
+    ( exit 5 ) &
+    sleep 0.1
+    wait $!
+    (( $? == 5 )) || log_error "saved exit status not found in subshell"
+)
+wait $pid1
+(( $? == 4 )) || log_error "saved exit status lost after a subshell"
+
+# ======
+# wait -n returns the exit status of the first job to complete
+wait
+( sleep 0.4; exit 3 ) &
+pid1=$!
+( sleep 0.1; exit 4 ) &
+pid2=$!
+wait -n
+actual=$?
+[[ $actual == 4 ]] || log_error "wait -n did not return the first job to complete" "4" "$actual"
+wait -n
+actual=$?
+[[ $actual == 3 ]] || log_error "wait -n did not return the second job to complete" "3" "$actual"
+wait -n
+actual=$?
+[[ $actual == 127 ]] || log_error "wait -n without jobs has the wrong exit status" "127" "$actual"
+
+# wait -n with operands waits for one of those jobs only
+( sleep 0.1; exit 5 ) &
+pid1=$!
+( sleep 0.3; exit 6 ) &
+pid2=$!
+wait -n $pid2
+actual=$?
+[[ $actual == 6 ]] || log_error "wait -n pid returned the wrong job" "6" "$actual"
+wait -n $pid1 $pid2
+actual=$?
+[[ $actual == 5 ]] || log_error "wait -n did not find a job that completed earlier" "5" "$actual"
+
+# wait -n reports a job whose exit status was saved after it was unposted
+( exit 7 ) &
+sleep 0.1
+/bin/true
+wait -n
+actual=$?
+[[ $actual == 7 ]] || log_error "wait -n did not report a saved exit status" "7" "$actual"
+
+# wait without operands also collects the jobs wait -n would report
+( exit 8 ) &
+sleep 0.1
+wait
+wait -n
+actual=$?
+[[ $actual == 127 ]] || log_error "wait -n reported a job already waited for" "127" "$actual"
+
+# A loop that only runs builtins still reaps a background job once it exits
+if [[ -d /proc/$$ ]]; then
+    actual=$($SHELL -c 'sleep 0.3 & p=$!
+        for (( i = 0; i < 50; i++ )); do
+            [[ -e /proc/$p ]] || break
+            sleep 0.1
+        done
+        print $i')
+    (( actual < 50 )) || log_error "a polling loop never saw its background job exit" "< 50" "$actual"
+fi
@@ -0,0 +1,86 @@
+# Tests for parallel builtin
+
+builtin parallel
+
+# ======
+# The output of each command is written in the order of the arguments
+actual=$(printf '%s\n' 0.3 0.1 0.2 | parallel -j 3 sh -c 'sleep $1; echo $1' sh)
+expect=$'0.3\n0.1\n0.2'
+[[ $actual == "$expect" ]] || log_error "parallel output is not in argument order" "$expect" "$actual"
+
+# ======
+# The commands run at the same time
+SECONDS=0
+printf '1\n1\n1\n1\n' | parallel -j 4 sleep
+actual=$SECONDS
+(( actual < 2 )) || log_error "parallel -j 4 did not run the commands at the same time" "< 2" "$actual"
+
+# ======
+# -n appends that many arguments and empty lines are ignored
+actual=$(printf 'a\nb\n\nc\nd\ne' | parallel -n 2 echo x)
+expect=$'x a b\nx c d\nx e'
+[[ $actual == "$expect" ]] || log_error "parallel -n 2 grouped the arguments wrongly" "$expect" "$actual"
+
+# ======
+# Functions and builtins can be the command
+function f {
+    print -r -- "f $1"
+    return $1
+}
+actual=$(printf '%s\n' 0 1 2 | parallel -j 2 f)
+expect=$'f 0\nf 1\nf 2'
+[[ $actual == "$expect" ]] || log_error "parallel did not run a function" "$expect" "$actual"
+
+# ======
+# The exit status is that of the first command that failed
+printf '%s\n' 0 3 0 2 | parallel -j 4 f > /dev/null
+actual=$?
+[[ $actual == 3 ]] || log_error "parallel has the wrong exit status" "3" "$actual"
+printf '%s\n' 0 0 | parallel f > /dev/null
+actual=$?
+[[ $actual == 0 ]] || log_error "parallel failed when all commands succeeded" "0" "$actual"
+parallel nosuchcommand_xyz < /dev/null
+actual=$?
+[[ $actual == 0 ]] || log_error "parallel without arguments has the wrong exit status" "0" "$actual"
+print x | parallel nosuchcommand_xyz 2> /dev/null
+actual=$?
+[[ $actual == 127 ]] || log_error "parallel with a missing command has the wrong exit status" "127" "$actual"
+
+# ======
+# The commands don't read the standard input of parallel
+actual=$(printf '1\n2\n3\n' | parallel -j 1 sh -c 'cat; echo $1' sh)
+expect=$'1\n2\n3'
+[[ $actual == "$expect" ]] || log_error "parallel commands read its standard input" "$expect" "$actual"
+
+# ======
+# No jobs are left behind
+printf '%s\n' 1 2 3 | parallel -j 2 true
+actual=$(jobs)
+[[ -z $actual ]] || log_error "parallel left jobs on the job list" "" "$actual"
+
+# ======
+# A trapped signal runs the trap and parallel carries on with the rest of the arguments
+actual=$($SHELL -c 'builtin parallel
+    trap "print -u2 trapped" USR1
+    { sleep .3; kill -USR1 $$; } &
+    seq 6 | parallel -j 2 sh -c "sleep .2; echo \$1" sh
+    print status=$?' 2> /dev/null)
+expect=$'1\n2\n3\n4\n5\n6\nstatus=0'
+[[ $actual == "$expect" ]] || log_error "parallel did not carry on after a trapped signal" "$expect" "$actual"
+
+# ======
+# A finished command waiting for the ones before it keeps its file while another command runs, so
+# there can be one more file than commands running
+actual=$($SHELL -c "builtin parallel
+    printf '%s\n' 0.2 0.05 0.4 0.05 0.1 0.05 0.2 | parallel -j 3 sh -c 'sleep \$1; echo \$1' sh" 2>&1)
+expect=$'0.2\n0.05\n0.4\n0.05\n0.1\n0.05\n0.2'
+[[ $actual == "$expect" ]] || log_error "parallel with commands finishing out of order" "$expect" "$actual"
+actual=$($SHELL -c 'builtin parallel
+    seq 20 | parallel -j 2 echo > /dev/null
+    x=$(seq 5 | parallel -j 3 echo)
+    for j in 3 5 7; do
+        for i in 1 2 3 4 5; do y=$(seq 20 | parallel -j $j echo); done
+    done
+    print -r -- $x' 2>&1)
+expect='1 2 3 4 5'
+[[ $actual == "$expect" ]] || log_error "parallel run several times in a row" "$expect" "$actual"
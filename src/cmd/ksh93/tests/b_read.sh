@@ -203,3 +203,70 @@ read baz <<< 'foo\\\\bar'
 
 printf '\\\000' | read -r -d ''
 [[ $REPLY == $'\\' ]] || log_error "read -r -d'' ignores -r"
+
+# ==========
+# A loop whose input only read consumes reads ahead on a pipe, other loops must not.
+actual=$(seq 10000 | while read x; do print -r -- "$x"; done | tail -n 1)
+[[ $actual == 10000 ]] || log_error "read loop on a pipe" 10000 "$actual"
+actual=$(seq 6 | while read x; do read y; print -r -- "$x-$y"; done)
+expect=$'1-2\n3-4\n5-6'
+[[ $actual == "$expect" ]] || log_error "reads in a loop on a pipe" "$expect" "$actual"
+actual=$(seq 6 | while read x; do print -r -- "$x"; head -n 1; done)
+expect=$'1\n2\n3\n4\n5\n6'
+[[ $actual == "$expect" ]] || log_error "read loop shares its pipe with head" "$expect" "$actual"
+actual=$(seq 4 | while read x; do print -r -- "$x"; print -r -- "$(head -n 1)"; done)
+expect=$'1\n2\n3\n4'
+[[ $actual == "$expect" ]] ||
+    log_error "read loop shares its pipe with a command substitution" "$expect" "$actual"
+actual=$(while read x; do print -r -- "$x"; read y < "$TEST_DIR/script"; done < <(seq 3))
+expect=$'1\n2\n3'
+[[ $actual == "$expect" ]] || log_error "read loop with a redirected read" "$expect" "$actual"
+actual=$(seq 10 | { while read x; do [[ $x == 2 ]] && break; done < /dev/stdin; cat; })
+expect=$'3\n4\n5\n6\n7\n8\n9\n10'
+[[ $actual == "$expect" ]] || log_error "read loop on /dev/stdin reads ahead" "$expect" "$actual"
+actual=$(seq 10 | { exec 3<&0; while read x; do [[ $x == 8 ]] && break; done < /dev/fd/3; cat; })
+expect=$'9\n10'
+[[ $actual == "$expect" ]] || log_error "read loop on /dev/fd/3 reads ahead" "$expect" "$actual"
+
+# ==========
+# read -n leaves the rest of a buffered line for the next read.
+actual=$(seq 3 | while read x; do read -n 1 c; print -r -- "$x:$c"; [[ $c == 3 ]] && break; done)
+expect=$'1:2\n:3'
+[[ $actual == "$expect" ]] || log_error "read -n in a read loop" "$expect" "$actual"
+seq 3 > "$TEST_DIR/lines"
+actual=$(while read x; do
+    read -n 1 c; print -r -- "$x:$c"; [[ $c == 3 ]] && break
+done < "$TEST_DIR/lines")
+[[ $actual == "$expect" ]] || log_error "read -n in a read loop on a file" "$expect" "$actual"
+
+# ==========
+# read -l reads every remaining line into an array without splitting or escapes.
+printf 'a b\nc\\d\n\ne' > "$TEST_DIR/lines"
+read -l x < "$TEST_DIR/lines"
+[[ $? == 0 && ${#x[@]} == 4 ]] || log_error "read -l element count" 4 "${#x[@]}"
+actual=$(typeset -p x)
+expect="typeset -a x=('a b' 'c\\d' '' e)"
+[[ $actual == "$expect" ]] || log_error "read -l values" "$expect" "$actual"
+x[1]=new
+x[0]+=more
+unset x[2]
+typeset -u x
+expect='A BMORE NEW E'
+[[ ${x[*]} == "$expect" ]] || log_error "read -l elements modified" "$expect" "${x[*]}"
+read -l x < "$TEST_DIR/lines"
+(read -l x <<< $'p\nq'; [[ ${x[*]} == 'p q' ]]) || log_error "read -l in a subshell"
+[[ ${x[3]} == e ]] || log_error "read -l array changed in a subshell" e "${x[3]}"
+set -s -A x
+expect=$' a b c\\d e'
+[[ ${x[*]} == "$expect" ]] || log_error "read -l array sorted" "$expect" "${x[*]}"
+read -l x < /dev/null && log_error "read -l with no input should fail"
+[[ ${#x[@]} == 0 ]] || log_error "read -l with no input should unset the array"
+actual=$(printf 'x:y:z:' | { read -l -d : x; print -r -- "${#x[@]} ${x[*]}"; })
+[[ $actual == '3 x y z' ]] || log_error "read -l -d" '3 x y z' "$actual"
+actual=$(seq 100000 | { read -l; print -r -- "${#REPLY[@]} ${REPLY[99999]}"; })
+[[ $actual == '100000 100000' ]] || log_error "read -l into REPLY" '100000 100000' "$actual"
+# read -l -t gives up when the input has not ended in time.
+actual=$({ sleep 3; print late; } | { SECONDS=0; read -l -t 0.5 x; print -r -- "$? ${#x[@]} ${SECONDS%.*}"; })
+[[ $actual == '1 0 0' ]] || log_error "read -l -t does not time out" '1 0 0' "$actual"
+actual=$(seq 3 | { read -l -t 2 x; print -r -- "$? ${x[*]}"; })
+[[ $actual == '0 1 2 3' ]] || log_error "read -l -t with input in time" '0 1 2 3' "$actual"
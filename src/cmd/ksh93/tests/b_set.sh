@@ -314,6 +314,7 @@ letoctal                 off
 log                      on
 login_shell              off
 markdirs                 off
+memstats                 off
 monitor                  off
 multiline                off
 notify                   off
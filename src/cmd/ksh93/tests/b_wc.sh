@@ -68,3 +68,31 @@ expect=$"      33 $TEST_DIR/file2"
 actual=$(wc -N "$TEST_DIR/file2")
 expect="       7      38     158 $TEST_DIR/file2"
 [[ "$actual" = "$expect" ]] || log_error "'wc -N' failed" "$expect" "$actual"
+
+# ==========
+# Files larger than the blocks the counting kernels work on, whole and through a pipe.
+for ((i = 0; i < 1000; i++)); do print $'one two\tthree  four'; done > "$TEST_DIR/ascii"
+print -n 'tail end' >> "$TEST_DIR/ascii"
+actual=$(wc "$TEST_DIR/ascii")
+expect="    1000    4002   20008 $TEST_DIR/ascii"
+[[ "$actual" = "$expect" ]] || log_error "'wc' of a large file failed" "$expect" "$actual"
+actual=$(cat "$TEST_DIR/ascii" | wc)
+expect="    1000    4002   20008"
+[[ "$actual" = "$expect" ]] || log_error "'wc' of a pipe failed" "$expect" "$actual"
+actual=$(LC_ALL=C wc < "$TEST_DIR/ascii")
+[[ "$actual" = "$expect" ]] || log_error "'wc' in the C locale failed" "$expect" "$actual"
+
+for ((i = 0; i < 1000; i++)); do print 'héllo 神 😀'; done > "$TEST_DIR/utf8"
+actual=$(wc -l -m "$TEST_DIR/utf8")
+expect="    1000   10000 $TEST_DIR/utf8"
+[[ "$actual" = "$expect" ]] || log_error "'wc -l -m' of a large file failed" "$expect" "$actual"
+actual=$(wc -w < "$TEST_DIR/utf8")
+expect="    3000"
+[[ "$actual" = "$expect" ]] || log_error "'wc -w' of a large file failed" "$expect" "$actual"
+
+# An invalid byte is still diagnosed on the right line.
+{ head -n 499 "$TEST_DIR/utf8"; print $'bad \xff byte'; tail -n 500 "$TEST_DIR/utf8"; } > "$TEST_DIR/invalid"
+actual=$(wc -l -m "$TEST_DIR/invalid" 2>&1)
+expect="wc: \"$TEST_DIR/invalid\", line 499: warning: invalid multibyte character"
+expect+=$'\n'"    1000   10001 $TEST_DIR/invalid"
+[[ "$actual" = "$expect" ]] || log_error "'wc -m' of an invalid byte failed" "$expect" "$actual"
@@ -610,6 +610,21 @@ touch "$TEST_DIR/corrupted_history"
 echo "sa;lfjsa;fj;sajfjs;fjdf" > "$TEST_DIR/corrupted_history"
 env HISTFILE="$TEST_DIR/corrupted_history" $SHELL -i -c "[[ $(history | wc -l) -eq 0 ]] && exit 0 || exit 1"
 
+# ==========
+# hist -s finds the most recent command that begins with a string in a large history, including
+# commands added after an earlier search
+{
+    print 'print first'
+    for ((i = 0; i < 2000; i++)); do print ": $i"; done
+    print 'hist -s first=second pr'
+    print 'print third'
+    print 'hist -s pr'
+} > "$TEST_DIR/hist_input"
+expect=$'first\nsecond\nthird\nthird'
+actual=$(env HISTFILE="$TEST_DIR/large_history" HISTSIZE=5000 ENV=/dev/null \
+    $SHELL -i < "$TEST_DIR/hist_input" 2> /dev/null)
+[[ $actual == "$expect" ]] || log_error "hist -s should find commands in a large history" "$expect" "$actual"
+
 # ==========
 # umask - get or set the file creation mask
 set -- \
@@ -0,0 +1,64 @@
+# Tests for the environment passed to external commands, which is reused between commands until
+# an exported variable changes.
+
+# The definition of a function that prints how an external command sees the variable named <$1>.
+show='function show { /usr/bin/env | /bin/grep "^$1=" || print "$1 unset"; }'
+
+# ==========
+# Every change to an exported variable is seen by the next command.
+expect=$'FOO=one\nFOO=one\nFOO=two\nFOO=twothree\nFOO unset\nFOO unset\nFOO=five\nFOO unset'
+expect+=$'\nFOO=five\nFOO=FIVE\nFOO=SIX\nN=2\nN=5\nFOO=SUBSHELL\nFOO=SIX\nFOO=prefix\nFOO=SIX'
+actual=$($SHELL -c "$show"'
+    export FOO=one
+    show FOO
+    show FOO
+    FOO=two
+    show FOO
+    FOO+=three
+    show FOO
+    unset FOO
+    show FOO
+    FOO=four
+    show FOO
+    export FOO=five
+    show FOO
+    export -n FOO
+    show FOO
+    typeset -x FOO
+    show FOO
+    typeset -u FOO
+    show FOO
+    read FOO <<< six
+    show FOO
+    typeset -xi N=1
+    (( N++ ))
+    show N
+    let N+=3
+    show N
+    (FOO=subshell; show FOO)
+    show FOO
+    FOO=prefix show FOO
+    show FOO' 2>&1)
+[[ $actual == "$expect" ]] || log_error "exported variable changes" "$expect" "$actual"
+
+# ==========
+# Variables exported in a function are only seen while it runs.
+expect=$'BAR=local\nBAZ=local\nBAR=global\nBAZ unset'
+actual=$($SHELL -c "$show"'
+    export BAR=global
+    function f { typeset -x BAR=local; show BAR; typeset -x BAZ=local; show BAZ; }
+    f
+    show BAR
+    show BAZ' 2>&1)
+[[ $actual == "$expect" ]] || log_error "function local exports" "$expect" "$actual"
+
+# ==========
+# Exported variables whose value is computed on demand are always regenerated.
+expect=$'OPTIND=1\nOPTIND=3\nOPTIND=1'
+actual=$($SHELL -c 'export OPTIND
+    /usr/bin/env | /bin/grep ^OPTIND=
+    getopts a: opt -a x
+    /usr/bin/env | /bin/grep ^OPTIND=
+    OPTIND=1
+    /usr/bin/env | /bin/grep ^OPTIND=' 2>&1)
+[[ $actual == "$expect" ]] || log_error "exported OPTIND" "$expect" "$actual"
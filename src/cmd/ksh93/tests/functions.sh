@@ -1335,3 +1335,35 @@ $SHELL -c 'function ftest { ftest2; }; function ftest2 { unset -f ftest; }; ftes
 function f2 { env | grep -q "^foo" || log_error "Environment variable is not propogated from caller function"; }
 function f1 { f2; env | grep -q "^foo" || log_error "Environment variable is not passed to a function"; }
 foo=bar f1
+
+# A name cached while it resolved to a global must not be used after a local of the same name is
+# declared, nor outlive the function scope it was cached in.
+function shadow_global {
+    for i in 1 2; do shadowed=outer; done
+    typeset shadowed
+    for i in 1 2; do shadowed=inner; done
+    print -r -- "$shadowed"
+}
+shadowed=global
+actual=$(shadow_global; shadow_global; print -r -- "$shadowed")
+expect=$'inner\ninner\nouter'
+[[ $actual == "$expect" ]] ||
+    log_error "cached global used after declaring a local" "$expect" "$actual"
+
+function set_local { typeset scoped=local; }
+function set_global { scoped=1; set_local; set_local; scoped=2; }
+scoped=0
+set_global
+[[ $scoped == 2 ]] || log_error "cached name outlived its function scope" 2 "$scoped"
+
+# Redefining or unsetting a function must only delete its own static variables.
+keep=1
+function set_static_member { nameref var=$1; var.foo=bar; }
+function with_static { compound -S container; set_static_member container; }
+with_static
+function with_static { :; }
+[[ $keep == 1 ]] || log_error "redefining a function with statics deleted a global" 1 "$keep"
+function with_static2 { compound -S container; set_static_member container; }
+with_static2
+unset -f with_static2
+[[ $keep == 1 ]] || log_error "unsetting a function with statics deleted a global" 1 "$keep"
@@ -0,0 +1,85 @@
+# Tests for the parse tree cache enabled by KSH_PARSE_CACHE.
+
+export KSH_PARSE_CACHE=$TEST_DIR/cache
+
+# Run <commands> in a new shell and print their output followed by the cache hit and miss counts.
+function cached {
+    $SHELL -c "$1; print \${.sh.stats.parse_cachehit} \${.sh.stats.parse_cachemiss}" 2>&1
+}
+
+print -r -- 'function greet {
+    print -r -- "hello $1"
+}
+greet world
+cat <<END
+here-doc $((6 * 7))
+END
+print line $LINENO' > "$TEST_DIR/script.ksh"
+
+# ==========
+# The first `.` of a script records an entry that later ones restore.
+expect=$'hello world\nhere-doc 42\nline 8\n0 1'
+actual=$(cached ". '$TEST_DIR/script.ksh'")
+[[ $actual == "$expect" ]] || log_error "first . of a script" "$expect" "$actual"
+actual=$(ls "$KSH_PARSE_CACHE" | wc -l)
+(( actual == 1 )) || log_error "one cache entry should be written" 1 "$actual"
+expect=$'hello world\nhere-doc 42\nline 8\n1 0'
+actual=$(cached ". '$TEST_DIR/script.ksh'")
+[[ $actual == "$expect" ]] || log_error "second . of a script" "$expect" "$actual"
+
+# ==========
+# A restored function can still be listed.
+expect=$'function greet {\n    print -r -- "hello $1"\n}'
+actual=$($SHELL -c ". '$TEST_DIR/script.ksh' > /dev/null; typeset -f greet" 2>&1)
+[[ $actual == "$expect" ]] || log_error "typeset -f of a cached function" "$expect" "$actual"
+
+# ==========
+# Changing the script or the aliases in effect invalidates the entry.
+print 'print changed' >> "$TEST_DIR/script.ksh"
+expect=$'hello world\nhere-doc 42\nline 8\nchanged\n0 1'
+actual=$(cached ". '$TEST_DIR/script.ksh'")
+[[ $actual == "$expect" ]] || log_error "modified script should be parsed" "$expect" "$actual"
+expect=$'aliased world\nhere-doc 42\nline 8\nchanged\n0 1'
+actual=$(cached "alias greet='print -r aliased'
+. '$TEST_DIR/script.ksh'")
+[[ $actual == "$expect" ]] || log_error "new aliases should cause a reparse" "$expect" "$actual"
+
+# ==========
+# A script with a syntax error is not cached.
+print 'if then' > "$TEST_DIR/bad.ksh"
+$SHELL -c ". '$TEST_DIR/bad.ksh'" 2> /dev/null
+expect='0 1'
+actual=$(cached "{ . '$TEST_DIR/bad.ksh'; } 2> /dev/null")
+[[ $actual == "$expect" ]] || log_error "a script with a syntax error should not be cached" \
+    "$expect" "$actual"
+
+# ==========
+# An entry that is not a compiled script is ignored.
+print 'print one' > "$TEST_DIR/one.ksh"
+$SHELL -c ". '$TEST_DIR/one.ksh'" > /dev/null
+for entry in "$KSH_PARSE_CACHE"/*; do
+    [[ $entry -nt $TEST_DIR/bad.ksh ]] && print 'print two' > "$entry"
+done
+expect=$'one\n0 1'
+actual=$(cached ". '$TEST_DIR/one.ksh'")
+[[ $actual == "$expect" ]] || log_error "a damaged entry should be ignored" "$expect" "$actual"
+
+# ==========
+# Function files loaded from FPATH are cached too.
+mkdir "$TEST_DIR/fun"
+print -r -- 'autof_var=set
+function autof {
+    print -r -- "autof $1 $autof_var"
+}' > "$TEST_DIR/fun/autof"
+expect=$'autof x set\n0 1'
+actual=$(FPATH=$TEST_DIR/fun cached "autof x")
+[[ $actual == "$expect" ]] || log_error "first autoload" "$expect" "$actual"
+expect=$'autof x set\n1 0'
+actual=$(FPATH=$TEST_DIR/fun cached "autof x")
+[[ $actual == "$expect" ]] || log_error "second autoload" "$expect" "$actual"
+
+# ==========
+# The cache is not used unless KSH_PARSE_CACHE is set.
+expect=$'one\n0 0'
+actual=$(unset KSH_PARSE_CACHE; cached ". '$TEST_DIR/one.ksh'")
+[[ $actual == "$expect" ]] || log_error "cache used without KSH_PARSE_CACHE" "$expect" "$actual"
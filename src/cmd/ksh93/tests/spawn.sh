@@ -0,0 +1,74 @@
+# Tests for simple external commands started with posix_spawn() instead of fork().
+
+stats='print ${.sh.stats.forks} ${.sh.stats.spawns}'
+
+# ==========
+# A simple command is spawned, with its redirections and assignments.
+expect=$'one\ntwo\nFOO=bar\n0\n2\nerr\n0 9'
+actual=$($SHELL -c '/bin/echo one > out
+    /bin/echo two >> out
+    /bin/cat < out
+    FOO=bar /usr/bin/env | /bin/grep ^FOO=
+    /usr/bin/env | /bin/grep -c ^FOO=
+    /bin/ls -d /nonexistent 2> /dev/null || print $?
+    /bin/sh -c "echo err >&2" 2>&1 > /dev/null 3>&-
+    '"$stats" 2>&1)
+[[ $actual == "$expect" ]] || log_error "simple commands should be spawned" "$expect" "$actual"
+
+# ==========
+# Commands that can not be spawned are forked and behave as before.
+print 'print no interpreter' > noshbang
+chmod +x noshbang
+expect=$'no interpreter\n127\nhere-doc'
+actual=$($SHELL -c "./noshbang; nosuchcommand 2> /dev/null; print \$?; /bin/cat <<< here-doc" 2>&1)
+[[ $actual == "$expect" ]] || log_error "forked commands" "$expect" "$actual"
+
+# ==========
+# Errors opening a redirection are still reported by the forked child.
+: > exists
+actual=$($SHELL -o noclobber -c '/bin/echo x > exists; print $?' 2>&1)
+[[ $actual == *exists*$'\n1' ]] || log_error "noclobber should be honored" "*exists*" "$actual"
+actual=$($SHELL -c '/bin/cat < nosuchfile; print $?' 2>&1)
+[[ $actual == *nosuchfile*$'\n1' ]] || log_error "missing input file" "*nosuchfile*" "$actual"
+
+# ==========
+# A redirection whose expansion has side effects is still expanded by a forked child.
+expect=$'x\n0'
+actual=$($SHELL -c 'i=0; /bin/echo x > out$((i++)); /bin/cat out0; print $i' 2>&1)
+[[ $actual == "$expect" ]] || log_error "arithmetic in a redirection" "$expect" "$actual"
+
+# ==========
+# Signals ignored with trap are ignored by the command.
+expect=ignored
+actual=$($SHELL -c "trap '' USR1; /bin/sh -c 'kill -USR1 \$\$; echo ignored'" 2>&1)
+[[ $actual == "$expect" ]] || log_error "ignored signals" "$expect" "$actual"
+
+# ==========
+# The elements of a pipeline and commands run with & are spawned too.
+expect=$'a\nb\n0 4'
+actual=$($SHELL -c "/bin/echo a | /bin/cat; /bin/echo b > out & wait; /bin/cat out; $stats" 2>&1)
+[[ $actual == "$expect" ]] || log_error "pipelines and background commands should be spawned" "$expect" "$actual"
+
+# ==========
+# A background command without job control reads /dev/null and ignores interrupts.
+expect=$'\nignored'
+actual=$(print input | $SHELL -c "/bin/sh -c 'read x; echo \"\$x\"' & wait
+/bin/sh -c 'kill -INT \$\$; echo ignored' & wait" 2>&1)
+[[ $actual == "$expect" ]] || log_error "background commands" "$expect" "$actual"
+
+# ==========
+# Words whose expansion has side effects are expanded by the forked child.
+expect=$'0\n0'
+actual=$($SHELL -c 'i=0; /bin/echo $((i++)) | /bin/cat; print $i' 2>&1)
+[[ $actual == "$expect" ]] || log_error "arithmetic in a pipeline element" "$expect" "$actual"
+
+# ==========
+# A word whose expansion can fail is expanded by the forked child, so the failure doesn't end the
+# shell.
+expect=after
+actual=$($SHELL -c 'x=abc; /bin/echo ${x:1/0} & wait; print after' 2> /dev/null)
+[[ $actual == "$expect" ]] || log_error "failed expansion in a background command" "$expect" "$actual"
+actual=$($SHELL -c '/bin/echo ${x:a+} | /bin/cat; print after' 2> /dev/null)
+[[ $actual == "$expect" ]] || log_error "failed expansion in a pipeline element" "$expect" "$actual"
+actual=$($SHELL -c 'x=(a b); /bin/echo x > out${x[1/0]}; print after' 2> /dev/null)
+[[ $actual == "$expect" ]] || log_error "failed expansion in a redirection" "$expect" "$actual"
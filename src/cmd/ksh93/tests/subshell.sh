@@ -856,3 +856,48 @@ for exp in 65535 65536
 do    got=$($SHELL -c 'x=$(printf "%.*c" '$exp' x); print ${#x}' 2>&1)
     [[ $got == $exp ]] || log_error "large command substitution failed" "$exp" "$got"
 done
+
+# Command substitution of a pipeline of builtins runs without forking
+builtin cat cut head wc
+forks=${.sh.stats.forks}
+actual=$(print -r -- a:b:c | cut -d: -f2)
+[[ $actual == b ]] || log_error "cut in a command substitution pipeline" "b" "$actual"
+actual=$(printf '%s\n' 1 2 3 4 5 | head -n 3 | wc -l)
+[[ $actual == *3 ]] || log_error "three stage command substitution pipeline" "3" "$actual"
+actual=$(printf '%05d\n' {1..20000} | cut -c1-3 | cat | wc -l)
+[[ $actual == *20000 ]] || log_error "large command substitution pipeline" "20000" "$actual"
+actual=$(print -n | wc -c)
+[[ $actual == *0 ]] || log_error "empty command substitution pipeline" "0" "$actual"
+actual=$(print one | cut -c1-3; print two)
+[[ $actual == $'one\ntwo' ]] || log_error "command substitution pipeline followed by a command" \
+    $'one\ntwo' "$actual"
+(( ${.sh.stats.forks} == forks )) ||
+    log_error "command substitution of builtins forked" 0 "$(( ${.sh.stats.forks} - forks ))"
+
+actual=$(print a | false)
+(( $? == 1 )) || log_error "exit status of a command substitution pipeline is not the last element"
+actual=$(false | print a)
+(( $? == 0 )) || log_error "exit status of a command substitution pipeline is not the last element"
+actual=$(set -o pipefail; false | print a)
+(( $? == 1 )) || log_error "pipefail is ignored by a command substitution pipeline"
+actual=$(set -e; false | cut -c1; print ok)
+[[ $actual == ok ]] || log_error "errexit applied to an element of a pipeline other than the last" \
+    "ok" "$actual"
+
+# Elements that are not builtins or whose expansions have side effects are still forked
+function cut { print func; }
+actual=$(print a | cut -c1)
+[[ $actual == func ]] || log_error "function in a command substitution pipeline" "func" "$actual"
+unset -f cut
+x=1
+actual=$(print ${x:=2} $((x = 3)) | cat; print $x)
+[[ $actual == $'1 3\n1' ]] || log_error "side effects of a pipeline element leaked" $'1 3\n1' \
+    "$actual"
+typeset -i n=0
+v=abc
+function v.get { (( n++ )); }
+actual=$(print -r -- $v | wc -c; print $n)
+[[ $actual == *4$'\n'0 ]] || log_error "get discipline of a pipeline element ran in the current shell" \
+    $'4\n0' "$actual"
+unset -f v.get
+unset v n
@@ -831,3 +831,50 @@ actual="${.sh.file}"
 actual="$(pwd -f ${.sh.pwdfd})"
 expect="$PWD"
 [[ "$actual" = "$expect" ]] || log_error ".sh.pwdfd should point to fd of current working directory"
+
+# The nv_open() cache must hold more than a handful of names and report its use in .sh.stats.
+typeset -i hits=${.sh.stats.nv_cachehit} misses=${.sh.stats.nv_cachemiss}
+for ((i = 0; i < 100; i++)); do
+    v0=0 v1=1 v2=2 v3=3 v4=4 v5=5 v6=6 v7=7 v8=8 v9=9 v10=10 v11=11 v12=12 v13=13 v14=14 v15=15
+done
+(( ${.sh.stats.nv_cachehit} - hits >= 1400 )) ||
+    log_error "nv_open cache hits too low" ">= 1400" "$(( ${.sh.stats.nv_cachehit} - hits ))"
+(( ${.sh.stats.nv_cachemiss} - misses < 200 )) ||
+    log_error "nv_open cache misses too high" "< 200" "$(( ${.sh.stats.nv_cachemiss} - misses ))"
+
+# .sh.mem accounts for the memory held by variables, arrays, functions and stacks.
+typeset -i nodes=${.sh.mem.vars_count} funcs=${.sh.mem.functions_count}
+for ((i = 0; i < 100; i++)); do
+    typeset memvar$i=x
+done
+(( ${.sh.mem.vars_count} - nodes >= 100 )) ||
+    log_error ".sh.mem.vars_count did not count new variables" ">= 100" \
+        "$(( ${.sh.mem.vars_count} - nodes ))"
+typeset -a memarray
+for ((i = 0; i < 1000; i++)); do
+    memarray[i]=value$i
+done
+(( ${.sh.mem.arrays_count} == 1 && ${.sh.mem.arrays_bytes} > 8000 )) ||
+    log_error ".sh.mem does not account for the store of a large array" \
+        "1 store of more than 8000 bytes" "${.sh.mem.arrays_count} ${.sh.mem.arrays_bytes}"
+unset memarray
+(( ${.sh.mem.arrays_count} == 0 && ${.sh.mem.arrays_bytes} == 0 && ${.sh.mem.arrays_peak} > 8000 )) ||
+    log_error ".sh.mem does not release the store of an unset array" "0 0 >8000" \
+        "${.sh.mem.arrays_count} ${.sh.mem.arrays_bytes} ${.sh.mem.arrays_peak}"
+function memfun { print $1; }
+(( ${.sh.mem.functions_count} == funcs + 1 && ${.sh.mem.functions_bytes} > 0 )) ||
+    log_error ".sh.mem does not count a function definition" "$(( funcs + 1 ))" \
+        "${.sh.mem.functions_count}"
+unset -f memfun
+(( ${.sh.mem.functions_count} == funcs )) ||
+    log_error ".sh.mem does not release an unset function" "$funcs" "${.sh.mem.functions_count}"
+(( ${.sh.mem.stk_count} >= 1 && ${.sh.mem.stk_peak} >= ${.sh.mem.stk_bytes} )) ||
+    log_error ".sh.mem does not report the stacks" ">= 1" "${.sh.mem.stk_count}"
+$SHELL -c '.sh.mem.vars_count=1' 2>/dev/null && log_error ".sh.mem should be read-only"
+
+# The memstats option writes the accounting to standard error once, when the shell exits.
+actual=$($SHELL --memstats -c 'x=$(print hi); ( : ); exit 3' 2>&1 >/dev/null)
+[[ $? == 3 && $actual == memory*vars*arrays*functions*history*stk*heap* ]] ||
+    log_error "--memstats did not write the accounting at exit" "memory ... heap" "$actual"
+(( $(print -r -- "$actual" | wc -l) == 7 )) ||
+    log_error "--memstats wrote the accounting more than once" "7 lines" "$actual"
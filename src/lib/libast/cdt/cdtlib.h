@@ -113,7 +113,30 @@ static inline void DTANNOUNCE(Dt_t *dt, void *object, int type) {
 // #define RRSHIFT(x, t)
 //     ((t) = (x)->_left->_left, (x)->_left->_left = (t)->_rght, (t)->_rght = (x), (x) = (t))
 
+/* a slot of a hash index (see dthindex.c) */
+typedef struct _dthslot_s {
+    Dtlink_t *link; /* indexed object or NULL */
+    uint hash;      /* memoized hash of its key */
+} Dthslot_t;
+
+/* hash index that a method can keep beside its own structure */
+typedef struct _dthindex_s {
+    Dthslot_t *htbl; /* open addressing table of links */
+    ssize_t tblz;    /* size of htbl, a power of two */
+    ssize_t hcnt;    /* number of links in htbl */
+} Dthindex_t;
+
+/* A hash index is built only once a dictionary has this many objects. Smaller dictionaries,
+** such as the scope of a typical function call, are searched fast enough without one.
+*/
+#define DT_HMINSIZE 32
+
 extern Dtlink_t *_dtmake(Dt_t *, void *, int);
 extern void _dtfree(Dt_t *, Dtlink_t *, int);
+extern void _dthfree(Dt_t *, Dthindex_t *);
+extern ssize_t _dthfind(Dt_t *, Dthindex_t *, void *, uint);
+extern void _dthadd(Dt_t *, Dthindex_t *, Dtlink_t *, uint);
+extern void _dthdelete(Dthindex_t *, ssize_t);
+extern int _dthbuild(Dt_t *, Dthindex_t *, Dtlink_t *);
 
 #endif  // _CDTLIB_H
@@ -0,0 +1,130 @@
+/***********************************************************************
+ *                                                                      *
+ *               This software is part of the ast package               *
+ *          Copyright (c) 1985-2013 AT&T Intellectual Property          *
+ *                      and is licensed under the                       *
+ *                 Eclipse Public License, Version 1.0                  *
+ *                    by AT&T Intellectual Property                     *
+ *                                                                      *
+ *                A copy of the License is available at                 *
+ *          http://www.eclipse.org/org/documents/epl-v10.html           *
+ *         (with md5 checksum b35adb5213ca9657e911e9befb180842)         *
+ *                                                                      *
+ *              Information and Software Systems Research               *
+ *                            AT&T Research                             *
+ *                           Florham Park NJ                            *
+ *                                                                      *
+ *               Glenn Fowler <glenn.s.fowler@gmail.com>                *
+ *                    David Korn <dgkorn@gmail.com>                     *
+ *                     Phong Vo <phongvo@gmail.com>                     *
+ *                                                                      *
+ ***********************************************************************/
+#include "config_ast.h"  // IWYU pragma: keep
+
+#include <string.h>
+
+#include "cdt.h"
+#include "cdtlib.h"
+
+/*      Open addressing hash index over the links of a dictionary.
+**      Methods that keep their objects in some other structure (Dtohset's splay tree,
+**      Dtiset's list) use this to answer keyed searches in constant time. The index only
+**      points at links; it never owns objects.
+*/
+
+/* discard the index */
+void _dthfree(Dt_t *dt, Dthindex_t *hx) {
+    if (hx->htbl) (void)(*dt->memoryf)(dt, hx->htbl, 0, dt->disc);
+    hx->htbl = NULL;
+    hx->tblz = hx->hcnt = 0;
+}
+
+/* slot holding an object with this key or, if there is none, the free slot ending the probe */
+ssize_t _dthfind(Dt_t *dt, Dthindex_t *hx, void *key, uint hsh) {
+    ssize_t s, mask;
+    Dtlink_t *l;
+    Dtdisc_t *disc = dt->disc;
+
+    mask = hx->tblz - 1;
+    for (s = hsh & mask; (l = hx->htbl[s].link); s = (s + 1) & mask) {
+        if (hx->htbl[s].hash != hsh) continue;
+        if (_DTCMP(dt, key, _DTKEY(disc, _DTOBJ(disc, l)), disc) == 0) break;
+    }
+    return s;
+}
+
+/* make a table of n slots and move the current entries into it */
+static_fn int dth_resize(Dt_t *dt, Dthindex_t *hx, ssize_t n) {
+    ssize_t s, k, mask;
+    Dthslot_t *htbl, *old;
+
+    if (!(htbl = (Dthslot_t *)(*dt->memoryf)(dt, NULL, n * sizeof(Dthslot_t), dt->disc))) {
+        _dthfree(dt, hx); /* searches fall back to the method's own */
+        return -1;
+    }
+    memset(htbl, 0, n * sizeof(Dthslot_t));
+
+    mask = n - 1;
+    if ((old = hx->htbl)) {
+        for (s = 0; s < hx->tblz; ++s) {
+            if (!old[s].link) continue;
+            for (k = old[s].hash & mask; htbl[k].link; k = (k + 1) & mask) {
+                ;  // empty loop
+            }
+            htbl[k] = old[s];
+        }
+        (void)(*dt->memoryf)(dt, old, 0, dt->disc);
+    }
+    hx->htbl = htbl;
+    hx->tblz = n;
+    return 0;
+}
+
+/* add a link known not to be in the index, keeping the load factor at or below three quarters.
+** Slots memoize hashes so a long probe sequence costs few key comparisons.
+*/
+void _dthadd(Dt_t *dt, Dthindex_t *hx, Dtlink_t *lnk, uint hsh) {
+    ssize_t s, mask;
+
+    if (4 * (hx->hcnt + 1) > 3 * hx->tblz && dth_resize(dt, hx, 2 * hx->tblz) < 0) return;
+
+    mask = hx->tblz - 1;
+    for (s = hsh & mask; hx->htbl[s].link; s = (s + 1) & mask) {
+        ;  // empty loop
+    }
+    hx->htbl[s].link = lnk;
+    hx->htbl[s].hash = hsh;
+    hx->hcnt += 1;
+}
+
+/* empty slot s and shift back later members of its probe sequence so no search stops early */
+void _dthdelete(Dthindex_t *hx, ssize_t s) {
+    ssize_t k, home, mask;
+    Dthslot_t *htbl = hx->htbl;
+
+    mask = hx->tblz - 1;
+    for (k = (s + 1) & mask; htbl[k].link; k = (k + 1) & mask) {
+        home = htbl[k].hash & mask;
+        /* move htbl[k] into the hole unless its home slot lies cyclically in (s,k] */
+        if (s <= k ? (s < home && home <= k) : (s < home || home <= k)) continue;
+        htbl[s] = htbl[k];
+        s = k;
+    }
+    htbl[s].link = NULL;
+    hx->hcnt -= 1;
+}
+
+/* index every link of a list chained through _rght; the list holds all dt->data->size objects */
+int _dthbuild(Dt_t *dt, Dthindex_t *hx, Dtlink_t *list) {
+    ssize_t n;
+    Dtlink_t *l;
+    Dtdisc_t *disc = dt->disc;
+
+    for (n = 2 * DT_HMINSIZE; n < 2 * dt->data->size;) n *= 2;
+    if (dth_resize(dt, hx, n) < 0) return -1;
+
+    for (l = list; l; l = l->_rght) {
+        _dthadd(dt, hx, l, _DTHSH(dt, _DTKEY(disc, _DTOBJ(disc, l)), disc));
+    }
+    return 0;
+}
@@ -26,7 +26,7 @@
 #include "cdt.h"
 #include "cdtlib.h"
 
-/*      List, Deque, Stack, Queue.
+/*      List, Deque, Stack, Queue, Iset.
 **
 **      Written by Kiem-Phong Vo, phongvo@gmail.com (05/25/96)
 */
@@ -35,6 +35,7 @@ typedef struct _dtlist_s {
     Dtdata_t data;
     Dtlink_t *link; /* list of objects          */
     Dtlink_t *here; /* finger to searched objects       */
+    Dthindex_t hidx; /* Dtiset: hash index of the objects */
 } Dtlist_t;
 
 #ifdef DEBUG
@@ -128,8 +129,8 @@ static_fn void *dtlist_at(Dt_t *dt, Dtstat_t *st) {
         memset(st, 0, sizeof(Dtstat_t));
         st->meth = dt->meth->type;
         st->size = dt->data->size;
-        st->space =
-            sizeof(Dtlist_t) + (dt->disc->link >= 0 ? 0 : dt->data->size * sizeof(Dthold_t));
+        st->space = sizeof(Dtlist_t) + ((Dtlist_t *)dt->data)->hidx.tblz * sizeof(Dthslot_t) +
+                    (dt->disc->link >= 0 ? 0 : dt->data->size * sizeof(Dthold_t));
     }
 
     return (void *)dt->data->size;
@@ -259,7 +260,8 @@ static_fn void *dtlist(Dt_t *dt, void *obj, int type) {
     }
 
     /* try to find a matching object */
-    if (h && _DTOBJ(disc, h) == obj && (type & (DT_START | DT_SEARCH | DT_NEXT | DT_PREV))) {
+    if (h && _DTOBJ(disc, h) == obj &&
+        (type & (DT_START | DT_SEARCH | DT_NEXT | DT_PREV | DT_DELETE | DT_DETACH | DT_REMOVE))) {
         r = h; /* match at the finger, no search needed */
     } else     /* linear search through the list */
     {
@@ -339,6 +341,84 @@ dt_return:
     return obj;
 }
 
+/*      Insertion ordered set (Dtiset).
+**      Objects are queued in the order they were first inserted so walks visit them in that
+**      order, and keys are unique as in Dtset. Once the set is large enough a hash index,
+**      keyed by the discipline hash, finds the link of an object in constant time. Searches,
+**      deletions and DT_NEXT/DT_PREV then put the list finger on that link instead of
+**      scanning the list.
+*/
+
+#define DTI_INSERT (DT_INSERT | DT_APPEND | DT_ATTACH | DT_INSTALL | DT_RELINK)
+#define DTI_KEYED \
+    (DTI_INSERT | DT_SEARCH | DT_MATCH | DT_NEXT | DT_PREV | DT_DELETE | DT_DETACH | DT_REMOVE)
+
+static_fn void *dtiset(Dt_t *dt, void *obj, int type) {
+    void *key, *o;
+    uint hsh = 0;
+    ssize_t s = -1;
+    Dtlink_t *l = NULL;
+    Dtdisc_t *disc = dt->disc;
+    Dtlist_t *list = (Dtlist_t *)dt->data;
+
+    if (!obj || !(type & DTI_KEYED)) {
+        o = dtlist(dt, obj, type);
+        if (type & (DT_CLEAR | DT_EXTRACT | DT_RESTORE)) _dthfree(dt, &list->hidx);
+        return o;
+    }
+
+    if (type & DT_RELINK) {
+        key = _DTKEY(disc, _DTOBJ(disc, (Dtlink_t *)obj));
+    } else if (type & DT_MATCH) {
+        key = obj;
+    } else {
+        key = _DTKEY(disc, obj);
+    }
+
+    if (list->hidx.htbl) {
+        hsh = _DTHSH(dt, key, disc);
+        s = _dthfind(dt, &list->hidx, key, hsh);
+        if ((l = list->hidx.htbl[s].link)) {
+            list->here = l;
+        } else {
+            s = -1;
+        }
+        if ((type & (DT_SEARCH | DT_MATCH)) && !(dt->data->type & (DT_SHARE | DT_ANNOUNCE))) {
+            return l ? _DTOBJ(disc, l) : NULL;
+        }
+    } else if (!(type & DTI_INSERT)) {
+        return dtlist(dt, obj, type); /* a short list is scanned */
+    } else if (dtlist(dt, key, DT_MATCH)) {
+        l = list->here;
+    }
+
+    if (type & (DT_SEARCH | DT_MATCH)) return dtlist(dt, obj, type);
+
+    if (l) {
+        if (!(type & (DT_NEXT | DT_PREV | DT_DELETE | DT_DETACH | DT_REMOVE | DT_INSTALL))) {
+            return _DTOBJ(disc, l); /* keys are unique */
+        }
+        if ((type & DT_REMOVE) && _DTOBJ(disc, l) != obj) return NULL;
+
+        /* the finger is on the object so the list need not look for it */
+        o = dtlist(dt, _DTOBJ(disc, l), (type & DT_INSTALL) ? DT_DELETE : type);
+        if (!o || (type & (DT_NEXT | DT_PREV))) return o;
+        if (s >= 0) _dthdelete(&list->hidx, s);
+        if (!(type & DT_INSTALL)) return o;
+    } else if (!(type & DTI_INSERT)) {
+        return NULL;
+    }
+
+    /* a new key goes at the end of the queue */
+    if (!(o = dtlist(dt, obj, type))) return NULL;
+    if (!list->hidx.htbl) {
+        if (dt->data->size >= DT_HMINSIZE) (void)_dthbuild(dt, &list->hidx, list->link);
+    } else {
+        _dthadd(dt, &list->hidx, list->here, hsh);
+    }
+    return o;
+}
+
 static_fn int dtlist_event(Dt_t *dt, int event, void *arg) {
     UNUSED(arg);
     Dtlist_t *list = (Dtlist_t *)dt->data;
@@ -356,6 +436,7 @@ static_fn int dtlist_event(Dt_t *dt, int event, void *arg) {
     } else if (event == DT_CLOSE) {
         if (!list) return 0;               // already closed
         if (list->link) (void)lclear(dt);  // remove all items
+        if (list->hidx.htbl) _dthfree(dt, &list->hidx);
         (void)(*dt->memoryf)(dt, (void *)list, 0, dt->disc);
         dt->data = NULL;
         return 0;
@@ -372,8 +453,11 @@ static Dtmethod_t _Dtstack = {
     .searchf = dtlist, .type = DT_STACK, .eventf = dtlist_event, .name = "Dtstack"};
 static Dtmethod_t _Dtqueue = {
     .searchf = dtlist, .type = DT_QUEUE, .eventf = dtlist_event, .name = "Dtqueue"};
+static Dtmethod_t _Dtiset = {
+    .searchf = dtiset, .type = DT_QUEUE, .eventf = dtlist_event, .name = "Dtiset"};
 
 Dtmethod_t *Dtlist = &_Dtlist;
 Dtmethod_t *Dtdeque = &_Dtdeque;
 Dtmethod_t *Dtstack = &_Dtstack;
 Dtmethod_t *Dtqueue = &_Dtqueue;
+Dtmethod_t *Dtiset = &_Dtiset;
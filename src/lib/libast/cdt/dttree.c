@@ -38,7 +38,8 @@
 
 typedef struct _dttree_s {
     Dtdata_t data;
-    Dtlink_t *root; /* tree root */
+    Dtlink_t *root;  /* tree root */
+    Dthindex_t hidx; /* Dtohset: hash index of the tree objects */
 } Dttree_t;
 
 #ifdef _BLD_DEBUG
@@ -213,7 +214,8 @@ static_fn void *dttree_stat(Dt_t *dt, Dtstat_t *st) {
     assert((dt->data->type & DT_SHARE) || size == dt->data->size);
     st->meth = dt->meth->type;
     st->size = size;
-    st->space = sizeof(Dttree_t) + (dt->disc->link >= 0 ? 0 : size * sizeof(Dthold_t));
+    st->space = sizeof(Dttree_t) + tree->hidx.tblz * sizeof(Dthslot_t) +
+                (dt->disc->link >= 0 ? 0 : size * sizeof(Dthold_t));
     return (void *)size;
 }
 
@@ -658,6 +660,77 @@ dt_return:
     return obj;
 }
 
+/*      Ordered set with a hash index (Dtohset).
+**      Objects live in the same splay tree as Dtoset so walks, DT_NEXT/DT_PREV and
+**      DT_ATLEAST/DT_ATMOST behave exactly as they do for Dtoset. Once the set is large
+**      enough a parallel open addressing table, keyed by the discipline hash of the object
+**      keys, answers DT_SEARCH and DT_MATCH in constant time without splaying the tree.
+*/
+
+#define DTOH_KEYED                                                                       \
+    (DT_SEARCH | DT_MATCH | DT_INSERT | DT_APPEND | DT_ATTACH | DT_INSTALL | DT_RELINK | \
+     DT_DELETE | DT_DETACH | DT_REMOVE)
+
+/* index every object of a tree that has grown large enough */
+static_fn void dtoh_build(Dt_t *dt) {
+    ssize_t size;
+    Dtlink_t *list, *l;
+    Dttree_t *tree = (Dttree_t *)dt->data;
+
+    /* flattening gives a linear walk; rebalance afterwards as DT_OPTIMIZE does */
+    list = (Dtlink_t *)dttree_list(dt, NULL, DT_FLATTEN);
+    (void)_dthbuild(dt, &tree->hidx, list);
+    for (size = 0, l = list; l; l = l->_rght) size += 1;
+    tree->root = dttree_balance(list, size);
+}
+
+static_fn void *dtohtree(Dt_t *dt, void *obj, int type) {
+    void *key, *o;
+    uint hsh = 0;
+    ssize_t s = -1;
+    Dtlink_t *l;
+    Dtdisc_t *disc = dt->disc;
+    Dttree_t *tree = (Dttree_t *)dt->data;
+
+    if (!obj || !(type & DTOH_KEYED)) {
+        o = dttree(dt, obj, type);
+        if (type & (DT_CLEAR | DT_EXTRACT)) _dthfree(dt, &tree->hidx);
+        return o;
+    }
+
+    if (tree->hidx.htbl) {
+        if (type & DT_RELINK) {
+            key = _DTKEY(disc, _DTOBJ(disc, (Dtlink_t *)obj));
+        } else if (type & DT_MATCH) {
+            key = obj;
+        } else {
+            key = _DTKEY(disc, obj);
+        }
+        hsh = _DTHSH(dt, key, disc);
+        s = _dthfind(dt, &tree->hidx, key, hsh);
+        l = tree->hidx.htbl[s].link;
+        if ((type & (DT_SEARCH | DT_MATCH)) && !(dt->data->type & (DT_SHARE | DT_ANNOUNCE))) {
+            return l ? _DTOBJ(disc, l) : NULL;
+        }
+        if (!l) s = -1;
+    }
+
+    /* the slot was located before the tree could free a deleted or replaced object */
+    o = dttree(dt, obj, type);
+    if (!o || (type & (DT_SEARCH | DT_MATCH))) return o;
+
+    if (type & (DT_DELETE | DT_DETACH | DT_REMOVE)) {
+        if (s >= 0) _dthdelete(&tree->hidx, s);
+    } else if (!tree->hidx.htbl) {
+        if (dt->data->size >= DT_HMINSIZE) dtoh_build(dt);
+    } else if (s >= 0) {
+        tree->hidx.htbl[s].link = tree->root; /* DT_INSTALL may have replaced the object */
+    } else {
+        _dthadd(dt, &tree->hidx, tree->root, hsh);
+    }
+    return o;
+}
+
 static_fn int dttree_event(Dt_t *dt, int event, void *arg) {
     UNUSED(arg);
     Dttree_t *tree = (Dttree_t *)dt->data;
@@ -676,6 +749,7 @@ static_fn int dttree_event(Dt_t *dt, int event, void *arg) {
     } else if (event == DT_CLOSE) {
         if (!tree) return 0;
         if (tree->root) (void)dttree_clear(dt);
+        if (tree->hidx.htbl) _dthfree(dt, &tree->hidx);
         (void)(*dt->memoryf)(dt, (void *)tree, 0, dt->disc);
         dt->data = NULL;
         return 0;
@@ -691,5 +765,8 @@ static Dtmethod_t _Dtoset = {
     .searchf = dttree, .type = DT_OSET, .eventf = dttree_event, .name = "Dtoset"};
 static Dtmethod_t _Dtobag = {
     .searchf = dttree, .type = DT_OBAG, .eventf = dttree_event, .name = "Dtobag"};
+static Dtmethod_t _Dtohset = {
+    .searchf = dtohtree, .type = DT_OSET, .eventf = dttree_event, .name = "Dtohset"};
 Dtmethod_t *Dtoset = &_Dtoset;
 Dtmethod_t *Dtobag = &_Dtobag;
+Dtmethod_t *Dtohset = &_Dtohset;
@@ -218,10 +218,12 @@ extern Dtmethod_t *Dtset;
 extern Dtmethod_t *Dtbag;
 extern Dtmethod_t *Dtoset;
 extern Dtmethod_t *Dtobag;
+extern Dtmethod_t *Dtohset;
 extern Dtmethod_t *Dtlist;
 extern Dtmethod_t *Dtstack;
 extern Dtmethod_t *Dtqueue;
 extern Dtmethod_t *Dtdeque;
+extern Dtmethod_t *Dtiset;
 extern Dtmethod_t *Dtrhset;
 extern Dtmethod_t *Dtrhbag;
 
@@ -47,6 +47,13 @@
 // 2GB just do an explicit cast to eliminate the lint.
 #define stktell(sp) (int)((sp)->next - (sp)->data)
 
+// Memory held by all the stacks of a process.
+typedef struct Stkstat_s {
+    size_t stacks;  // stacks currently open
+    size_t bytes;   // bytes in their headers and frames
+    size_t peak;    // most bytes ever held at once
+} Stkstat_t;
+
 extern Sfio_t _Stk_data;
 
 extern Stk_t *stkopen(int);
@@ -59,5 +66,7 @@ extern char *stkset(Stk_t *, char *, size_t);
 extern void *stkseek(Stk_t *, ssize_t);
 extern char *stkfreeze(Stk_t *, size_t);
 extern int stkon(Stk_t *, char *);
+extern const Stkstat_t *stkstat(void);
+extern size_t stksize(Stk_t *);
 
 #endif  // _STK_H
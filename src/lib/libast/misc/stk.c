@@ -103,10 +103,12 @@ struct stk {
     short stkflags;              // Stack attributes
     char *stkbase;               // Beginning of current stack frame
     char *stkend;                // End of current stack frame
+    size_t stkbytes;             // Size of the header and frames
 };
 
 static size_t init;         // 1 when initialized
 static struct stk *stkcur;  // pointer to current stk
+static Stkstat_t stkmem;    // memory held by all stacks
 static_fn char *stkgrow(Sfio_t *, size_t);
 
 #define stream2stk(stream) \
@@ -136,6 +138,15 @@ static struct {
 #define count(x, n)
 #endif  // STKSTATS
 
+// Bytes a frame holds, counting the alias list kept past its end.
+#define framesize(fp) ((size_t)((fp)->end - (char *)(fp)) + (fp)->nalias * sizeof(char *))
+
+static_fn void stkcount(struct stk *sp, ssize_t n) {
+    if (sp) sp->stkbytes += n;
+    stkmem.bytes += n;
+    if (stkmem.bytes > stkmem.peak) stkmem.peak = stkmem.bytes;
+}
+
 static const char Omsg[] = "malloc failed while growing stack\n";
 
 //
@@ -175,6 +186,7 @@ static_fn int stkexcept(Sfio_t *stream, int type, void *val, Sfdisc_t *dp) {
                 } else {
                     while (1) {
                         fp = (struct frame *)cp;
+                        stkcount(sp, -(ssize_t)framesize(fp));
                         if (fp->prev) {
                             cp = fp->prev;
                             free(fp);
@@ -189,6 +201,8 @@ static_fn int stkexcept(Sfio_t *stream, int type, void *val, Sfdisc_t *dp) {
         }
             return 0;
         case SF_FINAL:
+            stkmem.stacks--;
+            stkcount(NULL, -(ssize_t)(sizeof(Sfio_t) + sizeof(Sfdisc_t) + sizeof(struct stk)));
             free(stream);
             return 1;
         case SF_DPOP:
@@ -244,6 +258,8 @@ Sfio_t *stkopen(int flags) {
         free(stream);
         return NULL;
     }
+    stkmem.stacks++;
+    stkcount(sp, sizeof(*stream) + sizeof(*dp) + sizeof(*sp) + bsize);
     bsize -= sizeof(struct frame);
     count(addsize, sizeof(*fp) + bsize);
     cp = (char *)(fp + 1);
@@ -319,6 +335,16 @@ int stkon(Sfio_t *stream, char *loc) {
     return 0;
 }
 
+//
+// Return the memory held by all stacks
+//
+const Stkstat_t *stkstat(void) { return &stkmem; }
+
+//
+// Return the number of bytes held by the header and frames of <stream>
+//
+size_t stksize(Sfio_t *stream) { return stream2stk(stream)->stkbytes; }
+
 //
 // Reset the bottom of the current stack back to <loc>
 // If <loc> is not in this stack, then the stack is reset to the beginning
@@ -355,6 +381,7 @@ char *stkset(Sfio_t *stream, char *loc, size_t offset) {
         if (fp->prev) {
             sp->stkbase = fp->prev;
             sp->stkend = ((struct frame *)(fp->prev))->end;
+            stkcount(sp, -(ssize_t)framesize(fp));
             free(fp);
         } else {
             break;
@@ -468,6 +495,7 @@ static_fn char *stkgrow(Sfio_t *stream, size_t size) {
     char *end = NULL;
     int nn = 0;
     int add = 1;
+    size_t old = 0;
 
     n += (m + sizeof(struct frame) + 1);  // what is the purpose of the `+ 1`?
     n = roundof(n, STK_FSIZE);
@@ -478,6 +506,7 @@ static_fn char *stkgrow(Sfio_t *stream, size_t size) {
         end = fp->end;
         endoff = end - dp;
         sp->stkbase = ((struct frame *)dp)->prev;
+        old = framesize(fp);
     }
     cp = realloc(dp, n + nn * sizeof(char *));
     if (!cp && (!sp->stkoverflow || !(cp = (*sp->stkoverflow)(n)))) return 0;
@@ -497,6 +526,7 @@ static_fn char *stkgrow(Sfio_t *stream, size_t size) {
     cp = (char *)(fp + 1);
     cp = sp->stkbase + roundof((cp - sp->stkbase), STK_ALIGN);
     fp->nalias = nn;
+    stkcount(sp, (ssize_t)framesize(fp) - (ssize_t)old);
     if (fp->nalias) {
         fp->aliases = (char **)fp->end;
         if (end && nn > 1) memmove(fp->aliases, end, (nn - 1) * sizeof(char *));
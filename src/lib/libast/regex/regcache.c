@@ -26,48 +26,87 @@
 #include "config_ast.h"  // IWYU pragma: keep
 
 #include <locale.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "ast.h"
 #include "ast_regex.h"
 
-#define CACHE 8  /* default # cached re's       */
-#define ROUND 64 /* pattern buffer size round   */
+#define CACHE 256 /* default # cached re's       */
+#define ROUND 64  /* pattern buffer size round   */
 
-typedef unsigned long Key_t;
+/*
+ * entries are hashed on (pattern,reflags,locale) and kept
+ * on a list in order of use; the least recently used entry
+ * is recycled when the cache is full
+ */
 
 typedef struct Cache_s {
+    struct Cache_s *next;    /* hash chain                  */
+    struct Cache_s *lrunext; /* less recently used          */
+    struct Cache_s *lruprev; /* more recently used          */
     char *pattern;
+    char *locale;
     regex_t re;
-    unsigned long serial;
     regflags_t reflags;
-    int keep;
+    unsigned int hash;
     int size;
 } Cache_t;
 
 typedef struct State_s {
-    unsigned int size;
-    unsigned long serial;
-    char *locale;
-    Cache_t **cache;
+    unsigned int size;  /* max # cached re's           */
+    unsigned int count; /* # cached re's               */
+    unsigned int mask;  /* hash table size - 1         */
+    Cache_t **table;
+    Cache_t lru; /* lru.lrunext is the most recently used */
 } State_t;
 
 static State_t matchstate;
 
+static_fn void regex_unlink(Cache_t *cp) {
+    Cache_t **pp;
+
+    for (pp = &matchstate.table[cp->hash & matchstate.mask]; *pp != cp; pp = &(*pp)->next) {
+        ;  // empty loop
+    }
+    *pp = cp->next;
+    cp->lruprev->lrunext = cp->lrunext;
+    cp->lrunext->lruprev = cp->lruprev;
+}
+
 /*
- * flush the cache
+ * flush the cache and size it for n re's
  */
 
-static_fn void regex_flushcache(void) {
-    int i;
+static_fn int regex_flushcache(unsigned int n) {
+    Cache_t *cp;
+    unsigned int m;
 
-    for (i = matchstate.size; i--;) {
-        if (matchstate.cache[i] && matchstate.cache[i]->keep) {
-            matchstate.cache[i]->keep = 0;
-            regfree(&matchstate.cache[i]->re);
+    while ((cp = matchstate.lru.lruprev) && cp != &matchstate.lru) {
+        regex_unlink(cp);
+        regfree(&cp->re);
+        free(cp->pattern);
+        free(cp);
+    }
+    matchstate.count = 0;
+    matchstate.lru.lrunext = matchstate.lru.lruprev = &matchstate.lru;
+    if (n < matchstate.size) n = matchstate.size;
+    if (!n) n = CACHE;
+    if (n > matchstate.size || !matchstate.table) {
+        for (m = 16; m < n; m <<= 1) {
+            ;  // empty loop
         }
+        free(matchstate.table);
+        matchstate.table = calloc(m, sizeof(Cache_t *));
+        if (!matchstate.table) {
+            matchstate.size = matchstate.mask = 0;
+            return 1;
+        }
+        matchstate.size = n;
+        matchstate.mask = m - 1;
     }
+    return 0;
 }
 
 /*
@@ -76,110 +115,89 @@ static_fn void regex_flushcache(void) {
 
 regex_t *regcache(const char *pattern, regflags_t reflags, int *status) {
     Cache_t *cp;
+    const unsigned char *p;
+    char *locale;
+    unsigned int hash;
     int i;
-    char *s;
-    int empty;
-    int unused;
-    int old;
-    Key_t key;
 
     /*
      * 0 pattern flushes the cache and reflags>0 extends cache
      */
 
     if (!pattern) {
-        regex_flushcache();
-        i = 0;
-        if (reflags > matchstate.size) {
-            matchstate.cache = realloc(matchstate.cache, reflags * sizeof(Cache_t *));
-            if (matchstate.cache) {
-                matchstate.size = reflags;
-            } else {
-                matchstate.size = 0;
-                i = 1;
-            }
-        }
+        i = regex_flushcache(reflags);
         if (status) *status = i;
         return NULL;
     }
-    if (!matchstate.cache) {
-        matchstate.cache = calloc(1, CACHE * sizeof(Cache_t *));
-        if (!matchstate.cache) return NULL;
-        matchstate.size = CACHE;
+    if (!matchstate.table && regex_flushcache(CACHE)) {
+        if (status) *status = REG_ESPACE;
+        return NULL;
     }
 
     /*
-     * flush the cache if the locale changed
      * the ast setlocale() intercept maintains
      * persistent setlocale() return values
      */
 
-    if ((s = ast_setlocale(LC_CTYPE, NULL)) != matchstate.locale) {
-        matchstate.locale = s;
-        regex_flushcache();
-    }
+    locale = ast_setlocale(LC_CTYPE, NULL);
 
     /*
      * check if the pattern is in the cache
      */
 
-    for (i = 0; i < sizeof(key) && pattern[i]; i++) ((char *)&key)[i] = pattern[i];
-    for (; i < sizeof(key); i++) ((char *)&key)[i] = 0;
-    empty = unused = -1;
-    old = 0;
-    for (i = matchstate.size; i--;) {
-        if (!matchstate.cache[i]) {
-            empty = i;
-        } else if (!matchstate.cache[i]->keep) {
-            unused = i;
-        } else if (*(Key_t *)matchstate.cache[i]->pattern == key &&
-                   !strcmp(matchstate.cache[i]->pattern, pattern) &&
-                   matchstate.cache[i]->reflags == reflags) {
-            break;
-        } else if (!matchstate.cache[old] ||
-                   matchstate.cache[old]->serial > matchstate.cache[i]->serial) {
-            old = i;
-        }
-    }
-    if (i < 0) {
-        if (unused < 0) {
-            if (empty < 0) {
-                unused = old;
-            } else {
-                unused = empty;
+    hash = (unsigned int)reflags ^ (unsigned int)((uintptr_t)locale >> 4);
+    for (p = (const unsigned char *)pattern; *p; p++) hash = hash * 31 + *p;
+    for (cp = matchstate.table[hash & matchstate.mask]; cp; cp = cp->next) {
+        if (cp->hash == hash && cp->reflags == reflags && cp->locale == locale &&
+            !strcmp(cp->pattern, pattern)) {
+            if (cp != matchstate.lru.lrunext) {
+                cp->lruprev->lrunext = cp->lrunext;
+                cp->lrunext->lruprev = cp->lruprev;
+                goto use;
             }
+            if (status) *status = 0;
+            return &cp->re;
         }
-        if (!(cp = matchstate.cache[unused]) &&
-            !(cp = matchstate.cache[unused] = calloc(1, sizeof(Cache_t)))) {
+    }
+    if (matchstate.count < matchstate.size) {
+        if (!(cp = calloc(1, sizeof(Cache_t)))) {
             if (status) *status = REG_ESPACE;
             return NULL;
         }
-        if (cp->keep) {
-            cp->keep = 0;
-            regfree(&cp->re);
-        }
-        if ((i = strlen(pattern) + 1) > cp->size) {
-            cp->size = roundof(i, ROUND);
-            cp->pattern = realloc(cp->pattern, cp->size);
-            if (!cp->pattern) {
-                if (status) *status = REG_ESPACE;
-                return NULL;
-            }
-        }
-        strcpy(cp->pattern, pattern);
-        while (++i < sizeof(Key_t)) cp->pattern[i] = 0;
-        pattern = (const char *)cp->pattern;
-        i = regcomp(&cp->re, pattern, reflags);
-        if (i) {
-            if (status) *status = i;
-            return NULL;
-        }
-        cp->keep = 1;
-        cp->reflags = reflags;
+        matchstate.count++;
     } else {
-        cp = matchstate.cache[i];
+        cp = matchstate.lru.lruprev;
+        regex_unlink(cp);
+        regfree(&cp->re);
+    }
+    if ((i = strlen(pattern) + 1) > cp->size) {
+        char *s = realloc(cp->pattern, roundof(i, ROUND));
+        if (!s) {
+            i = REG_ESPACE;
+            goto bad;
+        }
+        cp->pattern = s;
+        cp->size = roundof(i, ROUND);
     }
-    cp->serial = ++matchstate.serial;
+    strcpy(cp->pattern, pattern);
+    i = regcomp(&cp->re, cp->pattern, reflags);
+    if (i) goto bad;
+    cp->reflags = reflags;
+    cp->locale = locale;
+    cp->hash = hash;
+    cp->next = matchstate.table[hash & matchstate.mask];
+    matchstate.table[hash & matchstate.mask] = cp;
+use:
+    cp->lrunext = matchstate.lru.lrunext;
+    cp->lruprev = &matchstate.lru;
+    cp->lrunext->lruprev = cp;
+    matchstate.lru.lrunext = cp;
     if (status) *status = 0;
     return &cp->re;
+bad:
+    free(cp->pattern);
+    free(cp);
+    matchstate.count--;
+    if (status) *status = i;
+    return NULL;
 }
@@ -816,6 +816,7 @@ extern Mbstate_t *_sfmbstate(Sfio_t *);
 extern Sfextern_t _Sfextern;
 
 extern int _sfmode(Sfio_t *, int, int);
+extern void _sfwrsync(void);
 extern int _sftype(const char *, int *, int *, int *);
 
 /* for portable encoding of double values */
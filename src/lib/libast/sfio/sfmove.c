@@ -21,10 +21,18 @@
  ***********************************************************************/
 #include "config_ast.h"  // IWYU pragma: keep
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+
+#if _lib_sendfile
+#include <sys/sendfile.h>
+#endif
 
 #include "sfhdr.h"  // IWYU pragma: keep
 #include "sfio.h"
@@ -38,6 +46,114 @@
 */
 #define MAX_SSIZE ((ssize_t)((~((size_t)0)) >> 1))
 
+/* ways to move data between two file descriptors inside the kernel */
+#define KMOVE_NONE 0     /* data must go through the stream buffers */
+#define KMOVE_COPY 1     /* copy_file_range() between regular files */
+#define KMOVE_SPLICE 2   /* splice() to or from a pipe */
+#define KMOVE_SENDFILE 3 /* sendfile() from a regular file */
+#define KMOVE_MAX (16 * 1024 * 1024)
+
+/* see if data can be moved by the kernel for a stream of this type: the
+** stream must be a plain descriptor whose disciplines, if any, neither do
+** the io nor seek. Only a write stream may be pooled as sfmove() makes it
+** the pool head and flushes its buffer first.
+*/
+static_fn int _sfkplain(Sfio_t *f, int type) {
+    Sfdisc_t *dc;
+
+    if (f->push || f->file < 0 || (f->flags & SF_STRING) || (f->bits & SF_NULL)) return 0;
+    for (dc = f->disc; dc; dc = dc->disc) {
+        if (dc->seekf || (type == SF_READ ? dc->readf != NULL : dc->writef != NULL)) return 0;
+    }
+    return type == SF_WRITE ? !(f->flags & SF_APPENDWR) : !f->pool || f->pool == &_Sfpool;
+}
+
+/* pick the system call for moving data from fr to fw */
+static_fn int _sfkmethod(Sfio_t *fr, Sfio_t *fw) {
+    struct stat rst, wst;
+
+    if (!_sfkplain(fr, SF_READ) || !_sfkplain(fw, SF_WRITE)) return KMOVE_NONE;
+    if (fstat(fr->file, &rst) < 0 || fstat(fw->file, &wst) < 0) return KMOVE_NONE;
+#if _lib_splice
+    if (S_ISFIFO(rst.st_mode) || S_ISFIFO(wst.st_mode)) return KMOVE_SPLICE;
+#endif
+    if (!S_ISREG(rst.st_mode)) return KMOVE_NONE;
+#if _lib_copy_file_range
+    if (S_ISREG(wst.st_mode)) return KMOVE_COPY;
+#endif
+#if _lib_sendfile
+    return KMOVE_SENDFILE;
+#else
+    return KMOVE_NONE;
+#endif
+}
+
+/*      Move up to n bytes from fr to fw without copying them to user space.
+**      Both stream buffers must be empty. Returns the number of bytes moved,
+**      0 on end of file, or -1 if the kernel refused and *how has been changed
+**      to the next method to try.
+*/
+static_fn ssize_t _sfkmove(Sfio_t *fr, Sfio_t *fw, size_t n, int *how) {
+    ssize_t r = -1;
+
+    /* make sure the file pointers are where the streams think they are */
+    if (fr->extent >= 0 && (fr->flags & SF_SHARE)) {
+        if (!(fr->flags & SF_PUBLIC)) {
+            fr->here = SFSK(fr, fr->here, SEEK_SET, fr->disc);
+        } else {
+            fr->here = SFSK(fr, (Sfoff_t)0, SEEK_CUR, fr->disc);
+        }
+    }
+    if (fw->extent >= 0 && (fw->flags & (SF_SHARE | SF_PUBLIC)) == SF_SHARE) {
+        fw->here = SFSK(fw, fw->here, SEEK_SET, fw->disc);
+    }
+
+    switch (*how) {
+#if _lib_copy_file_range
+        case KMOVE_COPY: {
+            r = copy_file_range(fr->file, NULL, fw->file, NULL, n, 0);
+            if (r < 0) {
+#if _lib_sendfile
+                *how = KMOVE_SENDFILE;
+#else
+                *how = KMOVE_NONE;
+#endif
+            }
+            break;
+        }
+#endif
+#if _lib_splice
+        case KMOVE_SPLICE: {
+            r = splice(fr->file, NULL, fw->file, NULL, n, SPLICE_F_MOVE);
+            if (r < 0) *how = KMOVE_NONE;
+            break;
+        }
+#endif
+#if _lib_sendfile
+        case KMOVE_SENDFILE: {
+            r = sendfile(fw->file, fr->file, NULL, n);
+            if (r < 0) *how = KMOVE_NONE;
+            break;
+        }
+#endif
+        default: {
+            break;
+        }
+    }
+
+    if (r > 0) {
+        fr->here += r;
+        if (fr->extent >= 0 && fr->extent < fr->here) fr->extent = fr->here;
+        if ((fw->flags & SF_PUBLIC) && fw->extent >= 0) {
+            fw->here = SFSK(fw, (Sfoff_t)0, SEEK_CUR, fw->disc);
+        } else {
+            fw->here += r;
+        }
+        if (fw->extent >= 0 && fw->here > fw->extent) fw->extent = fw->here;
+    }
+    return r;
+}
+
 Sfoff_t sfmove(Sfio_t *fr, Sfio_t *fw, Sfoff_t n, int rc) {
     uchar *cp, *next;
     ssize_t r, w;
@@ -46,12 +162,15 @@ Sfoff_t sfmove(Sfio_t *fr, Sfio_t *fw, Sfoff_t n, int rc) {
     Sfoff_t n_move, sk, cur;
     uchar *rbuf = NULL;
     ssize_t rsize = 0;
+    int kmove = KMOVE_NONE, dosync = 0;
     SFMTXDECL(fr)   // declare a shadow stream variable for from stream
     SFMTXDECL2(fw)  // declare a shadow stream variable for to stream
 
     SFMTXENTER(fr, (Sfoff_t)0)
     if (fw) SFMTXBEGIN2(fw, (Sfoff_t)0)
 
+    if (fw && rc < 0) kmove = _sfkmethod(fr, fw);
+
     for (n_move = 0; n != 0;) {
         if (rc >= 0) /* moving records, let sfgetr() deal with record reading */
         {
@@ -101,6 +220,33 @@ Sfoff_t sfmove(Sfio_t *fr, Sfio_t *fw, Sfoff_t n, int rc) {
             fr->bits |= SF_SEQUENTIAL; /* sequentially access data */
         }
 
+        /* let the kernel move the data if nothing is buffered in either stream */
+        while (kmove != KMOVE_NONE && fr->next >= fr->endb && !(fr->rsrv && fr->rsrv->slen < 0)) {
+            if (fw->next > fw->data && SFFLSBUF(fw, -1) < 0) {
+                kmove = KMOVE_NONE;
+                break;
+            }
+            if (!dosync && fr->extent < 0) { /* as sfrd() does, to prevent deadlock */
+                dosync = 1;
+                _sfwrsync();
+            }
+            w = n < 0 || n > KMOVE_MAX ? KMOVE_MAX : (ssize_t)n;
+            if (fr->disc && fr->disc->exceptf && (fr->flags & SF_IOCHECK)) {
+                /* warn that a read is about to happen, and let sfrd() deal with any answer */
+                SETLOCAL(fr);
+                if (_sfexcept(fr, SF_READ, w, fr->disc) != 0) {
+                    kmove = KMOVE_NONE;
+                    break;
+                }
+            }
+            if ((r = _sfkmove(fr, fw, (size_t)w, &kmove)) > 0) {
+                n_move += r;
+                if (n > 0) n -= r;
+                goto again;
+            }
+            if (r == 0) kmove = KMOVE_NONE; /* let the buffered code see the end of file */
+        }
+
         /* try reading a block of data */
         direct = 0;
         if (fr->rsrv && (r = -fr->rsrv->slen) > 0) {
@@ -38,7 +38,7 @@
 */
 
 /* synchronize unseekable write streams */
-static_fn void _sfwrsync(void) {
+void _sfwrsync(void) {
     Sfpool_t *p;
     Sfio_t *f;
     int n;
@@ -67,6 +67,84 @@ static struct State_s {
     int nmatch;
 } matchstate;
 
+/*
+ * pattern characters that always match themselves
+ */
+
+static const char litchars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 _-.,/:=";
+
+/*
+ * return the first occurrence of the m byte string p in the z bytes at b
+ */
+
+static_fn const char *litfind(const char *b, size_t z, const char *p, size_t m) {
+#if _lib_memmem
+    return memmem(b, z, p, m);
+#else
+    const char *e = b + z - m;
+
+    if (z < m) return NULL;
+    while ((b = memchr(b, *p, e - b + 1))) {
+        if (!memcmp(b, p, m)) return b;
+        if (b++ == e) break;
+    }
+    return NULL;
+#endif
+}
+
+/*
+ * match the patterns lit, lit*, *lit and *lit* without regex
+ * -1 returned if p has any other form
+ * otherwise 0 if no match or 1 with the match offsets in off[0] and off[1]
+ * the offsets are the ones the regex leftmost longest/shortest match would give
+ */
+
+static_fn int litmatch(const char *b, size_t z, const char *p, int flags, ssize_t *off) {
+    const char *q, *r;
+    size_t m;
+    int head, tail;
+
+    if (flags & STR_ICASE) return -1;
+    if ((head = *p == '*')) p++;
+    m = strspn(p, litchars);
+    if (!m || (p[m] && (p[m] != '*' || p[m + 1]))) return -1;
+    tail = p[m] == '*';
+    if (mbwide() && !ast.locale.is_utf8) return -1;
+    if (head && !tail && (flags & STR_RIGHT)) {
+        /* *lit anchored on the right */
+        if (z < m || memcmp(b + z - m, p, m)) return 0;
+        off[0] = 0;
+        off[1] = z;
+        return 1;
+    }
+    if (!head && (flags & (STR_LEFT | (tail ? 0 : STR_RIGHT)))) {
+        /* lit or lit* anchored on the left, lit anchored on the right */
+        if (z < m) return 0;
+        if (flags & STR_LEFT) {
+            if (memcmp(b, p, m) || (!tail && (flags & STR_RIGHT) && z != m)) return 0;
+            off[0] = 0;
+        } else {
+            if (memcmp(b + z - m, p, m)) return 0;
+            off[0] = z - m;
+        }
+        off[1] = (tail && (flags & (STR_RIGHT | STR_MAXIMAL))) ? z : off[0] + m;
+        return 1;
+    }
+    if (!(q = litfind(b, z, p, m))) return 0;
+    off[0] = head ? 0 : q - b;
+    if (tail && (flags & (STR_RIGHT | STR_MAXIMAL))) {
+        off[1] = z;
+    } else if (head && !tail && (flags & STR_MAXIMAL)) {
+        /* *lit matches up to the last occurrence */
+        while ((r = litfind(q + 1, z - (q + 1 - b), p, m))) q = r;
+        off[1] = q - b + m;
+    } else {
+        off[1] = q - b + m;
+    }
+    return 1;
+}
+
 /*
  * subgroup match
  * 0 returned if no match
@@ -104,6 +182,30 @@ int strngrpmatch(const char *b, size_t z, const char *p, ssize_t *sub, int n, in
         return *b == 0;
     }
 
+    /*
+     * simple patterns do not need regex
+     */
+
+    if (!(flags & REG_ADVANCE)) {
+        ssize_t off[2];
+
+        i = litmatch(b, z, p, flags, off);
+        if (i >= 0) {
+            if (i && sub && n > 0) {
+                if (flags & STR_INT) {
+                    int *subi = (int *)sub;
+
+                    subi[0] = off[0];
+                    subi[1] = off[1];
+                } else {
+                    sub[0] = off[0];
+                    sub[1] = off[1];
+                }
+            }
+            return i;
+        }
+    }
+
     /*
      * convert flags
      */
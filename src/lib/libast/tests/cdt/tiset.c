@@ -0,0 +1,112 @@
+/***********************************************************************
+ *                                                                      *
+ *               This software is part of the ast package               *
+ *          Copyright (c) 1999-2011 AT&T Intellectual Property          *
+ *                      and is licensed under the                       *
+ *                 Eclipse Public License, Version 1.0                  *
+ *                    by AT&T Intellectual Property                     *
+ *                                                                      *
+ *                A copy of the License is available at                 *
+ *          http://www.eclipse.org/org/documents/epl-v10.html           *
+ *         (with md5 checksum b35adb5213ca9657e911e9befb180842)         *
+ *                                                                      *
+ *              Information and Software Systems Research               *
+ *                            AT&T Research                             *
+ *                           Florham Park NJ                            *
+ *                                                                      *
+ *               Glenn Fowler <glenn.s.fowler@gmail.com>                *
+ *                                                                      *
+ ***********************************************************************/
+#include "config_ast.h"  // IWYU pragma: keep
+
+#include "cdt.h"
+#include "dttest.h"
+#include "terror.h"
+
+Dtdisc_t Disc = {0, sizeof(long), -1, newint, NULL, compare, hashint, NULL, NULL};
+
+// Large enough that the hash index is built and grown several times.
+#define N_OBJ 5000
+
+// The k'th object inserted. 7919 is prime so this is a permutation of 1..N_OBJ.
+#define NTH(k) (((k)*7919) % N_OBJ + 1)
+
+tmain() {
+    UNUSED(argc);
+    UNUSED(argv);
+    Dt_t *dt, *view;
+    long i, k;
+
+    if (!(dt = dtopen(&Disc, Dtiset))) terror("Opening Dtiset");
+
+    for (i = 0; i < N_OBJ; ++i) {
+        k = NTH(i);
+        if ((long)dtinsert(dt, k) != k) terror("Insert %ld", k);
+    }
+    if (dtsize(dt) != N_OBJ) terror("Dtiset size %ld", (long)dtsize(dt));
+    if ((long)dtinsert(dt, 7L) != 7) terror("Insert 7 twice");
+    if ((long)dtappend(dt, 7L) != 7) terror("Append 7 twice");
+    if (dtsize(dt) != N_OBJ) terror("Dtiset size after duplicate insert");
+
+    for (i = 1; i <= N_OBJ; ++i) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtiset search %ld", i);
+        if ((long)dtmatch(dt, i) != i) terror("Dtiset match %ld", i);
+    }
+    if (dtsearch(dt, 0L) || dtsearch(dt, N_OBJ + 1L)) terror("Found a missing object");
+
+    // Walks visit the objects in the order they were inserted.
+    for (i = (long)dtfirst(dt), k = 0; i; i = (long)dtnext(dt, i), k += 1) {
+        if (i != NTH(k)) terror("Dtiset walk got %ld expected %ld", i, NTH(k));
+    }
+    if (k != N_OBJ) terror("Dtiset walk length");
+    for (i = (long)dtlast(dt), k = N_OBJ - 1; i; i = (long)dtprev(dt, i), k -= 1) {
+        if (i != NTH(k)) terror("Dtiset backwalk got %ld expected %ld", i, NTH(k));
+    }
+    if ((long)dtnext(dt, NTH(10)) != NTH(11)) terror("Dtiset next of a searched object");
+
+    // Delete the even numbers so the index has to close the holes in its probe sequences.
+    for (i = 2; i <= N_OBJ; i += 2) {
+        if ((long)dtdelete(dt, i) != i) terror("Delete %ld", i);
+    }
+    if (dtsize(dt) != N_OBJ / 2) terror("Dtiset size after delete");
+    for (i = 1; i <= N_OBJ; ++i) {
+        k = (long)dtsearch(dt, i);
+        if (i % 2 ? k != i : k != 0) terror("Dtiset search %ld after delete", i);
+    }
+    for (i = (long)dtfirst(dt), k = 0; i; i = (long)dtnext(dt, i), k += 1) {
+        while (NTH(k) % 2 == 0) k += 1;
+        if (i != NTH(k)) terror("Dtiset walk after delete got %ld expected %ld", i, NTH(k));
+    }
+
+    // A key inserted again after being deleted goes at the end; so does an installed one.
+    if ((long)dtinsert(dt, 2L) != 2) terror("Insert 2 after delete");
+    if ((long)dtlast(dt) != 2) terror("Reinserted object should be last");
+    if ((long)dtinstall(dt, NTH(0)) != NTH(0)) terror("Install %ld", NTH(0));
+    if ((long)dtlast(dt) != NTH(0)) terror("Installed object should be last");
+    for (k = 1; NTH(k) % 2 == 0; ++k) {
+        ;  // empty loop
+    }
+    if ((long)dtfirst(dt) != NTH(k)) terror("Install should have removed the old object");
+    if (dtsize(dt) != N_OBJ / 2 + 1) terror("Dtiset size after install");
+
+    // Viewpathing requires both dictionaries to use the same method.
+    if (!(view = dtopen(&Disc, Dtiset))) terror("Opening Dtiset view");
+    for (i = 2; i <= N_OBJ; i += 2) dtinsert(view, i);
+    if (!dtview(dt, view)) terror("Viewing Dtiset");
+    for (i = 1; i <= N_OBJ; ++i) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtiset view search %ld", i);
+    }
+    for (i = (long)dtfirst(dt), k = 0; i; i = (long)dtnext(dt, i)) k += 1;
+    if (k != N_OBJ) terror("Dtiset view walk length %ld", k);
+    dtview(dt, NULL);
+
+    dtclear(dt);
+    if (dtsize(dt) != 0) terror("Dtiset size after clear");
+    if (dtsearch(dt, 1L)) terror("Found object after clear");
+    if ((long)dtinsert(dt, 1L) != 1) terror("Insert after clear");
+    if ((long)dtsearch(dt, 1L) != 1) terror("Search after clear");
+
+    dtclose(view);
+    dtclose(dt);
+    texit(0);
+}
@@ -0,0 +1,118 @@
+/***********************************************************************
+ *                                                                      *
+ *               This software is part of the ast package               *
+ *          Copyright (c) 1999-2011 AT&T Intellectual Property          *
+ *                      and is licensed under the                       *
+ *                 Eclipse Public License, Version 1.0                  *
+ *                    by AT&T Intellectual Property                     *
+ *                                                                      *
+ *                A copy of the License is available at                 *
+ *          http://www.eclipse.org/org/documents/epl-v10.html           *
+ *         (with md5 checksum b35adb5213ca9657e911e9befb180842)         *
+ *                                                                      *
+ *              Information and Software Systems Research               *
+ *                            AT&T Research                             *
+ *                           Florham Park NJ                            *
+ *                                                                      *
+ *               Glenn Fowler <glenn.s.fowler@gmail.com>                *
+ *                                                                      *
+ ***********************************************************************/
+#include "config_ast.h"  // IWYU pragma: keep
+
+#include "cdt.h"
+#include "dttest.h"
+#include "terror.h"
+
+Dtdisc_t Disc = {0, sizeof(long), -1, newint, NULL, compare, hashint, NULL, NULL};
+
+// Large enough that the hash index is built, grown and shrunk several times.
+#define N_OBJ 5000
+
+tmain() {
+    UNUSED(argc);
+    UNUSED(argv);
+    Dt_t *dt, *view;
+    Dtlink_t *link;
+    long i, k;
+
+    if (!(dt = dtopen(&Disc, Dtohset))) terror("Opening Dtohset");
+
+    // Insert in a scrambled order. 7919 is prime so this is a permutation of 1..N_OBJ.
+    for (i = 0; i < N_OBJ; ++i) {
+        k = (i * 7919) % N_OBJ + 1;
+        if ((long)dtinsert(dt, k) != k) terror("Insert %ld", k);
+    }
+    if (dtsize(dt) != N_OBJ) terror("Dtohset size %ld", (long)dtsize(dt));
+    if ((long)dtinsert(dt, 7L) != 7) terror("Insert 7 twice");
+    if (dtsize(dt) != N_OBJ) terror("Dtohset size after duplicate insert");
+
+    for (i = 1; i <= N_OBJ; ++i) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtohset search %ld", i);
+        if ((long)dtmatch(dt, i) != i) terror("Dtohset match %ld", i);
+    }
+    if (dtsearch(dt, 0L) || dtsearch(dt, N_OBJ + 1L)) terror("Found a missing object");
+
+    // The tree must still be walked in order.
+    for (i = (long)dtfirst(dt), k = 1; i; i = (long)dtnext(dt, i), k += 1) {
+        if (i != k) terror("Dtohset walk got %ld expected %ld", i, k);
+    }
+    if (k != N_OBJ + 1) terror("Dtohset walk length");
+    for (i = (long)dtlast(dt), k = N_OBJ; i; i = (long)dtprev(dt, i), k -= 1) {
+        if (i != k) terror("Dtohset backwalk got %ld expected %ld", i, k);
+    }
+
+    // Delete the even numbers so the index has to close the holes in its probe sequences.
+    for (i = 2; i <= N_OBJ; i += 2) {
+        if ((long)dtdelete(dt, i) != i) terror("Delete %ld", i);
+    }
+    if (dtsize(dt) != N_OBJ / 2) terror("Dtohset size after delete");
+    for (i = 1; i <= N_OBJ; ++i) {
+        k = (long)dtsearch(dt, i);
+        if (i % 2 ? k != i : k != 0) terror("Dtohset search %ld after delete", i);
+    }
+    if ((long)dtatleast(dt, 10L) != 11) terror("Should have found 11");
+    if ((long)dtatmost(dt, 10L) != 9) terror("Should have found 9");
+
+    if ((long)dtinstall(dt, 11L) != 11) terror("Install 11");
+    if ((long)dtsearch(dt, 11L) != 11) terror("Search after install");
+
+    if (!(link = dtextract(dt))) terror("Fail extracting Dtohset");
+    if (dtsearch(dt, 1L)) terror("Found object after extract");
+    if (!dtrestore(dt, link)) terror("Fail restoring Dtohset");
+    if (dtsize(dt) != N_OBJ / 2) terror("Dtohset size after restore");
+    for (i = 1; i <= N_OBJ; i += 2) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtohset search %ld after restore", i);
+    }
+
+    // Switch to a plain tree and back again.
+    dtmethod(dt, Dtoset);
+    for (i = 1; i <= N_OBJ; i += 2) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtoset search %ld", i);
+    }
+    dtmethod(dt, Dtohset);
+    for (i = 1; i <= N_OBJ; i += 2) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtohset search %ld after method change", i);
+    }
+
+    // Viewpathing requires both dictionaries to use the same method.
+    if (!(view = dtopen(&Disc, Dtohset))) terror("Opening Dtohset view");
+    for (i = 2; i <= N_OBJ; i += 2) dtinsert(view, i);
+    if (!dtview(dt, view)) terror("Viewing Dtohset");
+    for (i = 1; i <= N_OBJ; ++i) {
+        if ((long)dtsearch(dt, i) != i) terror("Dtohset view search %ld", i);
+    }
+    for (i = (long)dtfirst(dt), k = 1; i; i = (long)dtnext(dt, i), k += 1) {
+        if (i != k) terror("Dtohset view walk got %ld expected %ld", i, k);
+    }
+    dtview(dt, NULL);
+
+    dtclear(dt);
+    if (dtsize(dt) != 0) terror("Dtohset size after clear");
+    if (dtsearch(dt, 1L)) terror("Found object after clear");
+    if ((long)dtinsert(dt, 1L) != 1) terror("Insert after clear");
+    if ((long)dtsearch(dt, 1L) != 1) terror("Search after clear");
+
+    dtclose(view);
+    dtclose(dt);
+    texit(0);
+}
@@ -0,0 +1,76 @@
+#include "config_ast.h"  // IWYU pragma: keep
+
+#include <string.h>
+#include <unistd.h>
+
+#include "sfio.h"
+#include "terror.h"
+
+#define SIZE 100000
+
+// Moving data between plain descriptors may be done by the kernel. The streams must end up where
+// they would have been had the data gone through their buffers.
+tmain() {
+    UNUSED(argc);
+    UNUSED(argv);
+    static char data[SIZE], buf[SIZE];
+    int fd[2];
+    Sfio_t *fr, *fw;
+    Sfoff_t n;
+    int i;
+
+    for (i = 0; i < SIZE; ++i) data[i] = 'a' + i % 26;
+    if (!(fw = sfopen(NULL, tstfile("sf", 0), "w"))) terror("Can't open for write");
+    if (sfwrite(fw, data, SIZE) != SIZE) terror("Writing data");
+    sfclose(fw);
+
+    // Data already buffered in both streams is moved first.
+    if (!(fr = sfopen(NULL, tstfile("sf", 0), "r"))) terror("Can't open for read");
+    if (!(fw = sfopen(NULL, tstfile("sf", 1), "w"))) terror("Can't open for write");
+    if (sfread(fr, buf, 10) != 10 || memcmp(buf, data, 10)) terror("Reading head");
+    if (sfwrite(fw, data, 10) != 10) terror("Writing head");
+    if ((n = sfmove(fr, fw, (Sfoff_t)SF_UNBOUND, -1)) != SIZE - 10) terror("Moved %lld", n);
+    if (!sfeof(fr)) terror("Input is not at eof");
+    if (sferror(fr) || sferror(fw)) terror("Stream error");
+    if (sftell(fw) != SIZE) terror("Output is at %lld", sftell(fw));
+    sfclose(fw);
+    sfclose(fr);
+    if (!(fr = sfopen(NULL, tstfile("sf", 1), "r"))) terror("Can't open for read");
+    if (sfread(fr, buf, SIZE) != SIZE || memcmp(buf, data, SIZE)) terror("Wrong data moved");
+    sfclose(fr);
+
+    // A bounded move leaves the input positioned after the data moved.
+    if (!(fr = sfopen(NULL, tstfile("sf", 0), "r"))) terror("Can't open for read");
+    if (!(fw = sfopen(NULL, tstfile("sf", 1), "w"))) terror("Can't open for write");
+    if ((n = sfmove(fr, fw, (Sfoff_t)5000, -1)) != 5000) terror("Moved %lld", n);
+    if (sftell(fr) != 5000) terror("Input is at %lld", sftell(fr));
+    if (sfread(fr, buf, 10) != 10 || memcmp(buf, data + 5000, 10)) terror("Reading tail");
+    sfclose(fw);
+
+    // From a file into a pipe.
+    if (pipe(fd) < 0) terror("Can't open pipe");
+    if (!(fw = sfnew(NULL, NULL, (size_t)SF_UNBOUND, fd[1], SF_WRITE))) terror("Can't open pipe");
+    sfseek(fr, (Sfoff_t)0, SEEK_SET);
+    if ((n = sfmove(fr, fw, (Sfoff_t)4000, -1)) != 4000) terror("Moved %lld to pipe", n);
+    sfclose(fw);
+    if (read(fd[0], buf, SIZE) != 4000 || memcmp(buf, data, 4000)) terror("Wrong data in pipe");
+    close(fd[0]);
+    sfclose(fr);
+
+    // From a pipe into a file.
+    if (pipe(fd) < 0) terror("Can't open pipe");
+    if (write(fd[1], data, 4000) != 4000) terror("Writing to pipe");
+    close(fd[1]);
+    if (!(fr = sfnew(NULL, NULL, (size_t)SF_UNBOUND, fd[0], SF_READ))) terror("Can't open pipe");
+    if (!(fw = sfopen(NULL, tstfile("sf", 1), "w"))) terror("Can't open for write");
+    if ((n = sfmove(fr, fw, (Sfoff_t)SF_UNBOUND, -1)) != 4000) terror("Moved %lld from pipe", n);
+    if (!sfeof(fr)) terror("Pipe is not at eof");
+    if (sftell(fw) != 4000) terror("Output is at %lld", sftell(fw));
+    sfclose(fw);
+    sfclose(fr);
+    if (!(fr = sfopen(NULL, tstfile("sf", 1), "r"))) terror("Can't open for read");
+    if (sfread(fr, buf, SIZE) != 4000 || memcmp(buf, data, 4000)) terror("Wrong data from pipe");
+    sfclose(fr);
+
+    texit(0);
+}
@@ -1,8 +1,10 @@
 #include "config_ast.h"  // IWYU pragma: keep
 
+#include <stdio.h>
 #include <string.h>
 
 #include "ast.h"
+#include "ast_regex.h"
 #include "terror.h"
 
 struct ShellPatternMatch {
@@ -69,12 +71,80 @@ void test_unmatching_patterns() {
     }
 }
 
+// Literal, prefix, suffix and infix patterns, which are matched without regex.
+void test_simple_patterns() {
+    struct {
+        const char *input;
+        const char *pattern;
+        int flags;
+        ssize_t start, end;
+    } tests[] = {{"xfooyfooz", "foo", 0, 1, 4},
+                 {"xfooyfooz", "foo", STR_LEFT, -1, -1},
+                 {"fooyfooz", "foo", STR_LEFT, 0, 3},
+                 {"xfooyfoo", "foo", STR_RIGHT, 5, 8},
+                 {"foo", "foo", STR_LEFT | STR_RIGHT, 0, 3},
+                 {"foox", "foo", STR_LEFT | STR_RIGHT, -1, -1},
+                 {"xfooyfooz", "foo*", 0, 1, 4},
+                 {"xfooyfooz", "foo*", STR_MAXIMAL, 1, 9},
+                 {"fooyfooz", "foo*", STR_LEFT, 0, 3},
+                 {"fooyfooz", "foo*", STR_LEFT | STR_RIGHT, 0, 8},
+                 {"xfooyfooz", "*foo", 0, 0, 4},
+                 {"xfooyfooz", "*foo", STR_MAXIMAL, 0, 8},
+                 {"xfooyfooz", "*foo", STR_LEFT, 0, 4},
+                 {"xfooyfooz", "*foo", STR_RIGHT, -1, -1},
+                 {"xfooyfoo", "*foo", STR_RIGHT, 0, 8},
+                 {"xfooyfooz", "*foo*", 0, 0, 4},
+                 {"xfooyfooz", "*foo*", STR_MAXIMAL, 0, 9},
+                 {"xfooyfooz", "*foo*", STR_LEFT | STR_RIGHT, 0, 9},
+                 {"xfoyfoz", "*foo*", STR_LEFT | STR_RIGHT, -1, -1},
+                 {NULL, NULL, 0, 0, 0}};
+    ssize_t sub[2];
+
+    for (int i = 0; tests[i].input; ++i) {
+        int n = strgrpmatch(tests[i].input, tests[i].pattern, sub, 1, tests[i].flags);
+        if (n != (tests[i].start >= 0) ||
+            (n && (sub[0] != tests[i].start || sub[1] != tests[i].end))) {
+            terror("strgrpmatch() failed :: '%s' matched against '%s' with flags %#x gave %d "
+                   "[%zd,%zd] instead of [%zd,%zd]",
+                   tests[i].input, tests[i].pattern, tests[i].flags, n, n ? sub[0] : -1,
+                   n ? sub[1] : -1, tests[i].start, tests[i].end);
+        }
+    }
+}
+
+// More patterns than the regcache() default capacity, each matched more than once.
+void test_many_patterns() {
+    char pattern[32], input[32];
+
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int i = 0; i < 1000; ++i) {
+            snprintf(pattern, sizeof(pattern), "*[a-z]%d", i);
+            snprintf(input, sizeof(input), "x%d", i);
+            if (!strmatch(input, pattern)) {
+                terror("strmatch() failed :: '%s' failed to match shell pattern '%s'", input,
+                       pattern);
+            }
+            snprintf(input, sizeof(input), "x%d", i + 1);
+            if (strmatch(input, pattern)) {
+                terror("strmatch() failed :: '%s' matches unmatching shell pattern '%s'", input,
+                       pattern);
+            }
+        }
+        // Flush the cache between passes, and make it larger than the set of patterns once.
+        regcache(NULL, pass == 0 ? 2000 : 0, NULL);
+    }
+    if (strmatch("abc", "a[")) terror("strmatch() failed :: invalid pattern 'a[' matches");
+    if (!strmatch("abc", "a*")) terror("strmatch() failed :: 'abc' failed to match 'a*'");
+}
+
 tmain() {
     UNUSED(argc);
     UNUSED(argv);
 
     test_matching_patterns();
     test_unmatching_patterns();
+    test_simple_patterns();
+    test_many_patterns();
 
     texit(0);
 }
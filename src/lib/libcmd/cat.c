@@ -28,7 +28,11 @@
 #include "config_ast.h"  // IWYU pragma: keep
 
 #include <errno.h>
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -105,6 +109,62 @@ static char *stdin_argv[] = {"-", NULL};
 
 #define printof(c) ((c) ^ 0100)
 
+/*
+ * return the first byte at or after cp with a state; the sentinel at end always has one
+ * range[0] and range[1] bound the bytes other than newline that may have a state: those
+ * below the first and those from the second up
+ */
+
+static unsigned char *vscan(const char *states, unsigned char *cp, unsigned char *end,
+                            const unsigned char *range) {
+#if defined(__GNUC__) && defined(__SSE2__)
+    if (end - cp >= (ptrdiff_t)sizeof(__m128i)) {
+        const __m128i lo = _mm_set1_epi8((char)(range[0] - 1));
+        const __m128i hi = _mm_set1_epi8((char)range[1]);
+        const __m128i nl = _mm_set1_epi8('\n');
+        __m128i v;
+        unsigned int m;
+
+        do {
+            v = _mm_loadu_si128((const __m128i *)cp);
+            m = _mm_movemask_epi8(_mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, lo), v),
+                             _mm_cmpeq_epi8(_mm_max_epu8(v, hi), v)),
+                _mm_cmpeq_epi8(v, nl)));
+            for (; m; m &= m - 1) {
+                if (states[cp[__builtin_ctz(m)]]) return cp + __builtin_ctz(m);
+            }
+            cp += sizeof(v);
+        } while (end - cp >= (ptrdiff_t)sizeof(v));
+    }
+#else
+    UNUSED(end);
+    UNUSED(range);
+#endif
+    while (!states[*cp]) cp++;
+    return cp;
+}
+
+/*
+ * output line number as sfprintf(op, "%6d\t", line) would
+ */
+
+static void vnumber(Sfio_t *op, int line) {
+    char buf[3 * sizeof(line) + 2];
+    char *s = buf + sizeof(buf);
+
+    if (line < 0) {
+        sfprintf(op, "%6d\t", line);
+        return;
+    }
+    *--s = '\t';
+    do {
+        *--s = '0' + line % 10;
+    } while (line /= 10);
+    while (s > buf + sizeof(buf) - 7) *--s = ' ';
+    sfwrite(op, s, buf + sizeof(buf) - s);
+}
+
 /*
  * called for any special output processing
  */
@@ -127,7 +187,16 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
 
     unsigned char meta[3];
     unsigned char tmp[32];
+    unsigned char range[2];
 
+    range[0] = 1;
+    range[1] = UCHAR_MAX;
+    for (c = 1; c < ' '; c++) {
+        if (states[c] && c != '\n') range[0] = c + 1;
+    }
+    for (c = UCHAR_MAX; c >= ' '; c--) {
+        if (states[c]) range[1] = c;
+    }
     meta[0] = 'M';
     last = -1;
     *(cp = buf = end = tmp) = 0;
@@ -139,14 +208,12 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
     for (;;) {
         cur = cp;
         if (raw) {
-            while (!(n = states[*cp++])) {
-                ;
-            }
+            cp = vscan(states, cp, end, range);
+            n = states[*cp++];
         } else {
             for (;;) {
-                while (!(n = states[*cp++])) {
-                    ;
-                }
+                cp = vscan(states, cp, end, range);
+                n = states[*cp++];
                 if (n < T_CONTROL) break;
                 pp = cp - 1;
                 m = mblen((char *)pp, MB_LEN_MAX);
@@ -164,7 +231,7 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
                                 any = 1;
                                 if (header) {
                                     header = 0;
-                                    sfprintf(op, "%6d\t", line);
+                                    vnumber(op, line);
                                 }
                                 sfwrite(op, cur, m);
                                 *(cp = cur = end) = 0;
@@ -194,7 +261,7 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
                                     any = 1;
                                     if (header) {
                                         header = 0;
-                                        sfprintf(op, "%6d\t", line);
+                                        vnumber(op, line);
                                     }
                                     sfwrite(op, tmp, m);
                                     cur = cp += m - c;
@@ -217,7 +284,7 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
             any = 1;
             if (header) {
                 header = 0;
-                sfprintf(op, "%6d\t", line);
+                vnumber(op, line);
             }
             if (m) sfwrite(op, cur, m);
         }
@@ -295,7 +362,7 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
                 } while (states[c = *++cp] == T_EIGHTBIT && raw);
                 break;
             case T_NEWLINE:
-                if (header && !(flags & B_FLAG)) sfprintf(op, "%6d\t", line);
+                if (header && !(flags & B_FLAG)) vnumber(op, line);
                 if (flags & E_FLAG) sfputc(op, '$');
                 sfputc(op, '\n');
                 if (!header || !(flags & B_FLAG)) line++;
@@ -328,7 +395,7 @@ static int vcat(char *states, Sfio_t *ip, Sfio_t *op, int flags) {
                     if (!(flags & S_FLAG) || any || header) {
                         any = 0;
                         header = 0;
-                        if ((flags & (B_FLAG | N_FLAG)) == N_FLAG) sfprintf(op, "%6d\t", line);
+                        if ((flags & (B_FLAG | N_FLAG)) == N_FLAG) vnumber(op, line);
                         if (flags & E_FLAG) sfputc(op, '$');
                         sfputc(op, '\n');
                     }
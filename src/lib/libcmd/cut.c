@@ -29,10 +29,23 @@
 #include <ctype.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 
+#if _hdr_pthread
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "ast.h"
 #include "error.h"
 #include "option.h"
@@ -101,6 +114,7 @@ typedef struct Cut_s {
     int sflag;
     int nlflag;
     int reclen;
+    int par; /* fields may be cut on several threads */
     Delim_t wdelim;
     Delim_t ldelim;
     unsigned char space[UCHAR_MAX + 1];
@@ -156,6 +170,8 @@ static Cut_t *cutinit(int mode, char *str, Delim_t *wdelim, Delim_t *ldelim, siz
     cut->sflag = (mode & C_SUPRESS) != 0;
     cut->nlflag = (mode & C_NONEWLINE) != 0;
     cut->reclen = reclen;
+    cut->par = (mode & C_FIELDS) && wdelim->len == 1 && ldelim->len == 1 && ldelim->chr == '\n' &&
+               wdelim->chr != '\n' && (!cut->mb || (ast.locale.is_utf8 && wdelim->chr < 0x80));
     lp = cut->list;
     for (;;) {
         switch (c = *cp++) {
@@ -519,6 +535,246 @@ failed:
     if (fdtmp) sfclose(fdtmp);
 }
 
+#if _hdr_pthread
+
+#define PAR_MIN (4 * 1024 * 1024) /* smallest input cut in parallel */
+#define PAR_CHUNK (1024 * 1024)   /* input bytes per chunk */
+#define PAR_MAX 32                /* most worker threads */
+#define PAR_AHEAD 4               /* chunks per worker cut ahead of the output */
+
+typedef struct Chunk_s {
+    const unsigned char *beg;
+    const unsigned char *end;
+    char *out;
+    size_t len;
+    int done;
+} Chunk_t;
+
+typedef struct Par_s {
+    Cut_t *cut;
+    Chunk_t *chunks;
+    size_t nchunks;
+    size_t next;    /* next chunk for a worker */
+    size_t written; /* chunks written so far */
+    size_t ahead;
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Par_t;
+
+/*
+ * return the first delimiter <d> or newline at or after cp, there is a newline before ep
+ */
+
+static const unsigned char *cutscan(const unsigned char *cp, const unsigned char *ep, int d) {
+#if defined(__GNUC__) && defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i dl = _mm_set1_epi8((char)d);
+    __m128i v;
+    unsigned int m;
+
+    for (; ep - cp >= (ptrdiff_t)sizeof(v); cp += sizeof(v)) {
+        v = _mm_loadu_si128((const __m128i *)cp);
+        m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, dl)));
+        if (m) return cp + __builtin_ctz(m);
+    }
+#else
+    UNUSED(ep);
+#endif
+    while (*cp != '\n' && *cp != d) cp++;
+    return cp;
+}
+
+/*
+ * cut the newline terminated lines from beg to end into out as cutfields() would
+ * return the number of bytes in out, which never exceeds end - beg
+ */
+
+static size_t cutchunk(Cut_t *cut, const unsigned char *beg, const unsigned char *end, char *out) {
+    const unsigned char *cp = beg;
+    const unsigned char *first;
+    const unsigned char *copy;
+    const unsigned char *wp;
+    const int *lp;
+    char *op = out;
+    int nfields, nodelim, empty;
+    int d = cut->wdelim.chr;
+
+    while (cp < end) {
+        first = cp;
+        nodelim = empty = 1;
+        copy = cp;
+        nfields = *(lp = cut->list);
+        if (nfields) {
+            copy = 0;
+        } else {
+            nfields = *++lp;
+        }
+        for (;;) {
+            /* the delimiters after the last field selected do not matter */
+            if (*lp == HUGE) {
+                cp = memchr(cp, '\n', end - cp);
+            } else {
+                cp = cutscan(cp, end, d);
+            }
+            wp = cp++;
+            if (*wp == '\n') break;
+            nodelim = 0;
+            if (--nfields > 0) continue;
+            nfields = *++lp;
+            if (copy) {
+                empty = 0;
+                memcpy(op, copy, wp - copy);
+                op += wp - copy;
+                copy = 0;
+            } else {
+                /* set to delimiter unless the first field */
+                copy = empty ? cp : wp;
+            }
+        }
+        if (!copy) {
+            if (nodelim) {
+                if (!cut->sflag) copy = first;
+            } else {
+                *op++ = '\n';
+            }
+        }
+        if (copy && (!nodelim || !cut->sflag)) {
+            memcpy(op, copy, cp - copy);
+            op += cp - copy;
+        }
+    }
+    return op - out;
+}
+
+static void *cutworker(void *arg) {
+    Par_t *par = arg;
+    Chunk_t *cp;
+    char *out;
+
+    pthread_mutex_lock(&par->lock);
+    for (;;) {
+        while (!par->failed && par->next < par->nchunks && par->next >= par->written + par->ahead) {
+            pthread_cond_wait(&par->cond, &par->lock);
+        }
+        if (par->failed || par->next >= par->nchunks) break;
+        cp = par->chunks + par->next++;
+        pthread_mutex_unlock(&par->lock);
+        out = malloc(cp->end - cp->beg);
+        if (out) cp->len = cutchunk(par->cut, cp->beg, cp->end, out);
+        pthread_mutex_lock(&par->lock);
+        if (!(cp->out = out)) par->failed = 1;
+        cp->done = 1;
+        pthread_cond_broadcast(&par->cond);
+    }
+    pthread_mutex_unlock(&par->lock);
+    return NULL;
+}
+
+/*
+ * cut the lines of a large regular file <fdin> on several threads
+ * the whole lines are cut and <fdin> is left after them for cutfields()
+ * return -1 if the output could not be written
+ */
+
+static int cutpar(Cut_t *cut, Sfio_t *fdin, Sfio_t *fdout) {
+    struct stat st;
+    Sfoff_t off;
+    size_t size, pg, i;
+    long n;
+    unsigned char *map;
+    const unsigned char *beg;
+    const unsigned char *end;
+    const unsigned char *cp;
+    pthread_t tid[PAR_MAX];
+    sigset_t all, old;
+    Par_t par;
+    char *out;
+    size_t done = 0;
+    int r = 0;
+
+    if (!cut->par || fstat(sffileno(fdin), &st) < 0 || !S_ISREG(st.st_mode)) return 0;
+    if ((off = sftell(fdin)) < 0 || st.st_size - off < PAR_MIN) return 0;
+    /* a single worker still lets the output be written while the next chunk is cut */
+    if ((n = sysconf(_SC_NPROCESSORS_ONLN)) < 1) n = 1;
+    if (n > PAR_MAX) n = PAR_MAX;
+    pg = off % sysconf(_SC_PAGESIZE);
+    size = st.st_size - off;
+    map = mmap(NULL, size + pg, PROT_READ, MAP_PRIVATE, sffileno(fdin), off - pg);
+    if (map == MAP_FAILED) return 0;
+    beg = map + pg;
+    for (end = beg + size; end > beg && end[-1] != '\n'; end--) {
+        ;
+    }
+    memset(&par, 0, sizeof(par));
+    par.cut = cut;
+    par.nchunks = (end - beg) / PAR_CHUNK + 1;
+    if (!(par.chunks = calloc(par.nchunks, sizeof(Chunk_t)))) {
+        munmap(map, size + pg);
+        return 0;
+    }
+    /* split at the first newline after each chunk size */
+    for (cp = beg, i = 0; cp < end; i++) {
+        par.chunks[i].beg = cp;
+        cp = (end - cp > PAR_CHUNK) ? (unsigned char *)memchr(cp + PAR_CHUNK - 1, '\n',
+                                                                end - cp - PAR_CHUNK + 1) + 1
+                                    : end;
+        par.chunks[i].end = cp;
+    }
+    par.nchunks = i;
+    if (n > par.nchunks) n = par.nchunks;
+    par.ahead = n * PAR_AHEAD;
+    pthread_mutex_init(&par.lock, NULL);
+    pthread_cond_init(&par.cond, NULL);
+    /* the shell's signals are handled on this thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (i = 0; i < n; i++) {
+        if (pthread_create(&tid[i], NULL, cutworker, &par)) break;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    n = i;
+    /* without a worker the file is left to cutfields() */
+    if (!n) par.failed = 1;
+    for (i = 0; i < par.nchunks; i++) {
+        pthread_mutex_lock(&par.lock);
+        while (!par.chunks[i].done && !par.failed) pthread_cond_wait(&par.cond, &par.lock);
+        out = par.chunks[i].done ? par.chunks[i].out : NULL;
+        pthread_mutex_unlock(&par.lock);
+        if (!out) break;
+        if (sfwrite(fdout, out, par.chunks[i].len) < 0) r = -1;
+        free(out);
+        par.chunks[i].out = NULL;
+        done = par.chunks[i].end - beg;
+        pthread_mutex_lock(&par.lock);
+        par.written++;
+        if (r < 0) par.failed = 1;
+        pthread_cond_broadcast(&par.cond);
+        pthread_mutex_unlock(&par.lock);
+        if (r < 0) break;
+    }
+    for (i = 0; i < (size_t)n; i++) pthread_join(tid[i], NULL);
+    for (i = 0; i < par.nchunks; i++) free(par.chunks[i].out);
+    free(par.chunks);
+    pthread_cond_destroy(&par.cond);
+    pthread_mutex_destroy(&par.lock);
+    munmap(map, size + pg);
+    /* the rest, if any, is read by cutfields() */
+    if (!r) sfseek(fdin, off + done, SEEK_SET);
+    return r;
+}
+
+#else
+
+static int cutpar(Cut_t *cut, Sfio_t *fdin, Sfio_t *fdout) {
+    UNUSED(cut);
+    UNUSED(fdin);
+    UNUSED(fdout);
+    return 0;
+}
+
+#endif
+
 int b_cut(int argc, char **argv, Shbltin_t *context) {
     char *cp = NULL;
     Sfio_t *fp;
@@ -639,7 +895,11 @@ int b_cut(int argc, char **argv, Shbltin_t *context) {
             continue;
         }
         if (mode & C_FIELDS) {
-            cutfields(cut, fp, sfstdout);
+            if (cutpar(cut, fp, sfstdout) < 0) {
+                error(ERROR_system(0), "write error");
+            } else {
+                cutfields(cut, fp, sfstdout);
+            }
         } else {
             cutcols(cut, fp, sfstdout);
         }
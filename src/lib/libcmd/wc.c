@@ -27,7 +27,11 @@
 #include "config_ast.h"  // IWYU pragma: keep
 
 #include <ctype.h>
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -99,6 +103,8 @@ typedef struct {
     Sfoff_t longest;
     int mode;
     int mb;
+    int ascii;    // the spaces in type[] are the ASCII ones, so the kernels can count words
+    int asciimb;  // each ASCII byte is a character in a multibyte locale other than UTF-8
     Mbstate_t q;
 } Wc_t;
 
@@ -217,6 +223,271 @@ static_fn void wc_printout(Wc_t *wp, char *name, int mode) {
 #define mbc(c) ((c)&WC_MB)
 #define spc(c) ((c)&WC_SP)
 
+#define wc_isspace(c) ((c) == ' ' || (unsigned int)((c) - '\t') <= '\r' - '\t')
+
+//
+// Kernels that classify a buffer a block at a time rather than a byte at a time. The SSE2 and
+// AVX2 versions are picked at run time when the processor has them; the portable ones are used
+// everywhere else and for the bytes left over at the end of a buffer.
+//
+#define WC_BLOCK 64
+
+// The bits for the bytes of one block with each property.
+typedef struct {
+    uint64_t nl;     // newline
+    uint64_t space;  // ASCII space, including newline
+    uint64_t cont;   // UTF-8 continuation byte
+    uint64_t lead2;  // 0xc0 and above, the lead byte of a sequence of at least two bytes
+    uint64_t lead3;  // 0xe0 and above
+    uint64_t lead4;  // 0xf0 and above
+    uint64_t bad;    // 0xc0, 0xc1 and 0xf8 and above, which the kernels leave to wc_count()
+} Wc_mask_t;
+
+// Counts accumulated by the kernels.
+typedef struct {
+    Sfoff_t lines;
+    Sfoff_t ends;   // spaces that follow a non-space, each one the end of a word
+    Sfoff_t conts;  // continuation bytes
+    int space;      // the byte before the next one is a space
+} Wc_run_t;
+
+static struct {
+    Sfoff_t (*lines)(const unsigned char *, size_t);
+    void (*masks)(const unsigned char *, Wc_mask_t *);
+} wc_kernel;
+
+static_fn Sfoff_t wc_lines_scalar(const unsigned char *cp, size_t n) {
+    const uint64_t lo = 0x7f7f7f7f7f7f7f7f, nl = 0x0a0a0a0a0a0a0a0a;
+    uint64_t w;
+    Sfoff_t lines = 0;
+
+    // A byte of w ^ nl is zero where cp has a newline; the high bit of each byte of w below is
+    // set only for those bytes.
+    for (; n >= sizeof(w); n -= sizeof(w), cp += sizeof(w)) {
+        memcpy(&w, cp, sizeof(w));
+        w ^= nl;
+        w = ~(((w & lo) + lo) | w | lo);
+        lines += __builtin_popcountll(w);
+    }
+    while (n--) lines += *cp++ == '\n';
+    return lines;
+}
+
+static_fn void wc_masks_scalar(const unsigned char *cp, Wc_mask_t *mp) {
+    int i;
+    int c;
+    uint64_t b;
+
+    memset(mp, 0, sizeof(*mp));
+    for (i = 0; i < WC_BLOCK; i++) {
+        c = cp[i];
+        b = (uint64_t)1 << i;
+        if (c == '\n') mp->nl |= b;
+        if (wc_isspace(c)) mp->space |= b;
+        if ((c & 0xc0) == 0x80) mp->cont |= b;
+        if (c >= 0xc0) mp->lead2 |= b;
+        if (c >= 0xe0) mp->lead3 |= b;
+        if (c >= 0xf0) mp->lead4 |= b;
+        if (c >= 0xf8 || (c & 0xfe) == 0xc0) mp->bad |= b;
+    }
+}
+
+#if defined(__GNUC__) && defined(__SSE2__)
+
+#define WC_SIMD 1
+
+static_fn Sfoff_t wc_lines_sse2(const unsigned char *cp, size_t n) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc;
+    __m128i sad;
+    size_t k;
+    Sfoff_t lines = 0;
+
+    // Each byte of acc counts the newlines in its lane, so it is summed before it can wrap.
+    while (n >= sizeof(acc)) {
+        k = n / sizeof(acc);
+        if (k > UCHAR_MAX) k = UCHAR_MAX;
+        n -= k * sizeof(acc);
+        acc = zero;
+        for (; k > 0; k--, cp += sizeof(acc)) {
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)cp), nl));
+        }
+        sad = _mm_sad_epu8(acc, zero);
+        lines += _mm_extract_epi16(sad, 0) + _mm_extract_epi16(sad, 4);
+    }
+    return lines + wc_lines_scalar(cp, n);
+}
+
+static_fn void wc_masks_sse2(const unsigned char *cp, Wc_mask_t *mp) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r' - '\t');
+    const __m128i x80 = _mm_set1_epi8((char)0x80);
+    const __m128i xc0 = _mm_set1_epi8((char)0xc0);
+    const __m128i xe0 = _mm_set1_epi8((char)0xe0);
+    const __m128i xf0 = _mm_set1_epi8((char)0xf0);
+    const __m128i xf8 = _mm_set1_epi8((char)0xf8);
+    const __m128i xfe = _mm_set1_epi8((char)0xfe);
+    __m128i v;
+    __m128i t;
+    int i;
+
+    memset(mp, 0, sizeof(*mp));
+    for (i = 0; i < WC_BLOCK; i += sizeof(v)) {
+        v = _mm_loadu_si128((const __m128i *)(cp + i));
+        t = _mm_sub_epi8(v, tab);
+        mp->nl |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << i;
+        mp->space |= (uint64_t)_mm_movemask_epi8(_mm_or_si128(
+                         _mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(_mm_min_epu8(t, cr), t)))
+                     << i;
+        mp->cont |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, xc0), x80)) << i;
+        mp->lead2 |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, xc0), v)) << i;
+        mp->lead3 |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, xe0), v)) << i;
+        mp->lead4 |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, xf0), v)) << i;
+        mp->bad |= (uint64_t)_mm_movemask_epi8(_mm_or_si128(
+                       _mm_cmpeq_epi8(_mm_max_epu8(v, xf8), v),
+                       _mm_cmpeq_epi8(_mm_and_si128(v, xfe), xc0)))
+                   << i;
+    }
+}
+
+__attribute__((target("avx2"))) static_fn Sfoff_t wc_lines_avx2(const unsigned char *cp,
+                                                                 size_t n) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc;
+    uint64_t sad[4];
+    size_t k;
+    Sfoff_t lines = 0;
+
+    while (n >= sizeof(acc)) {
+        k = n / sizeof(acc);
+        if (k > UCHAR_MAX) k = UCHAR_MAX;
+        n -= k * sizeof(acc);
+        acc = zero;
+        for (; k > 0; k--, cp += sizeof(acc)) {
+            acc = _mm256_sub_epi8(acc,
+                                  _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)cp), nl));
+        }
+        _mm256_storeu_si256((__m256i *)sad, _mm256_sad_epu8(acc, zero));
+        lines += sad[0] + sad[1] + sad[2] + sad[3];
+    }
+    return lines + wc_lines_sse2(cp, n);
+}
+
+__attribute__((target("avx2"))) static_fn void wc_masks_avx2(const unsigned char *cp,
+                                                              Wc_mask_t *mp) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r' - '\t');
+    const __m256i x80 = _mm256_set1_epi8((char)0x80);
+    const __m256i xc0 = _mm256_set1_epi8((char)0xc0);
+    const __m256i xe0 = _mm256_set1_epi8((char)0xe0);
+    const __m256i xf0 = _mm256_set1_epi8((char)0xf0);
+    const __m256i xf8 = _mm256_set1_epi8((char)0xf8);
+    const __m256i xfe = _mm256_set1_epi8((char)0xfe);
+    __m256i v;
+    __m256i t;
+    int i;
+
+#define wc_bits(x) ((uint64_t)(uint32_t)_mm256_movemask_epi8(x) << i)
+    memset(mp, 0, sizeof(*mp));
+    for (i = 0; i < WC_BLOCK; i += sizeof(v)) {
+        v = _mm256_loadu_si256((const __m256i *)(cp + i));
+        t = _mm256_sub_epi8(v, tab);
+        mp->nl |= wc_bits(_mm256_cmpeq_epi8(v, nl));
+        mp->space |= wc_bits(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp),
+                                             _mm256_cmpeq_epi8(_mm256_min_epu8(t, cr), t)));
+        mp->cont |= wc_bits(_mm256_cmpeq_epi8(_mm256_and_si256(v, xc0), x80));
+        mp->lead2 |= wc_bits(_mm256_cmpeq_epi8(_mm256_max_epu8(v, xc0), v));
+        mp->lead3 |= wc_bits(_mm256_cmpeq_epi8(_mm256_max_epu8(v, xe0), v));
+        mp->lead4 |= wc_bits(_mm256_cmpeq_epi8(_mm256_max_epu8(v, xf0), v));
+        mp->bad |= wc_bits(_mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, xf8), v),
+                                           _mm256_cmpeq_epi8(_mm256_and_si256(v, xfe), xc0)));
+    }
+#undef wc_bits
+}
+
+#endif  // __GNUC__ && __SSE2__
+
+static_fn void wc_dispatch(void) {
+    wc_kernel.lines = wc_lines_scalar;
+    wc_kernel.masks = wc_masks_scalar;
+#ifdef WC_SIMD
+    wc_kernel.lines = wc_lines_sse2;
+    wc_kernel.masks = wc_masks_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        wc_kernel.lines = wc_lines_avx2;
+        wc_kernel.masks = wc_masks_avx2;
+    }
+#endif
+}
+
+//
+// Count the newlines and the ends of words, delimited by ASCII spaces, in the <n> bytes at <cp>.
+// If <ascii> is set the count stops at the first byte with the high bit set, and the number of
+// bytes counted is returned.
+//
+static_fn size_t wc_words(Wc_run_t *rp, const unsigned char *cp, size_t n, int ascii) {
+    Wc_mask_t m;
+    size_t i;
+    uint64_t space = rp->space;
+    int c;
+    int s;
+
+    for (i = 0; i + WC_BLOCK <= n; i += WC_BLOCK) {
+        (*wc_kernel.masks)(cp + i, &m);
+        if (ascii && (m.cont | m.lead2)) break;
+        rp->lines += __builtin_popcountll(m.nl);
+        rp->ends += __builtin_popcountll(m.space & ~((m.space << 1) | space));
+        space = m.space >> (WC_BLOCK - 1);
+    }
+    for (; i < n; i++) {
+        c = cp[i];
+        if (ascii && c >= 0x80) break;
+        s = wc_isspace(c);
+        rp->lines += c == '\n';
+        rp->ends += s && !space;
+        space = s;
+    }
+    rp->space = space;
+    return i;
+}
+
+//
+// Count the newlines and continuation bytes in the longest prefix of the <n> bytes at <cp> that
+// is made of whole UTF-8 characters of up to four bytes, ending on a block boundary, and return
+// its length. The rest is left to the state machine in wc_count(), which also diagnoses it.
+//
+static_fn size_t wc_utf8(Wc_run_t *rp, const unsigned char *cp, size_t n) {
+    Wc_mask_t m;
+    size_t i;
+    size_t good = 0;
+    uint64_t carry = 0;
+    Sfoff_t lines = 0;
+    Sfoff_t conts = 0;
+
+    for (i = 0; i + WC_BLOCK <= n; i += WC_BLOCK) {
+        (*wc_kernel.masks)(cp + i, &m);
+        // Each lead byte requires the bytes after it, and only those, to be continuation bytes.
+        if (m.bad || ((m.lead2 << 1) | (m.lead3 << 2) | (m.lead4 << 3) | carry) != m.cont) break;
+        carry = (m.lead2 >> 63) | (m.lead3 >> 62) | (m.lead4 >> 61);
+        lines += __builtin_popcountll(m.nl);
+        conts += __builtin_popcountll(m.cont);
+        if (!carry) {
+            good = i + WC_BLOCK;
+            rp->lines += lines;
+            rp->conts += conts;
+            lines = conts = 0;
+        }
+    }
+    return good;
+}
+
 static_fn Wc_t *wc_init(int mode) {
     int n;
     int w;
@@ -252,6 +523,25 @@ static_fn Wc_t *wc_init(int mode) {
         wp->type[0xfe] = WC_MB | WC_ERR;
         wp->type[0xff] = WC_MB | WC_ERR;
     }
+    wp->ascii = w != 0;
+    for (n = 0; n < (1 << CHAR_BIT); n++) {
+        if (!spc(wp->type[n]) != !wc_isspace(n)) wp->ascii = 0;
+    }
+    wp->asciimb = wp->mb < 0;
+    if (wp->asciimb) {
+        char s[1];
+        wchar_t x;
+        mbstate_t q;
+        for (n = 1; n < 0x80; n++) {
+            s[0] = n;
+            memset(&q, 0, sizeof(q));
+            if (mbrtowc(&x, s, 1, &q) != 1 || x != n) {
+                wp->asciimb = 0;
+                break;
+            }
+        }
+    }
+    if (!wc_kernel.lines) wc_dispatch();
     wp->mode = mode;
     return wp;
 }
@@ -328,9 +618,15 @@ static_fn int wc_count(Wc_t *wp, Sfio_t *fd, const char *file) {
     nlines = nwords = nchars = nbytes = 0;
     wp->longest = 0;
     if (wp->mb < 0 && (wp->mode & (WC_MBYTE | WC_WORDS))) {
+        // An ASCII byte is a character once mbtowc() is known to be in its initial state.
+        int clean = 0;
+
         cp = buff = endbuff = 0;
         for (;;) {
-            if (cp >= endbuff || (n = mbtowc(&x, (char *)cp, endbuff - cp)) < 0) {
+            if (clean && cp < endbuff && *cp < 0x80) {
+                x = *cp++;
+            } else if (cp >= endbuff || (n = mbtowc(&x, (char *)cp, endbuff - cp)) < 0) {
+                clean = 0;
                 o = endbuff - cp;
                 if (o < sizeof(side)) {
                     if (buff) {
@@ -365,6 +661,7 @@ static_fn int wc_count(Wc_t *wp, Sfio_t *fd, const char *file) {
                     eline = wc_invalid(file, nlines);
                 }
             } else {
+                clean = wp->asciimb;
                 cp += n ? n : 1;
             }
             if (x == '\n') {
@@ -386,19 +683,16 @@ static_fn int wc_count(Wc_t *wp, Sfio_t *fd, const char *file) {
         if (!(wp->mode & (WC_MBYTE | WC_WORDS | WC_LONGEST))) {
             while ((cp = (unsigned char *)sfreserve(fd, SF_UNBOUND, 0)) && (c = sfvalue(fd)) > 0) {
                 nchars += c;
-                endbuff = cp + c;
-                if (*--endbuff == '\n') {
-                    nlines++;
-                } else {
-                    *endbuff = '\n';
-                }
-                for (;;) {
-                    if (*cp++ == '\n') {
-                        if (cp > endbuff) break;
-                        nlines++;
-                    }
-                }
+                nlines += (*wc_kernel.lines)(cp, c);
             }
+        } else if (wp->ascii) {
+            Wc_run_t run = {.space = 1};
+            while ((cp = (unsigned char *)sfreserve(fd, SF_UNBOUND, 0)) && (c = sfvalue(fd)) > 0) {
+                nchars += c;
+                wc_words(&run, cp, c, 0);
+            }
+            nlines = run.lines;
+            nwords = run.ends + !run.space;
         } else {
             while ((cp = buff = (unsigned char *)sfreserve(fd, SF_UNBOUND, 0)) &&
                    (c = sfvalue(fd)) > 0) {
@@ -469,6 +763,35 @@ static_fn int wc_count(Wc_t *wp, Sfio_t *fd, const char *file) {
             nbytes += c;
             nchars += c;
             start = cp - lineoff;
+            if (!skip && !mbc(lasttype) && !(wp->mode & WC_LONGEST)) {
+                Wc_run_t run = {.space = lasttype != 0};
+                if (!(wp->mode & WC_WORDS)) {
+                    // Whole characters are counted by the kernel, which leaves nothing pending
+                    // for the state machine; it carries on from the first byte it did not take.
+                    if ((n = wc_utf8(&run, cp, c)) > 0) {
+                        nlines += run.lines + (eol(lasttype) != 0);
+                        nchars -= run.conts;
+                        lasttype = WC_SP;
+                        if (n == c) continue;
+                        buff = cp += n;
+                        c -= n;
+                    }
+                } else if (wp->ascii && c > 1 && wc_words(&run, cp, c, 1) == c) {
+                    // An ASCII buffer is counted as the state machine would, leaving its last
+                    // byte pending.
+                    lastchar = cp[c - 1];
+                    nlines += run.lines + (eol(lasttype) != 0) - (lastchar == '\n');
+                    nwords += run.ends;
+                    for (o = 0; o < c - 1; o++) {
+                        if (!spc(type[cp[o]])) {
+                            wasspace = 1;
+                            break;
+                        }
+                    }
+                    lasttype = type[lastchar];
+                    continue;
+                }
+            }
             /* check to see whether first character terminates word */
             if (c == 1) {
                 if (eol(lasttype)) nlines++;